@@ -54,6 +54,7 @@ ULOG_DECLARE_TAG(pdraw_app);
 enum args_id {
     ARGS_ID_HMD = 256,
     ARGS_ID_HEADTRACK,
+    ARGS_ID_LOW_LATENCY,
 };
 
 
@@ -77,6 +78,7 @@ static const struct option long_options[] =
     { "screstream"      , required_argument  , NULL, 'n' },
     { "hmd"             , required_argument  , NULL, ARGS_ID_HMD },
     { "headtrack"       , no_argument        , NULL, ARGS_ID_HEADTRACK },
+    { "low-latency"     , no_argument        , NULL, ARGS_ID_LOW_LATENCY },
     { 0, 0, 0, 0 }
 };
 
@@ -197,6 +199,7 @@ static void usage(int argc, char *argv[])
             "-n | --screstream <ip_address>     Connexion to a RTP restream from a SkyController\n"
             "     --hmd <model>                 HMD distorsion correction with model id (0=Parrot Cockpit Glasses)\n"
             "     --headtrack                   Enable headtracking\n"
+            "     --low-latency                 Live low latency profile (stream only, no vsync)\n"
             "\n",
             argv[0]);
 }
@@ -363,6 +366,10 @@ int main(int argc, char *argv[])
                     app->headtracking = 1;
                     break;
 
+                case ARGS_ID_LOW_LATENCY:
+                    app->lowLatency = 1;
+                    break;
+
                 default:
                     usage(argc, argv);
                     free(app);
@@ -826,7 +833,8 @@ int startUi(struct pdraw_app *app)
     {
         app->sdlFlags = SDL_HWSURFACE | SDL_GL_DOUBLEBUFFER | SDL_OPENGL | SDL_RESIZABLE;
 
-        SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, 1);
+        /* Without vsync the frames are presented as soon as they are rendered */
+        SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, (app->lowLatency) ? 0 : 1);
         SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
         SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
         SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
@@ -917,6 +925,15 @@ int startPdraw(struct pdraw_app *app)
         }
     }
 
+    if ((ret == 0) && (app->lowLatency))
+    {
+        ret = pdraw_set_stream_profile_settings(app->pdraw, PDRAW_STREAM_PROFILE_LIVE_LOW_LATENCY);
+        if (ret != 0)
+        {
+            ULOGE("pdraw_set_stream_profile_settings() failed (%d)", ret);
+        }
+    }
+
     if (ret == 0)
     {
         pdraw_get_self_head_orientation_euler(app->pdraw, &app->headOrientation);
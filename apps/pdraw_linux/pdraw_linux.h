@@ -120,6 +120,7 @@ struct pdraw_app
     int hmd;
     pdraw_hmd_model_t hmdModel;
     int headtracking;
+    int lowLatency;
     pdraw_euler_t headOrientation;
     uint64_t lastCameraOrientationTime;
 
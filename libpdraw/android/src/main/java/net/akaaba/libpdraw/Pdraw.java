@@ -259,24 +259,36 @@ public class Pdraw {
     }
 
     public void seekTo(long timestamp) {
+        seekTo(timestamp, false);
+    }
+
+    public void seekTo(long timestamp, boolean exact) {
         if (!isValid()) {
             throw new RuntimeException("invalid pdraw instance");
         }
-        nativeSeekTo(pdrawCtx, timestamp);
+        nativeSeekTo(pdrawCtx, timestamp, exact);
     }
 
     public void seekForward(long delta) {
+        seekForward(delta, false);
+    }
+
+    public void seekForward(long delta, boolean exact) {
         if (!isValid()) {
             throw new RuntimeException("invalid pdraw instance");
         }
-        nativeSeekForward(pdrawCtx, delta);
+        nativeSeekForward(pdrawCtx, delta, exact);
     }
 
     public void seekBack(long delta) {
+        seekBack(delta, false);
+    }
+
+    public void seekBack(long delta, boolean exact) {
         if (!isValid()) {
             throw new RuntimeException("invalid pdraw instance");
         }
-        nativeSeekBack(pdrawCtx, delta);
+        nativeSeekBack(pdrawCtx, delta, exact);
     }
 
     public long getDuration() {
@@ -293,6 +305,34 @@ public class Pdraw {
         return nativeGetCurrentTime(pdrawCtx);
     }
 
+    public void setPlaybackSpeed(float speed) {
+        if (!isValid()) {
+            throw new RuntimeException("invalid pdraw instance");
+        }
+        nativeSetPlaybackSpeed(pdrawCtx, speed);
+    }
+
+    public float getPlaybackSpeed() {
+        if (!isValid()) {
+            throw new RuntimeException("invalid pdraw instance");
+        }
+        return nativeGetPlaybackSpeed(pdrawCtx);
+    }
+
+    public void stepForward() {
+        if (!isValid()) {
+            throw new RuntimeException("invalid pdraw instance");
+        }
+        nativeStepForward(pdrawCtx);
+    }
+
+    public void stepBack() {
+        if (!isValid()) {
+            throw new RuntimeException("invalid pdraw instance");
+        }
+        nativeStepBack(pdrawCtx);
+    }
+
     public void startRecorder(String fileName) {
         if (!isValid()) {
             throw new RuntimeException("invalid pdraw instance");
@@ -775,15 +815,18 @@ public class Pdraw {
 
     private native int nativeSeekTo(
         long pdrawCtx,
-        long timestamp);
+        long timestamp,
+        boolean exact);
 
     private native int nativeSeekForward(
         long pdrawCtx,
-        long delta);
+        long delta,
+        boolean exact);
 
     private native int nativeSeekBack(
         long pdrawCtx,
-        long delta);
+        long delta,
+        boolean exact);
 
     private native long nativeGetDuration(
         long pdrawCtx);
@@ -791,6 +834,19 @@ public class Pdraw {
     private native long nativeGetCurrentTime(
         long pdrawCtx);
 
+    private native int nativeSetPlaybackSpeed(
+        long pdrawCtx,
+        float speed);
+
+    private native float nativeGetPlaybackSpeed(
+        long pdrawCtx);
+
+    private native int nativeStepForward(
+        long pdrawCtx);
+
+    private native int nativeStepBack(
+        long pdrawCtx);
+
     private native int nativeStartRecorder(
         long pdrawCtx,
         String fileName);
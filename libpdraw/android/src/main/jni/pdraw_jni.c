@@ -1132,7 +1132,8 @@ Java_net_akaaba_libpdraw_Pdraw_nativeSeekTo(
     JNIEnv *env,
     jobject thizz,
     jlong jctx,
-    jlong timestamp)
+    jlong timestamp,
+    jboolean exact)
 {
     struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
 
@@ -1142,7 +1143,14 @@ Java_net_akaaba_libpdraw_Pdraw_nativeSeekTo(
         return (jint)-1;
     }
 
-    return (jint)pdraw_seek_to(ctx->pdraw, (uint64_t)timestamp);
+    if (exact)
+    {
+        return (jint)pdraw_seek_to_exact(ctx->pdraw, (uint64_t)timestamp);
+    }
+    else
+    {
+        return (jint)pdraw_seek_to(ctx->pdraw, (uint64_t)timestamp);
+    }
 }
 
 
@@ -1151,7 +1159,8 @@ Java_net_akaaba_libpdraw_Pdraw_nativeSeekForward(
     JNIEnv *env,
     jobject thizz,
     jlong jctx,
-    jlong delta)
+    jlong delta,
+    jboolean exact)
 {
     struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
 
@@ -1161,7 +1170,14 @@ Java_net_akaaba_libpdraw_Pdraw_nativeSeekForward(
         return (jint)-1;
     }
 
-    return (jint)pdraw_seek_forward(ctx->pdraw, (uint64_t)delta);
+    if (exact)
+    {
+        return (jint)pdraw_seek_forward_exact(ctx->pdraw, (uint64_t)delta);
+    }
+    else
+    {
+        return (jint)pdraw_seek_forward(ctx->pdraw, (uint64_t)delta);
+    }
 }
 
 
@@ -1170,7 +1186,8 @@ Java_net_akaaba_libpdraw_Pdraw_nativeSeekBack(
     JNIEnv *env,
     jobject thizz,
     jlong jctx,
-    jlong delta)
+    jlong delta,
+    jboolean exact)
 {
     struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
 
@@ -1180,7 +1197,14 @@ Java_net_akaaba_libpdraw_Pdraw_nativeSeekBack(
         return (jint)-1;
     }
 
-    return (jint)pdraw_seek_back(ctx->pdraw, (uint64_t)delta);
+    if (exact)
+    {
+        return (jint)pdraw_seek_back_exact(ctx->pdraw, (uint64_t)delta);
+    }
+    else
+    {
+        return (jint)pdraw_seek_back(ctx->pdraw, (uint64_t)delta);
+    }
 }
 
 
@@ -1220,6 +1244,79 @@ Java_net_akaaba_libpdraw_Pdraw_nativeGetCurrentTime(
 }
 
 
+JNIEXPORT jint JNICALL
+Java_net_akaaba_libpdraw_Pdraw_nativeSetPlaybackSpeed(
+    JNIEnv *env,
+    jobject thizz,
+    jlong jctx,
+    jfloat speed)
+{
+    struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
+
+    if ((!ctx) || (!ctx->pdraw))
+    {
+        LOGE("invalid pointer");
+        return (jint)-1;
+    }
+
+    return (jint)pdraw_set_playback_speed(ctx->pdraw, (float)speed);
+}
+
+
+JNIEXPORT jfloat JNICALL
+Java_net_akaaba_libpdraw_Pdraw_nativeGetPlaybackSpeed(
+    JNIEnv *env,
+    jobject thizz,
+    jlong jctx)
+{
+    struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
+
+    if ((!ctx) || (!ctx->pdraw))
+    {
+        LOGE("invalid pointer");
+        return (jfloat)0.;
+    }
+
+    return (jfloat)pdraw_get_playback_speed(ctx->pdraw);
+}
+
+
+JNIEXPORT jint JNICALL
+Java_net_akaaba_libpdraw_Pdraw_nativeStepForward(
+    JNIEnv *env,
+    jobject thizz,
+    jlong jctx)
+{
+    struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
+
+    if ((!ctx) || (!ctx->pdraw))
+    {
+        LOGE("invalid pointer");
+        return (jint)-1;
+    }
+
+    return (jint)pdraw_step_forward(ctx->pdraw);
+}
+
+
+JNIEXPORT jint JNICALL
+Java_net_akaaba_libpdraw_Pdraw_nativeStepBack(
+    JNIEnv *env,
+    jobject thizz,
+    jlong jctx)
+{
+    struct pdraw_jni_ctx *ctx = (struct pdraw_jni_ctx*)(intptr_t)jctx;
+
+    if ((!ctx) || (!ctx->pdraw))
+    {
+        LOGE("invalid pointer");
+        return (jint)-1;
+    }
+
+    return (jint)pdraw_step_back(ctx->pdraw);
+}
+
+
 JNIEXPORT jint JNICALL
 Java_net_akaaba_libpdraw_Pdraw_nativeStartRecorder(
     JNIEnv *env,
@@ -15,10 +15,16 @@ LOCAL_SRC_FILES := \
 	src/pdraw_media_video.cpp \
 	src/pdraw_demuxer_stream.cpp \
 	src/pdraw_demuxer_record.cpp \
+	src/pdraw_demuxer_record_index.cpp \
 	src/pdraw_utils.cpp \
+	src/pdraw_copy.cpp \
+	src/pdraw_convert.cpp \
+	src/pdraw_scale.cpp \
 	src/pdraw_metadata_session.cpp \
 	src/pdraw_metadata_videoframe.cpp \
+	src/pdraw_decoder_pool.cpp \
 	src/pdraw_avcdecoder.cpp \
+	src/pdraw_avcdecoder_fallback.cpp \
 	src/pdraw_avcdecoder_ffmpeg.cpp \
 	src/pdraw_avcdecoder_videocoreomx.cpp \
 	src/pdraw_avcdecoder_amediacodec.cpp \
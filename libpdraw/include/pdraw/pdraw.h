@@ -53,6 +53,15 @@ struct pdraw;
 struct pdraw *pdraw_new(void);
 
 
+int pdraw_set_decoder_pool_worker_count
+        (unsigned int count);
+
+
+int pdraw_set_decoder_backend_priority
+        (const char *name,
+         int priority);
+
+
 int pdraw_destroy
         (struct pdraw *pdraw);
 
@@ -111,16 +120,33 @@ int pdraw_seek_to
          uint64_t timestamp);
 
 
+/* Frame-accurate seek (recorded media): the frames between the previous
+ * sync sample and the requested time are decoded but not output */
+int pdraw_seek_to_exact
+        (struct pdraw *pdraw,
+         uint64_t timestamp);
+
+
 int pdraw_seek_forward
         (struct pdraw *pdraw,
          uint64_t delta);
 
 
+int pdraw_seek_forward_exact
+        (struct pdraw *pdraw,
+         uint64_t delta);
+
+
 int pdraw_seek_back
         (struct pdraw *pdraw,
          uint64_t delta);
 
 
+int pdraw_seek_back_exact
+        (struct pdraw *pdraw,
+         uint64_t delta);
+
+
 uint64_t pdraw_get_duration
         (struct pdraw *pdraw);
 
@@ -129,6 +155,29 @@ uint64_t pdraw_get_current_time
         (struct pdraw *pdraw);
 
 
+int pdraw_set_playback_speed
+        (struct pdraw *pdraw,
+         float speed);
+
+
+float pdraw_get_playback_speed
+        (struct pdraw *pdraw);
+
+
+int pdraw_step_forward
+        (struct pdraw *pdraw);
+
+
+int pdraw_step_back
+        (struct pdraw *pdraw);
+
+
+int pdraw_get_keyframe_list
+        (struct pdraw *pdraw,
+         pdraw_keyframe_t *keyframes,
+         unsigned int maxCount);
+
+
 int pdraw_start_recorder
         (struct pdraw *pdraw,
          const char *fileName);
@@ -398,6 +447,12 @@ int pdraw_get_media_info
          pdraw_media_info_t *info);
 
 
+int pdraw_get_decoder_stats
+        (struct pdraw *pdraw,
+         unsigned int mediaId,
+         pdraw_decoder_stats_t *stats);
+
+
 void *pdraw_add_video_frame_filter_callback
         (struct pdraw *pdraw,
          unsigned int mediaId,
@@ -405,6 +460,15 @@ void *pdraw_add_video_frame_filter_callback
          void *userPtr);
 
 
+void *pdraw_add_video_frame_filter_parallel_callback
+        (struct pdraw *pdraw,
+         unsigned int mediaId,
+         pdraw_video_frame_filter_callback_t cb,
+         void *userPtr,
+         unsigned int threadCount,
+         int ordered);
+
+
 int pdraw_remove_video_frame_filter_callback
         (struct pdraw *pdraw,
          unsigned int mediaId,
@@ -426,6 +490,53 @@ int pdraw_get_producer_last_frame
          void *producerCtx,
          pdraw_video_frame_t *frame);
 
+
+int pdraw_release_producer_frame
+        (struct pdraw *pdraw,
+         void *producerCtx,
+         const pdraw_video_frame_t *frame);
+
+
+int pdraw_get_producer_detached_frame
+        (struct pdraw *pdraw,
+         void *producerCtx,
+         pdraw_video_frame_t *frame);
+
+
+void *pdraw_add_video_frame_ring_producer
+        (struct pdraw *pdraw,
+         unsigned int mediaId,
+         unsigned int ringSize,
+         pdraw_frame_ring_overflow_policy_t ringPolicy);
+
+
+int pdraw_get_producer_next_frame
+        (struct pdraw *pdraw,
+         void *producerCtx,
+         pdraw_video_frame_t *frame,
+         long waitUs);
+
+
+int pdraw_get_producer_stats
+        (struct pdraw *pdraw,
+         void *producerCtx,
+         pdraw_video_frame_producer_stats_t *stats);
+
+
+int pdraw_set_producer_output_format
+        (struct pdraw *pdraw,
+         void *producerCtx,
+         pdraw_color_format_t format,
+         pdraw_color_matrix_t matrix);
+
+
+int pdraw_set_producer_scaling
+        (struct pdraw *pdraw,
+         void *producerCtx,
+         unsigned int width,
+         unsigned int height,
+         const pdraw_rect_t *roi);
+
 float pdraw_get_controller_radar_angle_setting
         (struct pdraw *pdraw);
 
@@ -461,6 +572,79 @@ int pdraw_set_hmd_distorsion_correction_settings
          float panH,
          float panV);
 
+int pdraw_get_decoder_threading_settings
+        (struct pdraw *pdraw,
+         unsigned int *threadCount,
+         pdraw_decoder_thread_type_t *threadType);
+
+int pdraw_set_decoder_threading_settings
+        (struct pdraw *pdraw,
+         unsigned int threadCount,
+         pdraw_decoder_thread_type_t threadType);
+
+int pdraw_get_record_index_settings
+        (struct pdraw *pdraw,
+         int *enabled,
+         int *persistent);
+
+int pdraw_set_record_index_settings
+        (struct pdraw *pdraw,
+         int enabled,
+         int persistent);
+
+int pdraw_get_reverse_playback_settings
+        (struct pdraw *pdraw,
+         unsigned int *cacheMaxSize);
+
+int pdraw_set_reverse_playback_settings
+        (struct pdraw *pdraw,
+         unsigned int cacheMaxSize);
+
+int pdraw_get_decoder_frame_pool_settings
+        (struct pdraw *pdraw,
+         unsigned int *maxSize);
+
+int pdraw_set_decoder_frame_pool_settings
+        (struct pdraw *pdraw,
+         unsigned int maxSize);
+
+int pdraw_get_decoder_overload_settings
+        (struct pdraw *pdraw,
+         int *enabled,
+         unsigned int *maxQueueDepth,
+         unsigned int *maxAuAge);
+
+int pdraw_set_decoder_overload_settings
+        (struct pdraw *pdraw,
+         int enabled,
+         unsigned int maxQueueDepth,
+         unsigned int maxAuAge);
+
+int pdraw_get_stream_profile_settings
+        (struct pdraw *pdraw,
+         pdraw_stream_profile_t *profile);
+
+int pdraw_set_stream_profile_settings
+        (struct pdraw *pdraw,
+         pdraw_stream_profile_t profile);
+
+int pdraw_get_decoder_pool_settings
+        (struct pdraw *pdraw,
+         int *shared);
+
+int pdraw_set_decoder_pool_settings
+        (struct pdraw *pdraw,
+         int shared);
+
+int pdraw_get_decoder_backend_settings
+        (struct pdraw *pdraw,
+         char *name,
+         unsigned int nameSize);
+
+int pdraw_set_decoder_backend_settings
+        (struct pdraw *pdraw,
+         const char *name);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
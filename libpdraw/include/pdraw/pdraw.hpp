@@ -84,19 +84,62 @@ public:
 
     virtual int stop(void) = 0;
 
+    /*
+     * seek (recorded media only)
+     *
+     * exact : if false, playback resumes at the sync sample preceding
+     *  the requested time; if true, the frames between that sync sample
+     *  and the requested time are decoded but not output
+     */
     virtual int seekTo
-            (uint64_t timestamp) = 0;
+            (uint64_t timestamp,
+             bool exact = false) = 0;
 
     virtual int seekForward
-            (uint64_t delta) = 0;
+            (uint64_t delta,
+             bool exact = false) = 0;
 
     virtual int seekBack
-            (uint64_t delta) = 0;
+            (uint64_t delta,
+             bool exact = false) = 0;
 
     virtual uint64_t getDuration() = 0;
 
     virtual uint64_t getCurrentTime() = 0;
 
+    /*
+     * playback speed (recorded media only)
+     *
+     * speed : playback speed factor, from PDRAW_PLAYBACK_SPEED_MIN to
+     *  PDRAW_PLAYBACK_SPEED_MAX, or PDRAW_PLAYBACK_SPEED_UNTHROTTLED to
+     *  demux as fast as the decoder consumes the frames; negative values
+     *  play backward (not unthrottled)
+     */
+    virtual int setPlaybackSpeed
+            (float speed) = 0;
+
+    virtual float getPlaybackSpeed() = 0;
+
+    /*
+     * frame stepping (recorded media only)
+     *
+     * pauses the playback and outputs the next or previous frame
+     */
+    virtual int stepForward() = 0;
+
+    virtual int stepBack() = 0;
+
+    /*
+     * keyframe list (recorded media with the recording index enabled)
+     *
+     * keyframes : array filled with up to maxCount keyframes, can be NULL
+     * returns the total number of keyframes, or -1 if the index is not
+     * available (yet)
+     */
+    virtual int getKeyframeList
+            (pdraw_keyframe_t *keyframes,
+             unsigned int maxCount) = 0;
+
     virtual int startRecorder
             (const std::string &fileName) = 0;
 
@@ -229,7 +272,29 @@ public:
 
     virtual int getMediaInfo(unsigned int index, pdraw_media_info_t *info) = 0;
 
-    virtual void *addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_frame_filter_callback_t cb, void *userPtr) = 0;
+    /*
+     * get decoder statistics
+     *
+     * Returns the input and output buffer pools occupancy and high-water
+     * marks, the input buffer size and the largest access unit received
+     * for the decoder of a video media.
+     */
+    virtual int getDecoderStats(unsigned int mediaId, pdraw_decoder_stats_t *stats) = 0;
+
+    /*
+     * add a video frame filter callback
+     *
+     * threadCount : number of callback worker threads
+     *  1: the callback is called on the filter thread
+     *  >1: up to threadCount callbacks run concurrently; frames
+     *      arriving while all workers are busy replace the oldest
+     *      pending frame
+     * ordered : if true, the callbacks are started in decoding order
+     *
+     * The callback statistics are available through getProducerStats().
+     */
+    virtual void *addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                              unsigned int threadCount = 1, bool ordered = true) = 0;
 
     virtual int removeVideoFrameFilterCallback(unsigned int mediaId, void *filterCtx) = 0;
 
@@ -240,6 +305,12 @@ public:
     /*
      * get last frame
      *
+     * The frame is not copied: it points to the decoder output and must
+     * be released with releaseProducerFrame(), given the frame structure
+     * as returned (the frame is identified by its plane and timestamps);
+     * frames that are not released are released automatically after two
+     * more calls.
+     *
      * waitUs : time in microseconds to wait a frame
      *  0: don't wait
      * -1: wait forever
@@ -247,6 +318,67 @@ public:
      */
     virtual int getProducerLastFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs = 0) = 0;
 
+    virtual int releaseProducerFrame(void *producerCtx, const pdraw_video_frame_t *frame) = 0;
+
+    /*
+     * get a copy of the last frame
+     *
+     * The frame is copied and stays valid until the second next call;
+     * it must not be released.
+     */
+    virtual int getProducerDetachedFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs = 0) = 0;
+
+    /*
+     * add a frame ring producer
+     *
+     * Every decoded frame is copied into a ring of ringSize slots
+     * preallocated for the current stream format; frames are returned
+     * in order by getProducerNextFrame(). When the ring is full the
+     * oldest frame is overwritten (PDRAW_FRAME_RING_OVERFLOW_DROP_OLDEST)
+     * or the decoder is stalled (PDRAW_FRAME_RING_OVERFLOW_BLOCK, not
+     * available when the decoder runs on the shared decoder pool).
+     * The producer is removed with removeVideoFrameProducer().
+     */
+    virtual void *addVideoFrameRingProducer(unsigned int mediaId, unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy) = 0;
+
+    /*
+     * get the next frame from a frame ring producer
+     *
+     * The frame stays valid until the next call or until it is released
+     * with releaseProducerFrame().
+     */
+    virtual int getProducerNextFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs = 0) = 0;
+
+    /*
+     * get producer statistics
+     *
+     * Also accepts a video frame filter callback context.
+     */
+    virtual int getProducerStats(void *producerCtx, pdraw_video_frame_producer_stats_t *stats) = 0;
+
+    /*
+     * set the producer output format
+     *
+     * Frames are converted to RGB24, BGR24, RGBA or GRAY (luma plane)
+     * into the producer buffers (see VideoFrameFilter); the default
+     * PDRAW_COLOR_FORMAT_UNKNOWN keeps the decoder YUV format.
+     * Converted frames are detached frames: getProducerLastFrame()
+     * then behaves as getProducerDetachedFrame().
+     */
+    virtual int setProducerOutputFormat(void *producerCtx, pdraw_color_format_t format, pdraw_color_matrix_t matrix) = 0;
+
+    /*
+     * set the producer output dimensions and region of interest
+     *
+     * Frames are cropped to roi (NULL: full frame) and scaled to
+     * width x height (0: region of interest dimensions) while they are
+     * copied, before any format conversion; the full resolution frame
+     * is never copied. As with converted frames, scaled frames are
+     * detached frames. The processing time is reported in the
+     * producer stats.
+     */
+    virtual int setProducerScaling(void *producerCtx, unsigned int width, unsigned int height, const pdraw_rect_t *roi = NULL) = 0;
+
     virtual float getControllerRadarAngleSetting(void) = 0;
     virtual void setControllerRadarAngleSetting(float angle) = 0;
 
@@ -255,10 +387,120 @@ public:
 
     virtual void getHmdDistorsionCorrectionSettings(pdraw_hmd_model_t *hmdModel, float *ipd, float *scale, float *panH, float *panV) = 0;
     virtual void setHmdDistorsionCorrectionSettings(pdraw_hmd_model_t hmdModel, float ipd, float scale, float panH, float panV) = 0;
+
+    /*
+     * decoder threading settings (applied to decoders created by the next open)
+     *
+     * threadCount : number of decoding threads
+     *  0: automatic (number of CPUs)
+     *  1: single-threaded
+     * threadType : frame-level, slice-level or automatic multi-threading
+     */
+    virtual void getDecoderThreadingSettings(unsigned int *threadCount, pdraw_decoder_thread_type_t *threadType) = 0;
+    virtual void setDecoderThreadingSettings(unsigned int threadCount, pdraw_decoder_thread_type_t threadType) = 0;
+
+    /*
+     * recording index settings (applied to recordings opened by the next open)
+     *
+     * enabled : pre-scan the recording in the background to build a
+     *  keyframe index used for seeking and by getKeyframeList()
+     * persistent : save the index in a sidecar file next to the recording
+     *  ('<file>.pdrawidx') and reuse it on the next open
+     */
+    virtual void getRecordIndexSettings(bool *enabled, bool *persistent) = 0;
+    virtual void setRecordIndexSettings(bool enabled, bool persistent) = 0;
+
+    /*
+     * reverse playback settings (applied to decoders created by the next open)
+     *
+     * cacheMaxSize : memory budget in bytes of the decoded frame cache used
+     *  for reverse playback and frame stepping (per video track); GOPs
+     *  that do not fit are decoded in several passes
+     */
+    virtual void getReversePlaybackSettings(unsigned int *cacheMaxSize) = 0;
+    virtual void setReversePlaybackSettings(unsigned int cacheMaxSize) = 0;
+
+    /*
+     * decoder frame pool settings (applied to decoders created by the next open)
+     *
+     * maxSize : memory cap in bytes of the pool the decoded pictures are
+     *  allocated from (per video track, software decoder only); when the
+     *  pool is exhausted frames are dropped and counted in the decoder
+     *  statistics
+     *  0: let the decoder allocate the pictures
+     */
+    virtual void getDecoderFramePoolSettings(unsigned int *maxSize) = 0;
+    virtual void setDecoderFramePoolSettings(unsigned int maxSize) = 0;
+
+    /*
+     * decoder overload settings (applied to decoders created by the next open)
+     *
+     * enabled : when the decoder falls behind, drop the non-reference
+     *  frames, then skip the loop filter, then decode only the key
+     *  frames, and step back when the load drops (software decoder only,
+     *  live streams and paced playback only: every frame is decoded in
+     *  unthrottled playback; see the overload counters in the decoder
+     *  statistics)
+     * maxQueueDepth : number of queued access units from which the
+     *  decoder is late (0: not used)
+     * maxAuAge : time in microseconds since the demuxer output from which
+     *  an access unit is late (0: not used)
+     */
+    virtual void getDecoderOverloadSettings(bool *enabled, unsigned int *maxQueueDepth, unsigned int *maxAuAge) = 0;
+    virtual void setDecoderOverloadSettings(bool enabled, unsigned int maxQueueDepth, unsigned int maxAuAge) = 0;
+
+    /*
+     * stream profile settings (applied to the next stream open, ignored
+     * for recorded media)
+     *
+     * profile : PDRAW_STREAM_PROFILE_LIVE_LOW_LATENCY sets the software
+     *  decoder to low delay (pictures are output without reordering
+     *  delay, fast decoding, slice threading instead of frame threading)
+     *  and the renderer keeps only the latest decoded frame
+     */
+    virtual void getStreamProfileSettings(pdraw_stream_profile_t *profile) = 0;
+    virtual void setStreamProfileSettings(pdraw_stream_profile_t profile) = 0;
+
+    /*
+     * decoder pool settings (applied to decoders created by the next open)
+     *
+     * shared : decode on the process-wide worker pool shared by all the
+     *  instances instead of a dedicated thread per stream; the streams
+     *  are served in turn one access unit at a time (software decoder
+     *  only; see the decode time in the decoder statistics); blocking
+     *  frame ring producers cannot be added to such decoders
+     */
+    virtual void getDecoderPoolSettings(bool *shared) = 0;
+    virtual void setDecoderPoolSettings(bool shared) = 0;
+
+    /*
+     * decoder backend settings (applied to decoders created by the next open)
+     *
+     * name : backend tried first, the other registered backends are
+     *  then tried by decreasing priority if it cannot handle the media
+     *  or fails to create a decoder (empty: by priority only); built-in
+     *  backends, depending on the build: "amediacodec", "videocoreomx",
+     *  "ffmpeg"
+     */
+    virtual void getDecoderBackendSettings(std::string *name) = 0;
+    virtual void setDecoderBackendSettings(const std::string &name) = 0;
 };
 
 IPdraw *createPdraw();
 
+/*
+ * Set the number of threads of the shared decoder pool (0: one per CPU);
+ * applied when the pool is next started, i.e. when no decoder uses it
+ */
+int setDecoderPoolWorkerCount(unsigned int count);
+
+/*
+ * Set the priority of a decoder backend for all the instances; backends
+ * with a higher priority are tried first (defaults: 200 for
+ * "amediacodec", 100 for "videocoreomx", 0 for "ffmpeg")
+ */
+int setAvcDecoderPriority(const std::string &name, int priority);
+
 }
 
 #endif /* !_PDRAW_HPP_ */
@@ -42,6 +42,14 @@
 #include <inttypes.h>
 
 
+/* Playback speed limits and special value for recorded media; negative
+ * speeds (from -PDRAW_PLAYBACK_SPEED_MAX to -PDRAW_PLAYBACK_SPEED_MIN)
+ * play backward */
+#define PDRAW_PLAYBACK_SPEED_MIN (0.25f)
+#define PDRAW_PLAYBACK_SPEED_MAX (16.f)
+#define PDRAW_PLAYBACK_SPEED_UNTHROTTLED (0.f)
+
+
 typedef enum
 {
     PDRAW_DRONE_MODEL_UNKNOWN = 0,
@@ -82,10 +90,35 @@ typedef enum
     PDRAW_COLOR_FORMAT_UNKNOWN = 0,
     PDRAW_COLOR_FORMAT_YUV420PLANAR,
     PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR,
+    PDRAW_COLOR_FORMAT_RGB24,
+    PDRAW_COLOR_FORMAT_BGR24,
+    PDRAW_COLOR_FORMAT_RGBA,
+    PDRAW_COLOR_FORMAT_GRAY,
 
 } pdraw_color_format_t;
 
 
+/* YUV to RGB conversion matrix; AUTO selects BT.709 for HD frames
+ * (720 lines and above) and BT.601 otherwise */
+typedef enum
+{
+    PDRAW_COLOR_MATRIX_AUTO = 0,
+    PDRAW_COLOR_MATRIX_BT601,
+    PDRAW_COLOR_MATRIX_BT709,
+
+} pdraw_color_matrix_t;
+
+
+typedef struct
+{
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+
+} pdraw_rect_t;
+
+
 typedef enum
 {
     PDRAW_VIDEO_TYPE_DEFAULT_CAMERA = 0,
@@ -128,6 +161,24 @@ typedef enum
 } pdraw_followme_anim_t;
 
 
+typedef enum
+{
+    PDRAW_DECODER_THREAD_TYPE_NONE = 0,
+    PDRAW_DECODER_THREAD_TYPE_FRAME,
+    PDRAW_DECODER_THREAD_TYPE_SLICE,
+    PDRAW_DECODER_THREAD_TYPE_AUTO,
+
+} pdraw_decoder_thread_type_t;
+
+
+typedef enum
+{
+    PDRAW_STREAM_PROFILE_DEFAULT = 0,
+    PDRAW_STREAM_PROFILE_LIVE_LOW_LATENCY, /* no reordering delay, fast decoding, frames presented as soon as decoded */
+
+} pdraw_stream_profile_t;
+
+
 typedef struct
 {
     pdraw_video_type_t type;
@@ -229,6 +280,47 @@ typedef struct
 } pdraw_video_frame_metadata_t;
 
 
+typedef struct
+{
+    unsigned int inputBufferCount;
+    unsigned int inputBufferSize;
+    unsigned int inputBufferUsedCount;
+    unsigned int inputBufferMaxUsedCount;
+    unsigned int inputBufferGrowCount;
+    unsigned int maxAuSize;
+    unsigned int outputBufferCount;
+    unsigned int outputBufferUsedCount;
+    unsigned int outputBufferMaxUsedCount;
+    unsigned int outputQueueCount;
+    unsigned int outputQueueDropCount; /* frames dropped by full output queues */
+    unsigned int framePoolCount;
+    unsigned int framePoolFrameSize;
+    unsigned int framePoolUsedCount;
+    unsigned int framePoolMaxUsedCount;
+    unsigned int framePoolExhaustedCount;
+    unsigned int overloadLevel; /* 0: normal, 1: non-ref frames dropped, 2: no loop filter, 3: key frames only */
+    unsigned int overloadCount; /* transitions from normal to overloaded */
+    unsigned int overloadNonRefSkipCount; /* non-ref AUs dropped before decoding */
+    unsigned int overloadLoopFilterSkipCount; /* AUs decoded without loop filter */
+    unsigned int overloadNonKeySkipCount; /* AUs submitted while only key frames are decoded */
+    unsigned int decodeCount;
+    unsigned int decodeTimeAvg; /* microseconds */
+    unsigned int decodeTimeMax; /* microseconds */
+    unsigned int decoderPoolWorkerCount; /* 0: dedicated decoding thread */
+
+} pdraw_decoder_stats_t;
+
+
+typedef struct
+{
+    uint64_t timestamp;
+    unsigned int frameIndex;
+    int hasMetadata;
+    pdraw_video_frame_metadata_t metadata;
+
+} pdraw_keyframe_t;
+
+
 typedef struct
 {
     pdraw_color_format_t colorFormat;
@@ -255,4 +347,34 @@ typedef struct
 typedef void (*pdraw_video_frame_filter_callback_t)(void *filterCtx, const pdraw_video_frame_t *frame, void *userPtr);
 
 
+typedef enum
+{
+    PDRAW_FRAME_RING_OVERFLOW_DROP_OLDEST = 0,
+    PDRAW_FRAME_RING_OVERFLOW_BLOCK,
+
+} pdraw_frame_ring_overflow_policy_t;
+
+
+typedef struct
+{
+    unsigned int frameCount;
+    unsigned int ringSize;
+    unsigned int ringDepth;
+    unsigned int ringMaxDepth;
+    unsigned int ringOverflowCount;
+    unsigned int queueDropCount;
+    unsigned int processCount; /* frames copied, scaled or converted */
+    unsigned int processTimeAvgUs;
+    unsigned int processTimeMaxUs;
+    unsigned int callbackThreadCount;
+    unsigned int callbackCount;
+    unsigned int callbackQueueDepth;
+    unsigned int callbackQueueMaxDepth;
+    unsigned int callbackDropCount;
+    unsigned int callbackTimeAvgUs;
+    unsigned int callbackTimeMaxUs;
+
+} pdraw_video_frame_producer_stats_t;
+
+
 #endif /* !_PDRAW_DEFS_H_ */
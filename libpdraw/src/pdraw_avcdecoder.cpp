@@ -40,22 +40,268 @@
 #include "pdraw_avcdecoder_ffmpeg.hpp"
 #include "pdraw_avcdecoder_videocoreomx.hpp"
 #include "pdraw_avcdecoder_amediacodec.hpp"
+#include "pdraw_avcdecoder_fallback.hpp"
+#include "pdraw_media_video.hpp"
+#include "pdraw_session.hpp"
+#include "pdraw_settings.hpp"
+
+#include <string.h>
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+/* hardware decoders are preferred */
+#define AVC_DECODER_PRIORITY_AMEDIACODEC 200
+#define AVC_DECODER_PRIORITY_VIDEOCOREOMX 100
+#define AVC_DECODER_PRIORITY_FFMPEG 0
+#define AVC_DECODER_VIDEOCOREOMX_MAX_WIDTH 1920
+#define AVC_DECODER_VIDEOCOREOMX_MAX_HEIGHT 1088
 
 
 namespace Pdraw
 {
 
-AvcDecoder *AvcDecoder::create(VideoMedia *media)
+
+#ifdef USE_AMEDIACODEC
+static AvcDecoder *createAMediaCodecAvcDecoder(VideoMedia *media)
 {
-#if defined(USE_AMEDIACODEC)
     return new AMediaCodecAvcDecoder(media);
-#elif defined(USE_VIDEOCOREOMX)
+}
+#endif /* USE_AMEDIACODEC */
+
+
+#ifdef USE_VIDEOCOREOMX
+static AvcDecoder *createVideoCoreOmxAvcDecoder(VideoMedia *media)
+{
     return new VideoCoreOmxAvcDecoder(media);
-#elif defined(USE_FFMPEG)
+}
+#endif /* USE_VIDEOCOREOMX */
+
+
+#ifdef USE_FFMPEG
+static AvcDecoder *createFfmpegAvcDecoder(VideoMedia *media)
+{
     return new FfmpegAvcDecoder(media);
-#else
+}
+#endif /* USE_FFMPEG */
+
+
+AvcDecoder *AvcDecoder::create(VideoMedia *media)
+{
+    std::string name = SETTINGS_DECODER_BACKEND;
+
+    if ((media) && (media->getSession()) && (media->getSession()->getSettings()))
+    {
+        media->getSession()->getSettings()->getDecoderBackendSettings(&name);
+    }
+
+    return AvcDecoderRegistry::getInstance()->create(media, name);
+}
+
+
+AvcDecoderRegistry *AvcDecoderRegistry::getInstance()
+{
+    static AvcDecoderRegistry instance;
+    return &instance;
+}
+
+
+AvcDecoderRegistry::AvcDecoderRegistry()
+{
+    pthread_mutex_init(&mMutex, NULL);
+
+    avc_decoder_capabilities_t caps;
+
+#ifdef USE_AMEDIACODEC
+    memset(&caps, 0, sizeof(caps));
+    caps.isHardware = true;
+    registerBackend("amediacodec", AVC_DECODER_PRIORITY_AMEDIACODEC, &caps, createAMediaCodecAvcDecoder);
+#endif /* USE_AMEDIACODEC */
+
+#ifdef USE_VIDEOCOREOMX
+    memset(&caps, 0, sizeof(caps));
+    caps.maxWidth = AVC_DECODER_VIDEOCOREOMX_MAX_WIDTH;
+    caps.maxHeight = AVC_DECODER_VIDEOCOREOMX_MAX_HEIGHT;
+    caps.isHardware = true;
+    registerBackend("videocoreomx", AVC_DECODER_PRIORITY_VIDEOCOREOMX, &caps, createVideoCoreOmxAvcDecoder);
+#endif /* USE_VIDEOCOREOMX */
+
+#ifdef USE_FFMPEG
+    memset(&caps, 0, sizeof(caps));
+    registerBackend("ffmpeg", AVC_DECODER_PRIORITY_FFMPEG, &caps, createFfmpegAvcDecoder);
+#endif /* USE_FFMPEG */
+}
+
+
+AvcDecoderRegistry::~AvcDecoderRegistry()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+
+int AvcDecoderRegistry::registerBackend(const std::string &name, int priority,
+                                        const avc_decoder_capabilities_t *caps,
+                                        avc_decoder_factory_t factory)
+{
+    if ((name.length() == 0) || (!caps) || (!factory))
+    {
+        ULOGE("AvcDecoderRegistry: invalid backend");
+        return -1;
+    }
+
+    avc_decoder_registry_entry_t entry;
+    entry.name = name;
+    entry.priority = priority;
+    entry.caps = *caps;
+    entry.factory = factory;
+
+    pthread_mutex_lock(&mMutex);
+    removeBackend(name);
+    insertBackend(&entry);
+    pthread_mutex_unlock(&mMutex);
+
+    ULOGI("AvcDecoderRegistry: registered backend '%s' (priority %d)", name.c_str(), priority);
+
+    return 0;
+}
+
+
+int AvcDecoderRegistry::setPriority(const std::string &name, int priority)
+{
+    avc_decoder_registry_entry_t entry;
+
+    pthread_mutex_lock(&mMutex);
+
+    if (!removeBackend(name, &entry))
+    {
+        pthread_mutex_unlock(&mMutex);
+        ULOGE("AvcDecoderRegistry: backend '%s' not found", name.c_str());
+        return -1;
+    }
+    entry.priority = priority;
+    insertBackend(&entry);
+
+    pthread_mutex_unlock(&mMutex);
+
+    ULOGI("AvcDecoderRegistry: backend '%s' priority set to %d", name.c_str(), priority);
+
+    return 0;
+}
+
+
+bool AvcDecoderRegistry::removeBackend(const std::string &name, avc_decoder_registry_entry_t *entry)
+{
+    std::vector<avc_decoder_registry_entry_t>::iterator b;
+    for (b = mBackends.begin(); b != mBackends.end(); b++)
+    {
+        if (b->name == name)
+        {
+            if (entry)
+                *entry = *b;
+            mBackends.erase(b);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void AvcDecoderRegistry::insertBackend(const avc_decoder_registry_entry_t *entry)
+{
+    /* Sorted by decreasing priority, in registration order for equal priorities */
+    std::vector<avc_decoder_registry_entry_t>::iterator b;
+    for (b = mBackends.begin(); b != mBackends.end(); b++)
+    {
+        if (b->priority < entry->priority)
+            break;
+    }
+    mBackends.insert(b, *entry);
+}
+
+
+AvcDecoder *AvcDecoderRegistry::create(VideoMedia *media, const std::string &name)
+{
+    std::vector<avc_decoder_registry_entry_t> chain;
+    std::vector<avc_decoder_registry_entry_t>::iterator b;
+
+    /* The decoders are created without the lock */
+    pthread_mutex_lock(&mMutex);
+    for (b = mBackends.begin(); b != mBackends.end(); b++)
+    {
+        if (b->name == name)
+            chain.insert(chain.begin(), *b);
+        else
+            chain.push_back(*b);
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    if ((name.length() > 0) && ((chain.size() == 0) || (chain.front().name != name)))
+    {
+        ULOGW("AvcDecoderRegistry: backend '%s' not found", name.c_str());
+    }
+
+    AvcDecoder *decoder = createBackend(media, &chain);
+    if (!decoder)
+    {
+        ULOGE("AvcDecoderRegistry: no usable decoder backend");
+        return NULL;
+    }
+
+    /* The remaining backends are kept for a fallback on configuration
+     * failures */
+    if (chain.size() > 0)
+    {
+        AvcDecoder *fallback = new FallbackAvcDecoder(media, decoder, chain);
+        if (fallback == NULL)
+        {
+            ULOGE("AvcDecoderRegistry: fallback decoder allocation failed");
+            delete decoder;
+            return NULL;
+        }
+        decoder = fallback;
+    }
+
+    return decoder;
+}
+
+
+AvcDecoder *AvcDecoderRegistry::createBackend(VideoMedia *media,
+                                              std::vector<avc_decoder_registry_entry_t> *chain)
+{
+    unsigned int width = 0, height = 0;
+
+    if (media)
+    {
+        media->getDimensions(&width, &height, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    }
+
+    while (chain->size() > 0)
+    {
+        avc_decoder_registry_entry_t b = chain->front();
+        chain->erase(chain->begin());
+
+        /* Unknown dimensions (live stream before the SPS) are not checked */
+        if (((b.caps.maxWidth > 0) && (width > b.caps.maxWidth)) ||
+            ((b.caps.maxHeight > 0) && (height > b.caps.maxHeight)))
+        {
+            ULOGI("AvcDecoderRegistry: backend '%s' does not support %dx%d", b.name.c_str(), width, height);
+            continue;
+        }
+
+        AvcDecoder *decoder = b.factory(media);
+        if ((decoder) && (decoder->isValid()))
+        {
+            ULOGI("AvcDecoderRegistry: using backend '%s'", b.name.c_str());
+            return decoder;
+        }
+
+        ULOGW("AvcDecoderRegistry: backend '%s' failed to create a decoder", b.name.c_str());
+        delete decoder;
+    }
+
     return NULL;
-#endif
 }
 
 }
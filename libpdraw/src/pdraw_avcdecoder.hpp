@@ -40,11 +40,20 @@
 #define _PDRAW_AVCDECODER_HPP_
 
 #include <inttypes.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <pdraw/pdraw_defs.h>
 #include "pdraw_decoder.hpp"
 #include "pdraw_buffer.hpp"
 #include "pdraw_metadata_videoframe.hpp"
 
 
+/* inline user data slot of the decoder buffers; larger user data
+ * falls back to a heap allocation */
+#define AVCDECODER_USER_DATA_BUFFER_SIZE 1024
+
+
 namespace Pdraw
 {
 
@@ -63,6 +72,12 @@ typedef struct
     bool isComplete;
     bool hasErrors;
     bool isRef;
+    bool isSilent; /* decoded but not output */
+    bool isCached; /* decoded and kept in the frame cache, not output */
+    bool isCacheOutput; /* no data: output the cached frame with the same timestamp */
+    bool isDiscontinuity; /* first AU after a seek: the pictures held by the decoder are dropped */
+    bool isEndOfStream; /* no data: output the pictures held by the decoder */
+    bool isRealTime; /* live or paced playback: may be degraded when the decoder is late */
     uint64_t auNtpTimestamp;
     uint64_t auNtpTimestampRaw;
     uint64_t auNtpTimestampLocal;
@@ -107,14 +122,46 @@ public:
 
     virtual avc_decoder_color_format_t getOutputColorFormat() = 0;
 
+    /* Frame cache support (reverse playback and frame stepping) */
+    virtual bool isFrameCacheSupported() = 0;
+
+    /* Number of AUs to queue after a frame for it to be output without
+     * draining the decoder (reordering and frame threading delays) */
+    virtual unsigned int getOutputDelay() = 0;
+
+    /* Number of frames of the given dimensions that the frame cache can
+     * hold (memory budget and frames left for decoding) */
+    virtual unsigned int getFrameCacheMaxCount(unsigned int width, unsigned int height) = 0;
+
+    /* End of stream support (the pictures held by the decoder are output) */
+    virtual bool isEndOfStreamSupported() = 0;
+
+    /* The backend initialization succeeded; otherwise the registry
+     * deletes the decoder and falls back to the next backend */
+    virtual bool isValid() = 0;
+
     virtual int getInputBuffer(Buffer **buffer, bool blocking) = 0;
 
     virtual int queueInputBuffer(Buffer *buffer) = 0;
 
-    virtual BufferQueue *addOutputQueue() = 0;
+    /* Grow an input buffer that is too small for an access unit; the next
+     * input buffers are grown to at least the same capacity */
+    virtual int growInputBuffer(Buffer *buffer, unsigned int capacity) = 0;
+
+    /* Each consumer has its own output queue: maxDepth bounds the number
+     * of frames waiting in the queue and policy tells what to do when it
+     * is full, so that a slow consumer does not starve the others */
+    virtual BufferQueue *addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy) = 0;
 
     virtual int removeOutputQueue(BufferQueue *queue) = 0;
 
+    /* Output queue handover to another decoder (backend fallback): the
+     * queue is flushed and removed without being deleted, or an existing
+     * queue is added */
+    virtual int detachOutputQueue(BufferQueue *queue) = 0;
+
+    virtual int attachOutputQueue(BufferQueue *queue) = 0;
+
     virtual int dequeueOutputBuffer(BufferQueue *queue, Buffer **buffer, bool blocking) = 0;
 
     virtual int releaseOutputBuffer(Buffer *buffer) = 0;
@@ -123,6 +170,13 @@ public:
 
     virtual VideoMedia *getVideoMedia() = 0;
 
+    virtual int getStats(pdraw_decoder_stats_t *stats) = 0;
+
+    /* Decoder doing the actual decoding (the current backend when the
+     * decoder falls back on configuration failures) */
+    virtual AvcDecoder *getBackend() { return this; };
+
+    /* Create a decoder from the registry (see AvcDecoderRegistry) */
     static AvcDecoder *create(VideoMedia *media);
 
 protected:
@@ -130,6 +184,74 @@ protected:
     virtual bool isOutputQueueValid(BufferQueue *queue) = 0;
 };
 
+
+typedef struct
+{
+    unsigned int maxWidth; /* 0: no limit */
+    unsigned int maxHeight; /* 0: no limit */
+    bool isHardware;
+
+} avc_decoder_capabilities_t;
+
+
+typedef AvcDecoder *(*avc_decoder_factory_t)(VideoMedia *media);
+
+
+typedef struct
+{
+    std::string name;
+    int priority;
+    avc_decoder_capabilities_t caps;
+    avc_decoder_factory_t factory;
+
+} avc_decoder_registry_entry_t;
+
+
+/*
+ * Process-wide list of the decoder backends built in the library,
+ * registered at startup; applications can change their priority through
+ * the public API. A decoder is created by trying the preferred backend
+ * first, then the others by decreasing priority, skipping the backends
+ * that cannot handle the media dimensions or fail to initialize; if the
+ * created decoder cannot be configured for the stream, it falls back to
+ * the next backends (see FallbackAvcDecoder).
+ */
+class AvcDecoderRegistry
+{
+public:
+
+    static AvcDecoderRegistry *getInstance();
+
+    /* A backend with the same name is replaced */
+    int registerBackend(const std::string &name, int priority,
+                        const avc_decoder_capabilities_t *caps,
+                        avc_decoder_factory_t factory);
+
+    int setPriority(const std::string &name, int priority);
+
+    /* name: preferred backend (empty: by priority only) */
+    AvcDecoder *create(VideoMedia *media, const std::string &name);
+
+    /* Create a decoder from the first usable backend of the chain; the
+     * backends tried are removed from the chain */
+    static AvcDecoder *createBackend(VideoMedia *media,
+                                     std::vector<avc_decoder_registry_entry_t> *chain);
+
+private:
+
+    AvcDecoderRegistry();
+
+    ~AvcDecoderRegistry();
+
+    /* Called with the mutex held */
+    bool removeBackend(const std::string &name, avc_decoder_registry_entry_t *entry = NULL);
+
+    void insertBackend(const avc_decoder_registry_entry_t *entry);
+
+    pthread_mutex_t mMutex;
+    std::vector<avc_decoder_registry_entry_t> mBackends;
+};
+
 }
 
 #endif /* !_PDRAW_AVCDECODER_HPP_ */
@@ -42,6 +42,7 @@
 #ifdef USE_AMEDIACODEC
 
 #include <unistd.h>
+#include <string.h>
 #include <time.h>
 
 #define ULOG_TAG libpdraw
@@ -60,6 +61,7 @@ AMediaCodecAvcDecoder::AMediaCodecAvcDecoder(VideoMedia *media)
     mOutputColorFormat = AVCDECODER_COLORFORMAT_UNKNOWN;
     mMedia = (Media*)media;
     mInputBufferPool = NULL;
+    mMaxAuSize = 0;
     mInputBufferQueue = NULL;
     mOutputBufferPool = NULL;
     mWidth = 0;
@@ -74,15 +76,22 @@ AMediaCodecAvcDecoder::AMediaCodecAvcDecoder(VideoMedia *media)
     mSarHeight = 0;
 
     mCodec = AMediaCodec_createDecoderByType(PDRAW_AMEDIACODEC_MIME_TYPE);
+    if (mCodec == NULL)
+    {
+        ULOGE("AMediaCodec: AMediaCodec_createDecoderByType() failed");
+    }
 }
 
 
 AMediaCodecAvcDecoder::~AMediaCodecAvcDecoder()
 {
-    media_status_t err = AMediaCodec_delete(mCodec);
-    if (err != AMEDIA_OK)
+    if (mCodec)
     {
-        ULOGE("AMediaCodec: AMediaCodec_delete() failed (%d)", err);
+        media_status_t err = AMediaCodec_delete(mCodec);
+        if (err != AMEDIA_OK)
+        {
+            ULOGE("AMediaCodec: AMediaCodec_delete() failed (%d)", err);
+        }
     }
 
     if (mInputBufferQueue) delete mInputBufferQueue;
@@ -189,8 +198,9 @@ int AMediaCodecAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize,
     if (ret == 0)
     {
         mInputBufferPool = new BufferPool(AMEDIACODEC_AVC_DECODER_INPUT_BUFFER_COUNT, 0,
-                                          sizeof(avc_decoder_input_buffer_t), 0,
-                                          NULL, NULL); //TODO: number of buffers
+                                          sizeof(avc_decoder_input_buffer_t),
+                                          AVCDECODER_USER_DATA_BUFFER_SIZE,
+                                          NULL, NULL, NULL, false); //TODO: number of buffers
         if (mInputBufferPool == NULL)
         {
             ULOGE("AMediaCodec: failed to allocate decoder input buffers pool");
@@ -213,8 +223,9 @@ int AMediaCodecAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize,
     if (ret == 0)
     {
         mOutputBufferPool = new BufferPool(AMEDIACODEC_AVC_DECODER_OUTPUT_BUFFER_COUNT, 0,
-                                           sizeof(avc_decoder_output_buffer_t), 0,
-                                           NULL, NULL); //TODO: number of buffers
+                                           sizeof(avc_decoder_output_buffer_t),
+                                           AVCDECODER_USER_DATA_BUFFER_SIZE,
+                                           NULL, NULL, NULL, false); //TODO: number of buffers
         if (mOutputBufferPool == NULL)
         {
             ULOGE("AMediaCodec: failed to allocate decoder output buffers pool");
@@ -328,6 +339,11 @@ int AMediaCodecAvcDecoder::queueInputBuffer(Buffer *buffer)
         return -1;
     }
 
+    if (buffer->getSize() > mMaxAuSize)
+    {
+        mMaxAuSize = buffer->getSize();
+    }
+
     if (mInputBufferQueue)
     {
         uint64_t ts = 0;
@@ -361,9 +377,17 @@ int AMediaCodecAvcDecoder::queueInputBuffer(Buffer *buffer)
 }
 
 
-BufferQueue *AMediaCodecAvcDecoder::addOutputQueue()
+int AMediaCodecAvcDecoder::growInputBuffer(Buffer *buffer, unsigned int capacity)
 {
-    BufferQueue *q = new BufferQueue();
+    /* The input buffers are owned by the codec */
+    ULOGW("AMediaCodec: input buffers cannot be grown (%d bytes needed)", capacity);
+    return -1;
+}
+
+
+BufferQueue *AMediaCodecAvcDecoder::addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy)
+{
+    BufferQueue *q = new BufferQueue(maxDepth, policy);
     if (q == NULL)
     {
         ULOGE("AMediaCodec: queue allocation failed");
@@ -386,12 +410,41 @@ int AMediaCodecAvcDecoder::removeOutputQueue(BufferQueue *queue)
     bool found = false;
     std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
 
+    while (q != mOutputBufferQueues.end())
+    {
+        if (*q == queue)
+        {
+            ULOGI("AMediaCodec: output queue removed (%d frames queued, %d dropped)",
+                  queue->getPushCount(), queue->getDropCount());
+            mOutputBufferQueues.erase(q);
+            delete queue;
+            found = true;
+            break;
+        }
+        q++;
+    }
+
+    return (found) ? 0 : -1;
+}
+
+
+int AMediaCodecAvcDecoder::detachOutputQueue(BufferQueue *queue)
+{
+    if (!queue)
+    {
+        ULOGE("AMediaCodec: invalid queue pointer");
+        return -1;
+    }
+
+    bool found = false;
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+
     while (q != mOutputBufferQueues.end())
     {
         if (*q == queue)
         {
             mOutputBufferQueues.erase(q);
-            delete *q;
+            queue->flush();
             found = true;
             break;
         }
@@ -402,6 +455,19 @@ int AMediaCodecAvcDecoder::removeOutputQueue(BufferQueue *queue)
 }
 
 
+int AMediaCodecAvcDecoder::attachOutputQueue(BufferQueue *queue)
+{
+    if (!queue)
+    {
+        ULOGE("AMediaCodec: invalid queue pointer");
+        return -1;
+    }
+
+    mOutputBufferQueues.push_back(queue);
+    return 0;
+}
+
+
 bool AMediaCodecAvcDecoder::isOutputQueueValid(BufferQueue *queue)
 {
     if (!queue)
@@ -509,6 +575,40 @@ int AMediaCodecAvcDecoder::releaseOutputBuffer(Buffer *buffer)
 }
 
 
+int AMediaCodecAvcDecoder::getStats(pdraw_decoder_stats_t *stats)
+{
+    if (!stats)
+    {
+        ULOGE("AMediaCodec: invalid stats pointer");
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(pdraw_decoder_stats_t));
+    stats->maxAuSize = mMaxAuSize;
+    if (mInputBufferPool)
+    {
+        stats->inputBufferCount = mInputBufferPool->getBufferCount();
+        stats->inputBufferUsedCount = mInputBufferPool->getUsedCount();
+        stats->inputBufferMaxUsedCount = mInputBufferPool->getMaxUsedCount();
+    }
+    if (mOutputBufferPool)
+    {
+        stats->outputBufferCount = mOutputBufferPool->getBufferCount();
+        stats->outputBufferUsedCount = mOutputBufferPool->getUsedCount();
+        stats->outputBufferMaxUsedCount = mOutputBufferPool->getMaxUsedCount();
+    }
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        stats->outputQueueCount++;
+        stats->outputQueueDropCount += (*q)->getDropCount();
+        q++;
+    }
+
+    return 0;
+}
+
+
 int AMediaCodecAvcDecoder::stop()
 {
     if (!mConfigured)
@@ -605,8 +705,12 @@ int AMediaCodecAvcDecoder::pollDecoderOutput()
             inputData = (avc_decoder_input_buffer_t*)inputBuffer->getMetadataPtr();
 #endif
 
-        if ((inputBuffer == NULL) || (inputData == NULL))
+        if ((inputBuffer == NULL) || (inputData == NULL) || (inputData->isSilent))
         {
+            if (inputBuffer)
+            {
+                inputBuffer->unref();
+            }
             media_status_t err = AMediaCodec_releaseOutputBuffer(mCodec, bufIdx, false);
             if (err != AMEDIA_OK)
             {
@@ -725,7 +829,10 @@ int AMediaCodecAvcDecoder::pollDecoderOutput()
             while (q != mOutputBufferQueues.end())
             {
                 outputBuffer->ref();
-                (*q)->pushBuffer(outputBuffer);
+                if ((*q)->pushBuffer(outputBuffer) != 0)
+                {
+                    outputBuffer->unref();
+                }
                 q++;
                 pushed = true;
             }
@@ -0,0 +1,213 @@
+/**
+ * @file pdraw_avcdecoder_fallback.cpp
+ * @brief Parrot Drones Awesome Video Viewer Library - AVC decoder backend fallback
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_avcdecoder_fallback.hpp"
+#include "pdraw_media_video.hpp"
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+namespace Pdraw
+{
+
+
+FallbackAvcDecoder::FallbackAvcDecoder(VideoMedia *media, AvcDecoder *backend,
+                                       const std::vector<avc_decoder_registry_entry_t> &fallbacks)
+{
+    mMedia = (Media*)media;
+    mConfigured = false;
+    mBackend = backend;
+    mFallbacks = fallbacks;
+}
+
+
+FallbackAvcDecoder::~FallbackAvcDecoder()
+{
+    delete getBackend();
+
+    std::vector<AvcDecoder*>::iterator b = mRetiredBackends.begin();
+    while (b != mRetiredBackends.end())
+    {
+        delete *b;
+        b++;
+    }
+}
+
+
+int FallbackAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize, const uint8_t *pPps, unsigned int ppsSize)
+{
+    int ret = getBackend()->configure(pSps, spsSize, pPps, ppsSize);
+
+    /* Only the first configuration falls back: no frame has been output
+     * yet and the input and output queues are empty */
+    while ((ret != 0) && (!mConfigured) && (mFallbacks.size() > 0))
+    {
+        AvcDecoder *backend = AvcDecoderRegistry::createBackend(getVideoMedia(), &mFallbacks);
+        if (!backend)
+        {
+            break;
+        }
+        ULOGW("FallbackAvcDecoder: configuration failed (%d), falling back to the next backend", ret);
+        if (switchBackend(backend) != 0)
+        {
+            delete backend;
+            break;
+        }
+        ret = backend->configure(pSps, spsSize, pPps, ppsSize);
+    }
+
+    if (ret == 0)
+    {
+        mConfigured = true;
+        mFallbacks.clear();
+    }
+
+    return ret;
+}
+
+
+int FallbackAvcDecoder::switchBackend(AvcDecoder *backend)
+{
+    AvcDecoder *previous = getBackend();
+    std::vector<BufferQueue*>::iterator q;
+    int ret = 0;
+
+    for (q = mOutputBufferQueues.begin(); q != mOutputBufferQueues.end(); q++)
+    {
+        previous->detachOutputQueue(*q);
+    }
+    for (q = mOutputBufferQueues.begin(); (q != mOutputBufferQueues.end()) && (ret == 0); q++)
+    {
+        ret = backend->attachOutputQueue(*q);
+    }
+
+    if (ret != 0)
+    {
+        /* The queues go back to the previous backend */
+        ULOGE("FallbackAvcDecoder: the output queues cannot be handed over to the next backend");
+        for (q = mOutputBufferQueues.begin(); q != mOutputBufferQueues.end(); q++)
+        {
+            backend->detachOutputQueue(*q);
+            previous->attachOutputQueue(*q);
+        }
+        return -1;
+    }
+
+    previous->stop();
+    mBackend = backend;
+    mRetiredBackends.push_back(previous);
+
+    return 0;
+}
+
+
+BufferQueue *FallbackAvcDecoder::addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy)
+{
+    BufferQueue *queue = getBackend()->addOutputQueue(maxDepth, policy);
+    if (queue)
+    {
+        mOutputBufferQueues.push_back(queue);
+    }
+
+    return queue;
+}
+
+
+int FallbackAvcDecoder::removeOutputQueue(BufferQueue *queue)
+{
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        if (*q == queue)
+        {
+            mOutputBufferQueues.erase(q);
+            break;
+        }
+        q++;
+    }
+
+    return getBackend()->removeOutputQueue(queue);
+}
+
+
+int FallbackAvcDecoder::detachOutputQueue(BufferQueue *queue)
+{
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        if (*q == queue)
+        {
+            mOutputBufferQueues.erase(q);
+            break;
+        }
+        q++;
+    }
+
+    return getBackend()->detachOutputQueue(queue);
+}
+
+
+int FallbackAvcDecoder::attachOutputQueue(BufferQueue *queue)
+{
+    int ret = getBackend()->attachOutputQueue(queue);
+    if (ret == 0)
+    {
+        mOutputBufferQueues.push_back(queue);
+    }
+
+    return ret;
+}
+
+
+bool FallbackAvcDecoder::isOutputQueueValid(BufferQueue *queue)
+{
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        if (*q == queue)
+        {
+            return true;
+        }
+        q++;
+    }
+
+    return false;
+}
+
+}
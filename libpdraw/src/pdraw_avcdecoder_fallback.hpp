@@ -0,0 +1,129 @@
+/**
+ * @file pdraw_avcdecoder_fallback.hpp
+ * @brief Parrot Drones Awesome Video Viewer Library - AVC decoder backend fallback
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_AVCDECODER_FALLBACK_HPP_
+#define _PDRAW_AVCDECODER_FALLBACK_HPP_
+
+#include <vector>
+#include <atomic>
+
+#include "pdraw_avcdecoder.hpp"
+
+
+namespace Pdraw
+{
+
+
+/*
+ * Decoder forwarding to a backend created by the registry; if the first
+ * configuration of the backend fails (unsupported stream), the next
+ * backends of the registry are tried. The output queues are handed over
+ * to the new backend so that the consumers keep their queues; the
+ * previous backends are only deleted with the decoder, as a consumer can
+ * still be calling them.
+ */
+class FallbackAvcDecoder : public AvcDecoder
+{
+public:
+
+    FallbackAvcDecoder(VideoMedia *media, AvcDecoder *backend,
+                       const std::vector<avc_decoder_registry_entry_t> &fallbacks);
+
+    ~FallbackAvcDecoder();
+
+    bool isConfigured() { return getBackend()->isConfigured(); };
+
+    int configure(const uint8_t *pSps, unsigned int spsSize, const uint8_t *pPps, unsigned int ppsSize);
+
+    avc_decoder_color_format_t getOutputColorFormat() { return getBackend()->getOutputColorFormat(); };
+
+    bool isFrameCacheSupported() { return getBackend()->isFrameCacheSupported(); };
+
+    unsigned int getOutputDelay() { return getBackend()->getOutputDelay(); };
+
+    unsigned int getFrameCacheMaxCount(unsigned int width, unsigned int height) { return getBackend()->getFrameCacheMaxCount(width, height); };
+
+    bool isEndOfStreamSupported() { return getBackend()->isEndOfStreamSupported(); };
+
+    bool isValid() { return getBackend()->isValid(); };
+
+    int getInputBuffer(Buffer **buffer, bool blocking) { return getBackend()->getInputBuffer(buffer, blocking); };
+
+    int queueInputBuffer(Buffer *buffer) { return getBackend()->queueInputBuffer(buffer); };
+
+    int growInputBuffer(Buffer *buffer, unsigned int capacity) { return getBackend()->growInputBuffer(buffer, capacity); };
+
+    BufferQueue *addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy);
+
+    int removeOutputQueue(BufferQueue *queue);
+
+    int detachOutputQueue(BufferQueue *queue);
+
+    int attachOutputQueue(BufferQueue *queue);
+
+    int dequeueOutputBuffer(BufferQueue *queue, Buffer **buffer, bool blocking) { return getBackend()->dequeueOutputBuffer(queue, buffer, blocking); };
+
+    int releaseOutputBuffer(Buffer *buffer) { return getBackend()->releaseOutputBuffer(buffer); };
+
+    int stop() { return getBackend()->stop(); };
+
+    Media *getMedia() { return mMedia; };
+
+    VideoMedia *getVideoMedia() { return (VideoMedia*)mMedia; };
+
+    int getStats(pdraw_decoder_stats_t *stats) { return getBackend()->getStats(stats); };
+
+    AvcDecoder *getBackend() { return mBackend.load(); };
+
+protected:
+
+    bool isOutputQueueValid(BufferQueue *queue);
+
+private:
+
+    int switchBackend(AvcDecoder *backend);
+
+    std::atomic<AvcDecoder*> mBackend;
+    std::vector<AvcDecoder*> mRetiredBackends;
+    std::vector<avc_decoder_registry_entry_t> mFallbacks;
+    std::vector<BufferQueue*> mOutputBufferQueues;
+};
+
+}
+
+#endif /* !_PDRAW_AVCDECODER_FALLBACK_HPP_ */
@@ -37,11 +37,16 @@
  */
 
 #include "pdraw_avcdecoder_ffmpeg.hpp"
+#include "pdraw_media_video.hpp"
+#include "pdraw_session.hpp"
+#include "pdraw_settings.hpp"
+#include "pdraw_utils.hpp"
 
 #ifdef USE_FFMPEG
 
 #include <unistd.h>
 #include <time.h>
+#include <limits.h>
 
 #define ULOG_TAG libpdraw
 #include <ulog.h>
@@ -65,6 +70,72 @@ FfmpegAvcDecoder::FfmpegAvcDecoder(VideoMedia *media)
     mOutputBufferPool = NULL;
     mThreadShouldStop = false;
     mDecoderThreadLaunched = false;
+    mDecoderPool = NULL;
+    mDecodeCount = 0;
+    mDecodeTimeTotal = 0;
+    mDecodeTimeMax = 0;
+    mInputBufferCount = FFMPEG_AVC_DECODER_INPUT_BUFFER_COUNT;
+    mInputBufferSize = FFMPEG_AVC_DECODER_INPUT_BUFFER_SIZE;
+    mInputBufferGrowCount = 0;
+    mMaxAuSize = 0;
+    mFrameThreadingDelay = 0;
+    mNextPts = 0;
+    mInputQueueDepth = 0;
+    mOverloadEnabled = SETTINGS_DECODER_OVERLOAD_ENABLED;
+    mOverloadMaxQueueDepth = SETTINGS_DECODER_OVERLOAD_MAX_QUEUE_DEPTH;
+    mOverloadMaxAuAge = SETTINGS_DECODER_OVERLOAD_MAX_AU_AGE;
+    mOverloadLevel = 0;
+    mOverloadLateCount = 0;
+    mOverloadOnTimeCount = 0;
+    mOverloadCount = 0;
+    mOverloadNonRefSkipCount = 0;
+    mOverloadLoopFilterSkipCount = 0;
+    mOverloadNonKeySkipCount = 0;
+    mFrame = NULL;
+    mCodecH264 = NULL;
+    mCodecCtxH264 = NULL;
+    mFrameCacheSize = 0;
+    mFrameCacheMaxSize = SETTINGS_REVERSE_PLAYBACK_CACHE_MAX_SIZE;
+    mFrameCacheDrainPending = false;
+    mFramePool = NULL;
+    mFramePoolMaxSize = SETTINGS_DECODER_FRAME_POOL_MAX_SIZE;
+    mFramePoolExhaustedCount = 0;
+
+    int ret = pthread_mutex_init(&mMutex, NULL);
+    if (ret != 0)
+    {
+        ULOGE("ffmpeg: mutex creation failed (%d)", ret);
+        return;
+    }
+    ret = pthread_cond_init(&mCond, NULL);
+    if (ret != 0)
+    {
+        ULOGE("ffmpeg: cond creation failed (%d)", ret);
+        return;
+    }
+    ret = pthread_mutex_init(&mFramePoolMutex, NULL);
+    if (ret != 0)
+    {
+        ULOGE("ffmpeg: mutex creation failed (%d)", ret);
+        return;
+    }
+
+    unsigned int threadCount = SETTINGS_DECODER_THREAD_COUNT;
+    pdraw_decoder_thread_type_t threadType = SETTINGS_DECODER_THREAD_TYPE;
+    bool sharedPool = SETTINGS_DECODER_POOL_SHARED;
+    bool lowLatency = false;
+    if ((media) && (media->getSession()))
+    {
+        lowLatency = media->getSession()->isLiveLowLatency();
+    }
+    if ((media) && (media->getSession()) && (media->getSession()->getSettings()))
+    {
+        media->getSession()->getSettings()->getDecoderThreadingSettings(&threadCount, &threadType);
+        media->getSession()->getSettings()->getReversePlaybackSettings(&mFrameCacheMaxSize);
+        media->getSession()->getSettings()->getDecoderFramePoolSettings(&mFramePoolMaxSize);
+        media->getSession()->getSettings()->getDecoderOverloadSettings(&mOverloadEnabled, &mOverloadMaxQueueDepth, &mOverloadMaxAuAge);
+        media->getSession()->getSettings()->getDecoderPoolSettings(&sharedPool);
+    }
 
     avcodec_register_all();
     av_log_set_level(FFMPEG_LOG_LEVEL);
@@ -76,7 +147,7 @@ FfmpegAvcDecoder::FfmpegAvcDecoder(VideoMedia *media)
     }
 
     mCodecCtxH264 = avcodec_alloc_context3(mCodecH264);
-    if (NULL == mCodecH264)
+    if (NULL == mCodecCtxH264)
     {
         ULOGE("ffmpeg: failed to allocate codec context");
         return;
@@ -90,6 +161,50 @@ FfmpegAvcDecoder::FfmpegAvcDecoder(VideoMedia *media)
     mCodecCtxH264->codec_type = AVMEDIA_TYPE_VIDEO;
     mCodecCtxH264->codec_id = AV_CODEC_ID_H264;
     mCodecCtxH264->skip_idct = AVDISCARD_DEFAULT;
+    mCodecCtxH264->refcounted_frames = 1;
+
+    /* Live low latency: pictures are output as soon as they are decoded
+     * (the stream must not use B-frames) and frame threading, which
+     * delays the output by one frame per thread, is not used */
+    if (lowLatency)
+    {
+        mCodecCtxH264->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        mCodecCtxH264->flags2 |= AV_CODEC_FLAG2_FAST;
+        if ((threadType == PDRAW_DECODER_THREAD_TYPE_FRAME) || (threadType == PDRAW_DECODER_THREAD_TYPE_AUTO))
+        {
+            threadType = PDRAW_DECODER_THREAD_TYPE_SLICE;
+        }
+        ULOGI("ffmpeg: live low latency profile");
+    }
+
+    /* Decoded pictures are allocated from our frame pool */
+    if (mFramePoolMaxSize > 0)
+    {
+        mCodecCtxH264->opaque = (void*)this;
+        mCodecCtxH264->get_buffer2 = getBuffer2Cb;
+        mCodecCtxH264->thread_safe_callbacks = 1;
+    }
+
+    switch (threadType)
+    {
+        default:
+        case PDRAW_DECODER_THREAD_TYPE_NONE:
+            mCodecCtxH264->thread_count = 1;
+            mCodecCtxH264->thread_type = 0;
+            break;
+        case PDRAW_DECODER_THREAD_TYPE_FRAME:
+            mCodecCtxH264->thread_count = threadCount;
+            mCodecCtxH264->thread_type = FF_THREAD_FRAME;
+            break;
+        case PDRAW_DECODER_THREAD_TYPE_SLICE:
+            mCodecCtxH264->thread_count = threadCount;
+            mCodecCtxH264->thread_type = FF_THREAD_SLICE;
+            break;
+        case PDRAW_DECODER_THREAD_TYPE_AUTO:
+            mCodecCtxH264->thread_count = threadCount;
+            mCodecCtxH264->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+    }
 
     if (avcodec_open2(mCodecCtxH264, mCodecH264, NULL) < 0)
     {
@@ -97,26 +212,67 @@ FfmpegAvcDecoder::FfmpegAvcDecoder(VideoMedia *media)
         return;
     }
 
+    /* With frame-level multi-threading each thread holds one frame,
+     * pictures are output with a delay of (thread_count - 1) frames */
+    if ((mCodecCtxH264->active_thread_type & FF_THREAD_FRAME) && (mCodecCtxH264->thread_count > 1))
+    {
+        mFrameThreadingDelay = mCodecCtxH264->thread_count - 1;
+    }
+    mInputBufferCount = FFMPEG_AVC_DECODER_INPUT_BUFFER_COUNT + mFrameThreadingDelay;
+    ULOGI("ffmpeg: %d decoding thread(s)%s%s", mCodecCtxH264->thread_count,
+          (mCodecCtxH264->active_thread_type & FF_THREAD_FRAME) ? ", frame threading" : "",
+          (mCodecCtxH264->active_thread_type & FF_THREAD_SLICE) ? ", slice threading" : "");
+
     av_init_packet(&mPacket);
 
+    mFrame = av_frame_alloc();
+    if (mFrame == NULL)
+    {
+        ULOGE("ffmpeg: failed to allocate frame");
+        return;
+    }
+
     mFrameWidth = 0;
     mFrameHeight = 0;
 
-    int thErr = pthread_create(&mDecoderThread, NULL, runDecoderThread, (void*)this);
-    if (thErr != 0)
+    /* With the shared pool the AUs are decoded by the pool workers,
+     * otherwise (or if the registration fails) by our own thread */
+    if (sharedPool)
     {
-        ULOGE("ffmpeg: decoder thread creation failed (%d)", thErr);
+        if (DecoderPool::getInstance()->addClient(this) == 0)
+        {
+            mDecoderPool = DecoderPool::getInstance();
+            ULOGI("ffmpeg: decoding on the shared pool (%d workers)", mDecoderPool->getWorkerCount());
+        }
+        else
+        {
+            ULOGW("ffmpeg: failed to join the shared decoder pool");
+        }
     }
-    else
+
+    if (!mDecoderPool)
     {
-        mDecoderThreadLaunched = true;
+        int thErr = pthread_create(&mDecoderThread, NULL, runDecoderThread, (void*)this);
+        if (thErr != 0)
+        {
+            ULOGE("ffmpeg: decoder thread creation failed (%d)", thErr);
+        }
+        else
+        {
+            mDecoderThreadLaunched = true;
+        }
     }
 }
 
 
 FfmpegAvcDecoder::~FfmpegAvcDecoder()
 {
+    pthread_mutex_lock(&mMutex);
     mThreadShouldStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+    if (mInputBufferQueue) mInputBufferQueue->signal();
+
     if (mDecoderThreadLaunched)
     {
         int thErr = pthread_join(mDecoderThread, NULL);
@@ -126,6 +282,17 @@ FfmpegAvcDecoder::~FfmpegAvcDecoder()
         }
     }
 
+    if (mDecoderPool)
+    {
+        /* No job is running after this */
+        mDecoderPool->removeClient(this);
+        mDecoderPool = NULL;
+        flushDecoder();
+    }
+
+    releasePendingInputBuffers(0);
+    clearFrameCache();
+
     if (mInputBufferQueue) delete mInputBufferQueue;
     if (mInputBufferPool) delete mInputBufferPool;
     if (mOutputBufferPool) delete mOutputBufferPool;
@@ -137,7 +304,26 @@ FfmpegAvcDecoder::~FfmpegAvcDecoder()
         q++;
     }
 
+    av_frame_free(&mFrame);
     avcodec_free_context(&mCodecCtxH264);
+
+    /* All the pictures have been released with the codec context */
+    pthread_mutex_lock(&mFramePoolMutex);
+    if (mFramePool)
+    {
+        mRetiredFramePools.push_back(mFramePool);
+        mFramePool = NULL;
+    }
+    deleteRetiredFramePools();
+    if (mRetiredFramePools.size() > 0)
+    {
+        ULOGE("ffmpeg: %zu frame pool(s) still in use", mRetiredFramePools.size());
+    }
+    pthread_mutex_unlock(&mFramePoolMutex);
+
+    pthread_mutex_destroy(&mMutex);
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mFramePoolMutex);
 }
 
 
@@ -153,13 +339,30 @@ int FfmpegAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize, const
 
     /* Nothing to decode here for ffmpeg: SPS/PPS will be decoded with the first picture */
 
+    /* Size the input buffers from the SPS: an access unit cannot exceed
+     * the level limits and the pictures held for reordering keep their
+     * input buffers until they are output */
+    unsigned int maxAuSize = 0, reorderDepth = 0;
+    if (pdraw_bufferRequirementsFromH264Sps(pSps, spsSize, &maxAuSize, &reorderDepth) == 0)
+    {
+        mInputBufferSize = maxAuSize + spsSize + ppsSize + 8;
+        mInputBufferCount += reorderDepth;
+        ULOGI("ffmpeg: %d input buffers of %d bytes (reorder depth %d)",
+              mInputBufferCount, mInputBufferSize, reorderDepth);
+    }
+    else
+    {
+        ULOGW("ffmpeg: failed to get the buffer requirements from the SPS, using defaults");
+    }
+
     /* Input buffers pool allocation */
     if (ret == 0)
     {
-        mInputBufferPool = new BufferPool(FFMPEG_AVC_DECODER_INPUT_BUFFER_COUNT,
-                                          FFMPEG_AVC_DECODER_INPUT_BUFFER_SIZE,
-                                          sizeof(avc_decoder_input_buffer_t), 0,
-                                          NULL, NULL); //TODO: number of buffers and buffers size
+        mInputBufferPool = new BufferPool(mInputBufferCount,
+                                          mInputBufferSize,
+                                          sizeof(avc_decoder_input_buffer_t),
+                                          AVCDECODER_USER_DATA_BUFFER_SIZE,
+                                          NULL, NULL, NULL, true);
         if (mInputBufferPool == NULL)
         {
             ULOGE("ffmpeg: failed to allocate decoder input buffers pool");
@@ -170,7 +373,7 @@ int FfmpegAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize, const
     /* Input buffers queue allocation */
     if (ret == 0)
     {
-        mInputBufferQueue = new BufferQueue();
+        mInputBufferQueue = new SpscBufferQueue(mInputBufferCount);
         if (mInputBufferQueue == NULL)
         {
             ULOGE("ffmpeg: failed to allocate decoder input buffers queue");
@@ -182,8 +385,10 @@ int FfmpegAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize, const
     if (ret == 0)
     {
         mOutputBufferPool = new BufferPool(FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT, 0,
-                                           sizeof(avc_decoder_output_buffer_t), 0,
-                                           outputBufferCreationCb, outputBufferDeletionCb); //TODO: number of buffers
+                                           sizeof(avc_decoder_output_buffer_t),
+                                           AVCDECODER_USER_DATA_BUFFER_SIZE,
+                                           outputBufferCreationCb, outputBufferDeletionCb,
+                                           outputBufferReleaseCb, false); //TODO: number of buffers
         if (mOutputBufferPool == NULL)
         {
             ULOGE("ffmpeg: failed to allocate decoder output buffers pool");
@@ -191,7 +396,11 @@ int FfmpegAvcDecoder::configure(const uint8_t *pSps, unsigned int spsSize, const
         }
     }
 
+    /* Wake up the decoder thread */
+    pthread_mutex_lock(&mMutex);
     mConfigured = (ret == 0) ? true : false;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
 
     if (mConfigured)
     {
@@ -221,6 +430,11 @@ int FfmpegAvcDecoder::getInputBuffer(Buffer **buffer, bool blocking)
         Buffer *buf = mInputBufferPool->getBuffer(blocking);
         if (buf != NULL)
         {
+            /* Buffers are grown lazily after an oversized access unit */
+            if ((buf->getCapacity() < mInputBufferSize) && (buf->growCapacity(mInputBufferSize) < 0))
+            {
+                ULOGW("ffmpeg: failed to grow the input buffer to %d bytes", mInputBufferSize);
+            }
             buf->setSize(0);
             *buffer = buf;
         }
@@ -254,10 +468,26 @@ int FfmpegAvcDecoder::queueInputBuffer(Buffer *buffer)
         return -1;
     }
 
+    if (buffer->getSize() > mMaxAuSize)
+    {
+        mMaxAuSize = buffer->getSize();
+    }
+
     if (mInputBufferQueue)
     {
+        /* The depth is counted before the push: the decoder can dequeue
+         * the buffer (and decrement the depth) as soon as it is pushed */
         buffer->ref();
-        mInputBufferQueue->pushBuffer(buffer);
+        mInputQueueDepth++;
+        if (mInputBufferQueue->pushBuffer(buffer) != 0)
+        {
+            ULOGE("ffmpeg: failed to queue the input buffer");
+            mInputQueueDepth--;
+            buffer->unref();
+            return -1;
+        }
+        if (mDecoderPool)
+            mDecoderPool->notify(this);
     }
     else
     {
@@ -269,9 +499,54 @@ int FfmpegAvcDecoder::queueInputBuffer(Buffer *buffer)
 }
 
 
-BufferQueue *FfmpegAvcDecoder::addOutputQueue()
+int FfmpegAvcDecoder::growInputBuffer(Buffer *buffer, unsigned int capacity)
+{
+    if (!buffer)
+    {
+        ULOGE("ffmpeg: invalid buffer pointer");
+        return -1;
+    }
+
+    if (capacity > FFMPEG_AVC_DECODER_INPUT_BUFFER_MAX_SIZE)
+    {
+        ULOGE("ffmpeg: input buffer size %d exceeds the maximum size", capacity);
+        return -1;
+    }
+
+    if (buffer->growCapacity(capacity) < 0)
+    {
+        ULOGE("ffmpeg: failed to grow the input buffer to %d bytes", capacity);
+        return -1;
+    }
+
+    /* The other buffers are grown when they are next dequeued */
+    if (capacity > mInputBufferSize)
+    {
+        ULOGI("ffmpeg: input buffer size %d -> %d bytes", mInputBufferSize, capacity);
+        mInputBufferSize = capacity;
+        mInputBufferGrowCount++;
+    }
+
+    return 0;
+}
+
+
+BufferQueue *FfmpegAvcDecoder::addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy)
 {
-    BufferQueue *q = new BufferQueue();
+    /* The decoder thread is the only producer and each output queue
+     * has a single consumer */
+    if ((mDecoderPool) && (policy == BUFFER_QUEUE_OVERFLOW_BLOCK))
+    {
+        /* A blocked push would hold a shared worker and stall the
+         * decoding of the other sessions */
+        ULOGE("ffmpeg: blocking output queues are not supported with the shared decoder pool");
+        return NULL;
+    }
+    if ((maxDepth == 0) || (maxDepth > FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT))
+    {
+        maxDepth = FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT;
+    }
+    BufferQueue *q = new SpscBufferQueue(maxDepth, policy);
     if (q == NULL)
     {
         ULOGE("ffmpeg: queue allocation failed");
@@ -294,12 +569,41 @@ int FfmpegAvcDecoder::removeOutputQueue(BufferQueue *queue)
     bool found = false;
     std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
 
+    while (q != mOutputBufferQueues.end())
+    {
+        if (*q == queue)
+        {
+            ULOGI("ffmpeg: output queue removed (%d frames queued, %d dropped)",
+                  queue->getPushCount(), queue->getDropCount());
+            mOutputBufferQueues.erase(q);
+            delete queue;
+            found = true;
+            break;
+        }
+        q++;
+    }
+
+    return (found) ? 0 : -1;
+}
+
+
+int FfmpegAvcDecoder::detachOutputQueue(BufferQueue *queue)
+{
+    if (!queue)
+    {
+        ULOGE("ffmpeg: invalid queue pointer");
+        return -1;
+    }
+
+    bool found = false;
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+
     while (q != mOutputBufferQueues.end())
     {
         if (*q == queue)
         {
             mOutputBufferQueues.erase(q);
-            delete *q;
+            queue->flush();
             found = true;
             break;
         }
@@ -310,6 +614,25 @@ int FfmpegAvcDecoder::removeOutputQueue(BufferQueue *queue)
 }
 
 
+int FfmpegAvcDecoder::attachOutputQueue(BufferQueue *queue)
+{
+    if (!queue)
+    {
+        ULOGE("ffmpeg: invalid queue pointer");
+        return -1;
+    }
+
+    if ((mDecoderPool) && (queue->getOverflowPolicy() == BUFFER_QUEUE_OVERFLOW_BLOCK))
+    {
+        ULOGE("ffmpeg: blocking output queues are not supported with the shared decoder pool");
+        return -1;
+    }
+
+    mOutputBufferQueues.push_back(queue);
+    return 0;
+}
+
+
 bool FfmpegAvcDecoder::isOutputQueueValid(BufferQueue *queue)
 {
     if (!queue)
@@ -389,13 +712,65 @@ int FfmpegAvcDecoder::releaseOutputBuffer(Buffer *buffer)
         return -1;
     }
 
-    if (!mConfigured)
+    /* Output buffers can still be held by consumers after the decoder
+     * is stopped; the frame reference is released once the last consumer
+     * releases the buffer (see outputBufferReleaseCb) */
+    buffer->unref();
+
+    return 0;
+}
+
+
+int FfmpegAvcDecoder::getStats(pdraw_decoder_stats_t *stats)
+{
+    if (!stats)
     {
-        ULOGE("ffmpeg: decoder is not configured");
+        ULOGE("ffmpeg: invalid stats pointer");
         return -1;
     }
 
-    buffer->unref();
+    memset(stats, 0, sizeof(pdraw_decoder_stats_t));
+    stats->inputBufferSize = mInputBufferSize;
+    stats->inputBufferGrowCount = mInputBufferGrowCount;
+    stats->maxAuSize = mMaxAuSize;
+    if (mInputBufferPool)
+    {
+        stats->inputBufferCount = mInputBufferPool->getBufferCount();
+        stats->inputBufferUsedCount = mInputBufferPool->getUsedCount();
+        stats->inputBufferMaxUsedCount = mInputBufferPool->getMaxUsedCount();
+    }
+    if (mOutputBufferPool)
+    {
+        stats->outputBufferCount = mOutputBufferPool->getBufferCount();
+        stats->outputBufferUsedCount = mOutputBufferPool->getUsedCount();
+        stats->outputBufferMaxUsedCount = mOutputBufferPool->getMaxUsedCount();
+    }
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        stats->outputQueueCount++;
+        stats->outputQueueDropCount += (*q)->getDropCount();
+        q++;
+    }
+    stats->framePoolExhaustedCount = mFramePoolExhaustedCount;
+    stats->overloadLevel = mOverloadLevel;
+    stats->overloadCount = mOverloadCount;
+    stats->overloadNonRefSkipCount = mOverloadNonRefSkipCount;
+    stats->overloadLoopFilterSkipCount = mOverloadLoopFilterSkipCount;
+    stats->overloadNonKeySkipCount = mOverloadNonKeySkipCount;
+    stats->decodeCount = mDecodeCount;
+    stats->decodeTimeAvg = (mDecodeCount > 0) ? (unsigned int)(mDecodeTimeTotal / mDecodeCount) : 0;
+    stats->decodeTimeMax = mDecodeTimeMax;
+    stats->decoderPoolWorkerCount = (mDecoderPool) ? mDecoderPool->getWorkerCount() : 0;
+    pthread_mutex_lock(&mFramePoolMutex);
+    if (mFramePool)
+    {
+        stats->framePoolCount = mFramePool->pool->getBufferCount();
+        stats->framePoolFrameSize = mFramePool->frameSize;
+        stats->framePoolUsedCount = mFramePool->pool->getUsedCount();
+        stats->framePoolMaxUsedCount = mFramePool->pool->getMaxUsedCount();
+    }
+    pthread_mutex_unlock(&mFramePoolMutex);
 
     return 0;
 }
@@ -409,13 +784,24 @@ int FfmpegAvcDecoder::stop()
         return -1;
     }
 
+    pthread_mutex_lock(&mMutex);
     mThreadShouldStop = true;
     mConfigured = false;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
 
     if (mInputBufferPool) mInputBufferPool->signal();
     if (mOutputBufferPool) mOutputBufferPool->signal();
     if (mInputBufferQueue) mInputBufferQueue->signal();
 
+    /* Wake up the consumers waiting for output buffers */
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        (*q)->signal();
+        q++;
+    }
+
     return 0;
 }
 
@@ -461,6 +847,253 @@ int FfmpegAvcDecoder::outputBufferDeletionCb(Buffer *buffer)
 }
 
 
+int FfmpegAvcDecoder::outputBufferReleaseCb(Buffer *buffer)
+{
+    if (buffer == NULL)
+    {
+        ULOGE("ffmpeg: invalid buffer");
+        return -1;
+    }
+
+    AVFrame *avFrame = (AVFrame*)buffer->getResPtr();
+    if (avFrame == NULL)
+    {
+        ULOGE("ffmpeg: invalid ressource pointer");
+        return -1;
+    }
+
+    av_frame_unref(avFrame);
+    return 0;
+}
+
+
+int FfmpegAvcDecoder::getBuffer2Cb(AVCodecContext *ctx, AVFrame *frame, int flags)
+{
+    FfmpegAvcDecoder *decoder = (FfmpegAvcDecoder*)ctx->opaque;
+
+    /* Only the YUV 4:2:0 planar frames are allocated from the pool */
+    if ((decoder == NULL) ||
+        ((frame->format != AV_PIX_FMT_YUV420P) && (frame->format != AV_PIX_FMT_YUVJ420P)))
+    {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    int width = frame->width, height = frame->height;
+    int linesizeAlign[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &width, &height, linesizeAlign);
+
+    pthread_mutex_lock(&decoder->mFramePoolMutex);
+
+    ffmpeg_avc_decoder_frame_pool_t *framePool = decoder->mFramePool;
+    if ((framePool == NULL) || (framePool->width != width) || (framePool->height != height))
+    {
+        if (decoder->createFramePool(width, height) != 0)
+        {
+            pthread_mutex_unlock(&decoder->mFramePoolMutex);
+            return AVERROR(ENOMEM);
+        }
+        framePool = decoder->mFramePool;
+    }
+
+    Buffer *buffer = framePool->pool->getBuffer(false);
+    if (buffer == NULL)
+    {
+        /* Do not allocate more than the memory cap */
+        pthread_mutex_unlock(&decoder->mFramePoolMutex);
+        decoder->mFramePoolExhaustedCount++;
+        ULOGW("ffmpeg: frame pool exhausted (%d frames of %d bytes)",
+              framePool->pool->getBufferCount(), framePool->frameSize);
+        return AVERROR(ENOMEM);
+    }
+    framePool->frameCount++;
+    buffer->setResPtr((void*)framePool);
+
+    pthread_mutex_unlock(&decoder->mFramePoolMutex);
+
+    uint8_t *base = (uint8_t*)buffer->getPtr();
+    frame->buf[0] = av_buffer_create(base, framePool->frameSize, frameBufferFreeCb, (void*)buffer, 0);
+    if (frame->buf[0] == NULL)
+    {
+        ULOGE("ffmpeg: failed to create the frame buffer reference");
+        frameBufferFreeCb((void*)buffer, base);
+        return AVERROR(ENOMEM);
+    }
+
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        frame->data[i] = base + framePool->offset[i];
+        frame->linesize[i] = framePool->stride[i];
+    }
+    frame->extended_data = frame->data;
+
+    return 0;
+}
+
+
+void FfmpegAvcDecoder::frameBufferFreeCb(void *opaque, uint8_t *data)
+{
+    Buffer *buffer = (Buffer*)opaque;
+    ffmpeg_avc_decoder_frame_pool_t *framePool = (ffmpeg_avc_decoder_frame_pool_t*)buffer->getResPtr();
+
+    /* The pool is not touched anymore once the count is decremented */
+    buffer->unref();
+    framePool->frameCount--;
+}
+
+
+unsigned int FfmpegAvcDecoder::getFramePoolFrameSize(int width, int height,
+                                                    unsigned int *stride, unsigned int *offset)
+{
+    /* The strides and planes are aligned for SIMD access and texture
+     * upload; padding is left after the last plane for overreads */
+    unsigned int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    stride[0] = (width + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+    stride[1] = stride[2] = (chromaWidth + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+    offset[0] = 0;
+    offset[1] = offset[0] + stride[0] * height;
+    offset[2] = offset[1] + stride[1] * chromaHeight;
+
+    return offset[2] + stride[2] * chromaHeight + BUFFER_ALIGNMENT;
+}
+
+
+unsigned int FfmpegAvcDecoder::getFramePoolReserve()
+{
+    /* Frames that must stay available for decoding: the reference
+     * frames and the frames being decoded by the threads */
+    return FFMPEG_AVC_DECODER_MAX_REF_FRAMES + 1 + mFrameThreadingDelay;
+}
+
+
+unsigned int FfmpegAvcDecoder::getFramePoolCount(unsigned int frameSize)
+{
+    /* The decoder also needs the frames held by the output buffers; the
+     * memory cap is exceeded rather than starving the decoder */
+    unsigned int minCount = getFramePoolReserve() + FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT;
+    unsigned int count = mFramePoolMaxSize / frameSize;
+
+    return (count < minCount) ? minCount : count;
+}
+
+
+unsigned int FfmpegAvcDecoder::getFrameCacheMaxCount(unsigned int width, unsigned int height)
+{
+    /* Same frame size as accounted for by cacheFrame() */
+    unsigned int frameSize = width * height * 3 / 2;
+    if (frameSize == 0)
+    {
+        return 0;
+    }
+    unsigned int count = mFrameCacheMaxSize / frameSize;
+
+    /* The cached frames are taken from the frame pool, minus the frames
+     * needed for decoding and for the output buffers */
+    if (mFramePoolMaxSize > 0)
+    {
+        unsigned int stride[3], offset[3], poolCount;
+        pthread_mutex_lock(&mFramePoolMutex);
+        if (mFramePool)
+        {
+            poolCount = mFramePool->pool->getBufferCount();
+        }
+        else
+        {
+            poolCount = getFramePoolCount(getFramePoolFrameSize(width, height, stride, offset));
+        }
+        pthread_mutex_unlock(&mFramePoolMutex);
+        unsigned int reserve = getFramePoolReserve() + FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT;
+        poolCount = (poolCount > reserve) ? poolCount - reserve : 0;
+        if (poolCount < count)
+        {
+            count = poolCount;
+        }
+    }
+
+    return count;
+}
+
+
+int FfmpegAvcDecoder::createFramePool(int width, int height)
+{
+    unsigned int stride[3], offset[3];
+    unsigned int frameSize = getFramePoolFrameSize(width, height, stride, offset);
+    unsigned int count = getFramePoolCount(frameSize);
+    if ((uint64_t)count * frameSize > mFramePoolMaxSize)
+    {
+        ULOGW("ffmpeg: frame pool memory cap (%d bytes) is too small for %dx%d frames, "
+              "the pool is raised to the minimum of %d frames",
+              mFramePoolMaxSize, width, height, count);
+    }
+
+    ffmpeg_avc_decoder_frame_pool_t *framePool = new ffmpeg_avc_decoder_frame_pool_t;
+    if (framePool == NULL)
+    {
+        ULOGE("ffmpeg: frame pool allocation failed");
+        return -1;
+    }
+    framePool->pool = new BufferPool(count, frameSize, 0, 0, NULL, NULL, NULL, true);
+    if (framePool->pool == NULL)
+    {
+        ULOGE("ffmpeg: frame pool allocation failed");
+        delete framePool;
+        return -1;
+    }
+    framePool->width = width;
+    framePool->height = height;
+    framePool->frameSize = frameSize;
+    memcpy(framePool->offset, offset, sizeof(offset));
+    memcpy(framePool->stride, stride, sizeof(stride));
+    framePool->frameCount = 0;
+
+    /* The previous pool is deleted when all its frames are released */
+    if (mFramePool)
+    {
+        mRetiredFramePools.push_back(mFramePool);
+    }
+    mFramePool = framePool;
+    deleteRetiredFramePools();
+
+    ULOGI("ffmpeg: frame pool of %d frames of %dx%d (%d bytes)", count, width, height, frameSize);
+
+    return 0;
+}
+
+
+void FfmpegAvcDecoder::deleteRetiredFramePools()
+{
+    std::vector<ffmpeg_avc_decoder_frame_pool_t*>::iterator p = mRetiredFramePools.begin();
+    while (p != mRetiredFramePools.end())
+    {
+        if ((*p)->frameCount == 0)
+        {
+            delete (*p)->pool;
+            delete *p;
+            p = mRetiredFramePools.erase(p);
+        }
+        else
+        {
+            p++;
+        }
+    }
+}
+
+
+unsigned int FfmpegAvcDecoder::getFramePoolFreeCount()
+{
+    unsigned int count = UINT_MAX;
+
+    pthread_mutex_lock(&mFramePoolMutex);
+    if (mFramePool)
+    {
+        count = mFramePool->pool->getBufferCount() - mFramePool->pool->getUsedCount();
+    }
+    pthread_mutex_unlock(&mFramePoolMutex);
+
+    return count;
+}
+
+
 void* FfmpegAvcDecoder::runDecoderThread(void *ptr)
 {
     FfmpegAvcDecoder *decoder = (FfmpegAvcDecoder*)ptr;
@@ -470,7 +1103,6 @@ void* FfmpegAvcDecoder::runDecoderThread(void *ptr)
         if (decoder->mConfigured)
         {
             Buffer *inputBuffer;
-            Buffer *outputBuffer;
             inputBuffer = decoder->mInputBufferQueue->popBuffer(true);
             if (inputBuffer == NULL)
             {
@@ -478,40 +1110,70 @@ void* FfmpegAvcDecoder::runDecoderThread(void *ptr)
             }
             else
             {
-                outputBuffer = decoder->mOutputBufferPool->getBuffer(false);
-                if (outputBuffer != NULL)
-                {
-                    int ret = decoder->decode(inputBuffer, outputBuffer);
-                    if (ret == 0)
-                    {
-                        std::vector<BufferQueue*>::iterator q = decoder->mOutputBufferQueues.begin();
-                        while (q != decoder->mOutputBufferQueues.end())
-                        {
-                            outputBuffer->ref();
-                            (*q)->pushBuffer(outputBuffer);
-                            q++;
-                        }
-                    }
-                    outputBuffer->unref();
-                }
-                else
-                {
-                    ULOGW("ffmpeg: failed to get an output buffer");
-                }
-                inputBuffer->unref();
+                decoder->decodeInputBuffer(inputBuffer);
             }
         }
         else
         {
-            usleep(5000); //TODO: do something better (cond?)
+            /* Wait for the decoder to be configured */
+            pthread_mutex_lock(&decoder->mMutex);
+            while ((!decoder->mConfigured) && (!decoder->mThreadShouldStop))
+            {
+                pthread_cond_wait(&decoder->mCond, &decoder->mMutex);
+            }
+            pthread_mutex_unlock(&decoder->mMutex);
         }
     }
 
+    /* The pictures still held by the decoder are dropped and their
+     * input buffers returned */
+    decoder->flushDecoder();
+
     return NULL;
 }
 
 
-int FfmpegAvcDecoder::decode(Buffer *inputBuffer, Buffer *outputBuffer)
+bool FfmpegAvcDecoder::runPoolJob()
+{
+    if ((mThreadShouldStop) || (!mConfigured))
+    {
+        /* Notified again by the next queueInputBuffer() */
+        return false;
+    }
+
+    Buffer *inputBuffer = mInputBufferQueue->popBuffer(false);
+    if (inputBuffer == NULL)
+    {
+        return false;
+    }
+
+    decodeInputBuffer(inputBuffer);
+
+    return (mInputQueueDepth > 0);
+}
+
+
+void FfmpegAvcDecoder::decodeInputBuffer(Buffer *inputBuffer)
+{
+    struct timespec t1, t2;
+
+    mInputQueueDepth--;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    decode(inputBuffer);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    inputBuffer->unref();
+
+    uint64_t decodeTime = ((uint64_t)t2.tv_sec * 1000000 + (uint64_t)t2.tv_nsec / 1000)
+        - ((uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000);
+    mDecodeCount++;
+    mDecodeTimeTotal += decodeTime;
+    if (decodeTime > mDecodeTimeMax)
+        mDecodeTimeMax = (unsigned int)decodeTime;
+}
+
+
+int FfmpegAvcDecoder::decode(Buffer *inputBuffer)
 {
     if (!mConfigured)
     {
@@ -519,93 +1181,506 @@ int FfmpegAvcDecoder::decode(Buffer *inputBuffer, Buffer *outputBuffer)
         return -1;
     }
 
-    int frameFinished = false;
     avc_decoder_input_buffer_t *inputData = (avc_decoder_input_buffer_t*)inputBuffer->getMetadataPtr();
-    avc_decoder_output_buffer_t *outputData = (avc_decoder_output_buffer_t*)outputBuffer->getMetadataPtr();
-    AVFrame *frame = (AVFrame*)outputBuffer->getResPtr();
-    if ((!inputData) || (!outputData) || (!frame))
+    if ((!inputData) || (!mFrame))
+    {
+        ULOGE("ffmpeg: invalid input buffer");
+        return -1;
+    }
+
+    /* Frame cache output request: no data to decode */
+    if (inputData->isCacheOutput)
+    {
+        Buffer *outputBuffer = NULL;
+        int ret = outputCachedFrame(inputBuffer, &outputBuffer);
+        if (ret == 0)
+        {
+            pushOutputBuffer(outputBuffer);
+        }
+        return ret;
+    }
+
+    /* End of stream: no data, the pictures held by the decoder are output */
+    if (inputData->isEndOfStream)
+    {
+        drainDecoder(true);
+        return 0;
+    }
+
+    /* Seek: the pictures of the previous position are not output */
+    if (inputData->isDiscontinuity)
+    {
+        flushDecoder();
+    }
+
+    if (inputData->isCached)
+    {
+        mFrameCacheDrainPending = true;
+    }
+    else if ((!inputData->isSilent) && (mFrameCache.size() > 0))
+    {
+        /* Back to regular playback: the cached frames are not needed anymore */
+        clearFrameCache();
+    }
+
+    /* Silent non-reference frames are not needed to decode the next ones */
+    if ((inputData->isSilent) && (!inputData->isRef))
     {
-        ULOGE("ffmpeg: invalid input or output buffer");
         return -1;
     }
 
+    if ((mOverloadEnabled) && (!inputData->isSilent) && (!inputData->isCached))
+    {
+        updateOverloadLevel(inputData);
+
+        /* Under overload the non-reference frames are dropped first */
+        if ((mOverloadLevel >= 1) && (!inputData->isRef))
+        {
+            mOverloadNonRefSkipCount++;
+            return -1;
+        }
+        if (mOverloadLevel >= 2)
+        {
+            mOverloadLoopFilterSkipCount++;
+        }
+        if (mOverloadLevel >= 3)
+        {
+            mOverloadNonKeySkipCount++;
+        }
+    }
+
+    /* The input buffer is kept until the corresponding picture is output
+     * (the decoder can output pictures with a delay when frame threading
+     * or reordering is used, and any number of pictures per packet);
+     * the packet timestamp is returned by ffmpeg in the output frames
+     * and identifies the input buffer */
+    ffmpeg_avc_decoder_pending_input_t pending;
+    pending.pts = mNextPts++;
+    pending.buffer = inputBuffer;
+    inputBuffer->ref();
+    mPendingInputBuffers.push_back(pending);
+
     mPacket.data = (uint8_t*)inputBuffer->getPtr();
     mPacket.size = inputBuffer->getSize();
+    mPacket.pts = pending.pts;
+    mPacket.dts = AV_NOPTS_VALUE;
+
+    int ret = avcodec_send_packet(mCodecCtxH264, &mPacket);
+    if (ret == AVERROR(EAGAIN))
+    {
+        /* The decoder output is full: get the pictures and retry */
+        receiveFrames(true);
+        ret = avcodec_send_packet(mCodecCtxH264, &mPacket);
+    }
+    if (ret < 0)
+    {
+        ULOGW("ffmpeg: avcodec_send_packet() failed (%d)", ret);
+    }
+
+    receiveFrames(true);
+
+    /* Pictures that were not output (errors, frames dropped by the decoder)
+     * must not hold input buffers forever */
+    unsigned int maxPending = mFrameThreadingDelay + mCodecCtxH264->has_b_frames + 1;
+    if (maxPending > mInputBufferCount - 2)
+    {
+        maxPending = mInputBufferCount - 2;
+    }
+    releasePendingInputBuffers(maxPending);
+
+    return (ret < 0) ? -1 : 0;
+}
+
 
-    avcodec_decode_video2(mCodecCtxH264, frame, &frameFinished, &mPacket);
+void FfmpegAvcDecoder::receiveFrames(bool output)
+{
+    int ret;
 
-    if (frameFinished)
+    while ((ret = avcodec_receive_frame(mCodecCtxH264, mFrame)) == 0)
     {
-        if ((mFrameWidth != (uint32_t)mCodecCtxH264->width)
-                || (mFrameHeight != (uint32_t)mCodecCtxH264->height))
+        int64_t pts = (mFrame->pts != AV_NOPTS_VALUE) ? mFrame->pts : mFrame->best_effort_timestamp;
+        Buffer *frameInputBuffer = takePendingInputBuffer(pts);
+        if (frameInputBuffer == NULL)
         {
-            mFrameWidth = mCodecCtxH264->width;
-            mFrameHeight = mCodecCtxH264->height;
-            mSarWidth = (mCodecCtxH264->sample_aspect_ratio.num > 0) ? mCodecCtxH264->sample_aspect_ratio.num : 1;
-            mSarHeight = (mCodecCtxH264->sample_aspect_ratio.den > 0) ? mCodecCtxH264->sample_aspect_ratio.den : 1;
+            ULOGW("ffmpeg: failed to find the input buffer of the output frame");
+            av_frame_unref(mFrame);
+            continue;
         }
-        outputBuffer->setMetadataSize(sizeof(avc_decoder_output_buffer_t));
-        outputData->plane[0] = frame->data[0];
-        outputData->plane[1] = frame->data[1];
-        outputData->plane[2] = frame->data[2];
-        outputData->stride[0] = frame->linesize[0];
-        outputData->stride[1] = frame->linesize[1];
-        outputData->stride[2] = frame->linesize[2];
-        outputData->width = mFrameWidth;
-        outputData->height = mFrameHeight;
-        outputData->sarWidth = mSarWidth;
-        outputData->sarHeight = mSarHeight;
-        outputData->colorFormat = AVCDECODER_COLORFORMAT_YUV420PLANAR;
-
-        outputData->isComplete = inputData->isComplete;
-        outputData->hasErrors = inputData->hasErrors;
-        outputData->isRef = inputData->isRef;
-        outputData->auNtpTimestamp = inputData->auNtpTimestamp;
-        outputData->auNtpTimestampRaw = inputData->auNtpTimestampRaw;
-        outputData->auNtpTimestampLocal = inputData->auNtpTimestampLocal;
-        outputData->demuxOutputTimestamp = inputData->demuxOutputTimestamp;
 
-        if (inputData->hasMetadata)
+        avc_decoder_input_buffer_t *inputData = (avc_decoder_input_buffer_t*)frameInputBuffer->getMetadataPtr();
+        if (inputData->isCached)
         {
-            memcpy(&outputData->metadata, &inputData->metadata, sizeof(video_frame_metadata_t));
-            outputData->hasMetadata = true;
+            cacheFrame(mFrame, frameInputBuffer);
         }
-        else
+        else if ((inputData->isSilent) || (!output))
         {
-            outputData->hasMetadata = false;
+            av_frame_unref(mFrame);
         }
-
-        /* User data */
-        unsigned int userDataSize = inputBuffer->getUserDataSize();
-        void *userData = inputBuffer->getUserDataPtr();
-        if ((userData) && (userDataSize > 0))
+        else
         {
-            int ret = outputBuffer->setUserDataCapacity(userDataSize);
-            if (ret < (signed)userDataSize)
-            {
-                ULOGE("ffmpeg: failed to realloc user data buffer");
-            }
-            else
+            Buffer *outputBuffer = NULL;
+            if (outputFrame(mFrame, inputData, frameInputBuffer->getUserDataPtr(),
+                            frameInputBuffer->getUserDataSize(), &outputBuffer) == 0)
             {
-                void *dstBuf = outputBuffer->getUserDataPtr();
-                memcpy(dstBuf, userData, userDataSize);
-                outputBuffer->setUserDataSize(userDataSize);
+                pushOutputBuffer(outputBuffer);
             }
         }
-        else
+        frameInputBuffer->unref();
+    }
+
+    if ((ret != AVERROR(EAGAIN)) && (ret != AVERROR_EOF))
+    {
+        ULOGW("ffmpeg: avcodec_receive_frame() failed (%d)", ret);
+    }
+}
+
+
+unsigned int FfmpegAvcDecoder::getOutputDelay()
+{
+    return mFrameThreadingDelay + ((mCodecCtxH264) ? mCodecCtxH264->has_b_frames : 0);
+}
+
+
+void FfmpegAvcDecoder::drainDecoder(bool output)
+{
+    /* Get the pictures held by the decoder (reordering and frame
+     * threading delays); the decoder is then flushed and restarts
+     * on the next sync sample */
+    int ret = avcodec_send_packet(mCodecCtxH264, NULL);
+    if ((ret < 0) && (ret != AVERROR_EOF))
+    {
+        ULOGW("ffmpeg: avcodec_send_packet() failed (%d)", ret);
+    }
+    else
+    {
+        receiveFrames(output);
+    }
+
+    flushDecoder();
+}
+
+
+void FfmpegAvcDecoder::flushDecoder()
+{
+    avcodec_flush_buffers(mCodecCtxH264);
+    releasePendingInputBuffers(0);
+}
+
+
+void FfmpegAvcDecoder::pushOutputBuffer(Buffer *outputBuffer)
+{
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        outputBuffer->ref();
+        if ((*q)->pushBuffer(outputBuffer) != 0)
         {
-            outputBuffer->setUserDataSize(0);
+            outputBuffer->unref();
         }
+        q++;
+    }
+    outputBuffer->unref();
+}
 
-        return 0;
+
+void FfmpegAvcDecoder::updateOverloadLevel(const avc_decoder_input_buffer_t *inputData)
+{
+    /* The decoder is late when too many AUs are waiting or when the AU
+     * has waited too long since the demuxer output */
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    uint64_t curTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+    uint64_t auAge = ((inputData->demuxOutputTimestamp) && (curTime > inputData->demuxOutputTimestamp)) ?
+        curTime - inputData->demuxOutputTimestamp : 0;
+    unsigned int queueDepth = mInputQueueDepth;
+    bool late = (((mOverloadMaxQueueDepth) && (queueDepth >= mOverloadMaxQueueDepth))
+        || ((mOverloadMaxAuAge) && (auAge >= mOverloadMaxAuAge)));
+    bool onTime = ((queueDepth <= 1) && ((!mOverloadMaxAuAge) || (auAge < mOverloadMaxAuAge / 2)));
+    unsigned int level = mOverloadLevel;
+
+    if (!inputData->isRealTime)
+    {
+        /* No deadline (unthrottled playback): the input queue is kept
+         * full on purpose and every frame must be decoded */
+        level = 0;
+        mOverloadLateCount = 0;
+        mOverloadOnTimeCount = 0;
+    }
+    else if (late)
+    {
+        mOverloadOnTimeCount = 0;
+        if (level == 0)
+        {
+            level = 1;
+            mOverloadCount++;
+        }
+        else if ((++mOverloadLateCount >= FFMPEG_AVC_DECODER_OVERLOAD_ESCALATE_COUNT)
+            && (level < FFMPEG_AVC_DECODER_OVERLOAD_LEVEL_MAX))
+        {
+            level++;
+            mOverloadLateCount = 0;
+        }
     }
     else
     {
-        ULOGI("ffmpeg: frame not complete");
+        mOverloadLateCount = 0;
+        if ((onTime) && (level > 0) && (++mOverloadOnTimeCount >= FFMPEG_AVC_DECODER_OVERLOAD_RECOVER_COUNT))
+        {
+            level--;
+            mOverloadOnTimeCount = 0;
+        }
+    }
+
+    if (level == mOverloadLevel)
+    {
+        return;
+    }
+
+    /* Level 1: drop the non-reference frames;
+     * level 2: also skip the loop filter;
+     * level 3: also decode only the key frames */
+    mCodecCtxH264->skip_loop_filter = (level >= 2) ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+    mCodecCtxH264->skip_frame = (level >= 3) ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    ULOGI("ffmpeg: overload level %d -> %d (queue depth %d, AU age %.1fms)",
+          mOverloadLevel, level, queueDepth, (float)auAge / 1000.);
+    mOverloadLevel = level;
+}
+
+
+int FfmpegAvcDecoder::outputFrame(AVFrame *frame, const avc_decoder_input_buffer_t *inputData,
+                                  const void *userData, unsigned int userDataSize, Buffer **outputBuffer)
+{
+    /* The decoded frame is a new reference; it is moved to the output
+     * buffer, which keeps it until the last consumer releases the buffer */
+    Buffer *outBuf = mOutputBufferPool->getBuffer(false);
+    if (outBuf == NULL)
+    {
+        ULOGW("ffmpeg: failed to get an output buffer");
+        av_frame_unref(frame);
+        return -2;
+    }
+    avc_decoder_output_buffer_t *outputData = (avc_decoder_output_buffer_t*)outBuf->getMetadataPtr();
+    AVFrame *outputFrame = (AVFrame*)outBuf->getResPtr();
+    if ((!outputData) || (!outputFrame))
+    {
+        ULOGE("ffmpeg: invalid output buffer");
+        av_frame_unref(frame);
+        outBuf->unref();
         return -1;
     }
+    av_frame_move_ref(outputFrame, frame);
+    frame = outputFrame;
+
+    if ((mFrameWidth != (uint32_t)mCodecCtxH264->width)
+            || (mFrameHeight != (uint32_t)mCodecCtxH264->height))
+    {
+        mFrameWidth = mCodecCtxH264->width;
+        mFrameHeight = mCodecCtxH264->height;
+        mSarWidth = (mCodecCtxH264->sample_aspect_ratio.num > 0) ? mCodecCtxH264->sample_aspect_ratio.num : 1;
+        mSarHeight = (mCodecCtxH264->sample_aspect_ratio.den > 0) ? mCodecCtxH264->sample_aspect_ratio.den : 1;
+    }
+    outBuf->setMetadataSize(sizeof(avc_decoder_output_buffer_t));
+    outputData->plane[0] = frame->data[0];
+    outputData->plane[1] = frame->data[1];
+    outputData->plane[2] = frame->data[2];
+    outputData->stride[0] = frame->linesize[0];
+    outputData->stride[1] = frame->linesize[1];
+    outputData->stride[2] = frame->linesize[2];
+    outputData->width = mFrameWidth;
+    outputData->height = mFrameHeight;
+    outputData->sarWidth = mSarWidth;
+    outputData->sarHeight = mSarHeight;
+    outputData->colorFormat = AVCDECODER_COLORFORMAT_YUV420PLANAR;
+
+    outputData->isComplete = inputData->isComplete;
+    outputData->hasErrors = inputData->hasErrors;
+    outputData->isRef = inputData->isRef;
+    outputData->auNtpTimestamp = inputData->auNtpTimestamp;
+    outputData->auNtpTimestampRaw = inputData->auNtpTimestampRaw;
+    outputData->auNtpTimestampLocal = inputData->auNtpTimestampLocal;
+    outputData->demuxOutputTimestamp = inputData->demuxOutputTimestamp;
+
+    if (inputData->hasMetadata)
+    {
+        memcpy(&outputData->metadata, &inputData->metadata, sizeof(video_frame_metadata_t));
+        outputData->hasMetadata = true;
+    }
+    else
+    {
+        outputData->hasMetadata = false;
+    }
+
+    /* User data */
+    if ((userData) && (userDataSize > 0))
+    {
+        int ret = outBuf->setUserDataCapacity(userDataSize);
+        if (ret < (signed)userDataSize)
+        {
+            ULOGE("ffmpeg: failed to realloc user data buffer");
+        }
+        else
+        {
+            void *dstBuf = outBuf->getUserDataPtr();
+            memcpy(dstBuf, userData, userDataSize);
+            outBuf->setUserDataSize(userDataSize);
+        }
+    }
+    else
+    {
+        outBuf->setUserDataSize(0);
+    }
+
+    *outputBuffer = outBuf;
+
+    return 0;
 }
 
+
+Buffer *FfmpegAvcDecoder::takePendingInputBuffer(int64_t pts)
+{
+    std::vector<ffmpeg_avc_decoder_pending_input_t>::iterator p = mPendingInputBuffers.begin();
+    while (p != mPendingInputBuffers.end())
+    {
+        if (p->pts == pts)
+        {
+            Buffer *buffer = p->buffer;
+            mPendingInputBuffers.erase(p);
+            return buffer;
+        }
+        p++;
+    }
+
+    return NULL;
+}
+
+
+void FfmpegAvcDecoder::releasePendingInputBuffers(unsigned int maxCount)
+{
+    while (mPendingInputBuffers.size() > maxCount)
+    {
+        Buffer *buffer = mPendingInputBuffers.front().buffer;
+        mPendingInputBuffers.erase(mPendingInputBuffers.begin());
+        buffer->unref();
+    }
+}
+
+
+int FfmpegAvcDecoder::cacheFrame(AVFrame *frame, Buffer *inputBuffer)
+{
+    ffmpeg_avc_decoder_cached_frame_t cached;
+
+    cached.frame = av_frame_alloc();
+    if (cached.frame == NULL)
+    {
+        ULOGE("ffmpeg: avFrame allocation failed");
+        av_frame_unref(frame);
+        return -1;
+    }
+    av_frame_move_ref(cached.frame, frame);
+
+    /* The input buffer is not kept (the demuxer needs it back): copy its
+     * metadata and user data */
+    memcpy(&cached.data, inputBuffer->getMetadataPtr(), sizeof(avc_decoder_input_buffer_t));
+    cached.userData = NULL;
+    cached.userDataSize = 0;
+    if ((inputBuffer->getUserDataPtr()) && (inputBuffer->getUserDataSize() > 0))
+    {
+        cached.userData = (uint8_t*)malloc(inputBuffer->getUserDataSize());
+        if (cached.userData)
+        {
+            memcpy(cached.userData, inputBuffer->getUserDataPtr(), inputBuffer->getUserDataSize());
+            cached.userDataSize = inputBuffer->getUserDataSize();
+        }
+    }
+    cached.size = cached.frame->width * cached.frame->height * 3 / 2;
+
+    /* Evict the oldest frames to stay within the memory budget and to
+     * leave enough frames in the pool for decoding; at least one frame
+     * is always kept */
+    unsigned int reserve = getFramePoolReserve();
+    while ((mFrameCache.size() > 0) &&
+           ((mFrameCacheSize + cached.size > mFrameCacheMaxSize) || (getFramePoolFreeCount() < reserve)))
+    {
+        ffmpeg_avc_decoder_cached_frame_t *oldest = &mFrameCache.front();
+        ULOGD("ffmpeg: frame cache full, evicting frame %" PRIu64, oldest->data.auNtpTimestamp);
+        mFrameCacheSize -= oldest->size;
+        av_frame_free(&oldest->frame);
+        free(oldest->userData);
+        mFrameCache.erase(mFrameCache.begin());
+    }
+
+    mFrameCache.push_back(cached);
+    mFrameCacheSize += cached.size;
+
+    return 0;
+}
+
+
+std::vector<ffmpeg_avc_decoder_cached_frame_t>::iterator FfmpegAvcDecoder::findCachedFrame(uint64_t timestamp)
+{
+    std::vector<ffmpeg_avc_decoder_cached_frame_t>::iterator f = mFrameCache.begin();
+    while (f != mFrameCache.end())
+    {
+        if (f->data.auNtpTimestamp == timestamp)
+        {
+            break;
+        }
+        f++;
+    }
+
+    return f;
+}
+
+
+int FfmpegAvcDecoder::outputCachedFrame(Buffer *inputBuffer, Buffer **outputBuffer)
+{
+    avc_decoder_input_buffer_t *inputData = (avc_decoder_input_buffer_t*)inputBuffer->getMetadataPtr();
+
+    std::vector<ffmpeg_avc_decoder_cached_frame_t>::iterator f = findCachedFrame(inputData->auNtpTimestamp);
+
+    /* The frame can still be held by the decoder: it is drained only in
+     * that case, otherwise it keeps its state for the next AUs */
+    if ((f == mFrameCache.end()) && (mFrameCacheDrainPending))
+    {
+        drainDecoder(false);
+        mFrameCacheDrainPending = false;
+        f = findCachedFrame(inputData->auNtpTimestamp);
+    }
+    if (f == mFrameCache.end())
+    {
+        ULOGW("ffmpeg: frame %" PRIu64 " not found in the frame cache", inputData->auNtpTimestamp);
+        return -1;
+    }
+
+    ffmpeg_avc_decoder_cached_frame_t cached = *f;
+    mFrameCache.erase(f);
+    mFrameCacheSize -= cached.size;
+
+    /* The output time is the time of the output request */
+    cached.data.auNtpTimestampLocal = inputData->auNtpTimestampLocal;
+    cached.data.demuxOutputTimestamp = inputData->demuxOutputTimestamp;
+
+    int ret = outputFrame(cached.frame, &cached.data, cached.userData, cached.userDataSize, outputBuffer);
+
+    av_frame_free(&cached.frame);
+    free(cached.userData);
+
+    return ret;
+}
+
+
+void FfmpegAvcDecoder::clearFrameCache()
+{
+    std::vector<ffmpeg_avc_decoder_cached_frame_t>::iterator f = mFrameCache.begin();
+    while (f != mFrameCache.end())
+    {
+        av_frame_free(&f->frame);
+        free(f->userData);
+        f++;
+    }
+    mFrameCache.clear();
+    mFrameCacheSize = 0;
+}
 }
 
 #endif /* USE_FFMPEG */
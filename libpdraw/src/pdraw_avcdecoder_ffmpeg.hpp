@@ -51,18 +51,56 @@ extern "C" {
 #include <pthread.h>
 
 #include "pdraw_avcdecoder.hpp"
+#include "pdraw_decoder_pool.hpp"
 
 
 #define FFMPEG_AVC_DECODER_INPUT_BUFFER_COUNT 5
-#define FFMPEG_AVC_DECODER_INPUT_BUFFER_SIZE 1920 * 1080 / 2
-#define FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT 5
+#define FFMPEG_AVC_DECODER_INPUT_BUFFER_SIZE 1920 * 1080 / 2 /* if the SPS cannot be parsed */
+#define FFMPEG_AVC_DECODER_INPUT_BUFFER_MAX_SIZE 64 * 1024 * 1024
+#define FFMPEG_AVC_DECODER_OUTPUT_BUFFER_COUNT 8
+#define FFMPEG_AVC_DECODER_MAX_REF_FRAMES 16
+#define FFMPEG_AVC_DECODER_OVERLOAD_LEVEL_MAX 3
+#define FFMPEG_AVC_DECODER_OVERLOAD_ESCALATE_COUNT 8 /* consecutive late AUs before the next level */
+#define FFMPEG_AVC_DECODER_OVERLOAD_RECOVER_COUNT 30 /* consecutive on-time AUs before the previous level */
 
 
 namespace Pdraw
 {
 
 
-class FfmpegAvcDecoder : public AvcDecoder
+typedef struct
+{
+    AVFrame *frame;
+    avc_decoder_input_buffer_t data;
+    uint8_t *userData;
+    unsigned int userDataSize;
+    unsigned int size;
+
+} ffmpeg_avc_decoder_cached_frame_t;
+
+
+typedef struct
+{
+    int64_t pts;
+    Buffer *buffer;
+
+} ffmpeg_avc_decoder_pending_input_t;
+
+
+typedef struct
+{
+    BufferPool *pool;
+    int width;
+    int height;
+    unsigned int frameSize;
+    unsigned int offset[3];
+    unsigned int stride[3];
+    std::atomic<unsigned int> frameCount;
+
+} ffmpeg_avc_decoder_frame_pool_t;
+
+
+class FfmpegAvcDecoder : public AvcDecoder, public DecoderPoolClient
 {
 public:
 
@@ -76,14 +114,30 @@ public:
 
     avc_decoder_color_format_t getOutputColorFormat() { return mOutputColorFormat; };
 
+    bool isFrameCacheSupported() { return true; };
+
+    unsigned int getOutputDelay();
+
+    unsigned int getFrameCacheMaxCount(unsigned int width, unsigned int height);
+
+    bool isEndOfStreamSupported() { return true; };
+
+    bool isValid() { return ((mDecoderThreadLaunched) || (mDecoderPool != NULL)); };
+
     int getInputBuffer(Buffer **buffer, bool blocking);
 
     int queueInputBuffer(Buffer *buffer);
 
-    BufferQueue *addOutputQueue();
+    int growInputBuffer(Buffer *buffer, unsigned int capacity);
+
+    BufferQueue *addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy);
 
     int removeOutputQueue(BufferQueue *queue);
 
+    int detachOutputQueue(BufferQueue *queue);
+
+    int attachOutputQueue(BufferQueue *queue);
+
     int dequeueOutputBuffer(BufferQueue *queue, Buffer **buffer, bool blocking);
 
     int releaseOutputBuffer(Buffer *buffer);
@@ -94,6 +148,10 @@ public:
 
     VideoMedia *getVideoMedia() { return (VideoMedia*)mMedia; };
 
+    int getStats(pdraw_decoder_stats_t *stats);
+
+    bool runPoolJob();
+
 private:
 
     bool isOutputQueueValid(BufferQueue *queue);
@@ -102,20 +160,100 @@ private:
 
     static int outputBufferDeletionCb(Buffer *buffer);
 
+    static int outputBufferReleaseCb(Buffer *buffer);
+
     static void* runDecoderThread(void *ptr);
 
-    int decode(Buffer *inputBuffer, Buffer *outputBuffer);
+    void decodeInputBuffer(Buffer *inputBuffer);
+
+    int decode(Buffer *inputBuffer);
+
+    void receiveFrames(bool output);
+
+    void drainDecoder(bool output);
+
+    void flushDecoder();
+
+    void pushOutputBuffer(Buffer *outputBuffer);
+
+    int outputFrame(AVFrame *frame, const avc_decoder_input_buffer_t *inputData,
+                    const void *userData, unsigned int userDataSize, Buffer **outputBuffer);
+
+    Buffer *takePendingInputBuffer(int64_t pts);
+
+    void releasePendingInputBuffers(unsigned int maxCount);
+
+    int cacheFrame(AVFrame *frame, Buffer *inputBuffer);
+
+    std::vector<ffmpeg_avc_decoder_cached_frame_t>::iterator findCachedFrame(uint64_t timestamp);
+
+    int outputCachedFrame(Buffer *inputBuffer, Buffer **outputBuffer);
+
+    void clearFrameCache();
+
+    static int getBuffer2Cb(AVCodecContext *ctx, AVFrame *frame, int flags);
+
+    static void frameBufferFreeCb(void *opaque, uint8_t *data);
+
+    static unsigned int getFramePoolFrameSize(int width, int height,
+                                              unsigned int *stride, unsigned int *offset);
+
+    unsigned int getFramePoolReserve();
+
+    unsigned int getFramePoolCount(unsigned int frameSize);
+
+    int createFramePool(int width, int height);
+
+    void deleteRetiredFramePools();
+
+    unsigned int getFramePoolFreeCount();
+
+    void updateOverloadLevel(const avc_decoder_input_buffer_t *inputData);
 
     BufferPool *mInputBufferPool;
     BufferQueue *mInputBufferQueue;
     BufferPool *mOutputBufferPool;
     std::vector<BufferQueue*> mOutputBufferQueues;
+    std::vector<ffmpeg_avc_decoder_pending_input_t> mPendingInputBuffers;
+    int64_t mNextPts;
+    std::vector<ffmpeg_avc_decoder_cached_frame_t> mFrameCache;
+    unsigned int mFrameCacheSize;
+    unsigned int mFrameCacheMaxSize;
+    bool mFrameCacheDrainPending;
+    ffmpeg_avc_decoder_frame_pool_t *mFramePool;
+    std::vector<ffmpeg_avc_decoder_frame_pool_t*> mRetiredFramePools;
+    pthread_mutex_t mFramePoolMutex;
+    unsigned int mFramePoolMaxSize;
+    std::atomic<unsigned int> mFramePoolExhaustedCount;
+    unsigned int mInputBufferCount;
+    unsigned int mInputBufferSize;
+    unsigned int mInputBufferGrowCount;
+    unsigned int mMaxAuSize;
+    unsigned int mFrameThreadingDelay;
+    std::atomic<unsigned int> mInputQueueDepth;
+    bool mOverloadEnabled;
+    unsigned int mOverloadMaxQueueDepth;
+    unsigned int mOverloadMaxAuAge;
+    unsigned int mOverloadLevel;
+    unsigned int mOverloadLateCount;
+    unsigned int mOverloadOnTimeCount;
+    unsigned int mOverloadCount;
+    unsigned int mOverloadNonRefSkipCount;
+    unsigned int mOverloadLoopFilterSkipCount;
+    unsigned int mOverloadNonKeySkipCount;
     pthread_t mDecoderThread;
     bool mDecoderThreadLaunched;
+    DecoderPool *mDecoderPool;
+    unsigned int mDecodeCount;
+    uint64_t mDecodeTimeTotal;
+    unsigned int mDecodeTimeMax;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
     bool mThreadShouldStop;
     AVCodec *mCodecH264;
     AVCodecContext *mCodecCtxH264;
     AVPacket mPacket;
+    AVFrame *mFrame;
     avc_decoder_color_format_t mOutputColorFormat;
     unsigned int mFrameWidth;
     unsigned int mFrameHeight;
@@ -60,6 +60,7 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
     mOutputColorFormat = AVCDECODER_COLORFORMAT_UNKNOWN;
     mMedia = (Media*)media;
     mInputBufferPool = NULL;
+    mMaxAuSize = 0;
     mInputBufferQueue = NULL;
     mOutputBufferPool = NULL;
     mClient = NULL;
@@ -88,6 +89,7 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
     {
         ULOGE("videoCoreOmx: OMX_Init() failed");
         ilclient_destroy(mClient);
+        mClient = NULL;
         return;
     }
 
@@ -98,6 +100,7 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
     {
         ULOGE("videoCoreOmx: ilclient_create_component() failed on video_decode");
         ilclient_destroy(mClient);
+        mClient = NULL;
         return;
     }
 
@@ -106,6 +109,7 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
     {
         ULOGE("videoCoreOmx: ilclient_create_component() failed on egl_render");
         ilclient_destroy(mClient);
+        mClient = NULL;
         return;
     }
 
@@ -115,6 +119,7 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
     {
         ULOGE("videoCoreOmx: failed to change OMX component state to 'idle'");
         ilclient_destroy(mClient);
+        mClient = NULL;
         return;
     }
 
@@ -185,8 +190,9 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
 
                 /* Input buffers pool allocation */
                 mInputBufferPool = new BufferPool(def.nBufferCountActual, 0,
-                                                  sizeof(avc_decoder_input_buffer_t), 0,
-                                                  NULL, NULL);
+                                                  sizeof(avc_decoder_input_buffer_t),
+                                                  AVCDECODER_USER_DATA_BUFFER_SIZE,
+                                                  NULL, NULL, NULL, false);
                 if (mInputBufferPool == NULL)
                 {
                     ULOGE("videoCoreOmx: failed to allocate decoder input buffers pool");
@@ -204,7 +210,8 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
 
     /* Output buffers pool allocation */
     mOutputBufferPool = new BufferPool(VIDEOCORE_OMX_AVC_DECODER_OUTPUT_BUFFER_COUNT, 0,
-                                       sizeof(avc_decoder_output_buffer_t), 0, NULL, NULL);
+                                       sizeof(avc_decoder_output_buffer_t),
+                                       AVCDECODER_USER_DATA_BUFFER_SIZE, NULL, NULL, NULL, false);
     if (mOutputBufferPool == NULL)
     {
         ULOGE("videoCoreOmx: failed to allocate decoder output buffers pool");
@@ -216,18 +223,22 @@ VideoCoreOmxAvcDecoder::VideoCoreOmxAvcDecoder(VideoMedia *media)
 
 VideoCoreOmxAvcDecoder::~VideoCoreOmxAvcDecoder()
 {
-    COMPONENT_T *list[4] = { mVideoDecode, mEglRender }; //, mClock, mVideoScheduler };
-    ilclient_flush_tunnels(mTunnel, 0);
-    ilclient_disable_port_buffers(mVideoDecode, 130, NULL, NULL, NULL);
-    ilclient_disable_tunnel(mTunnel);
-    ilclient_teardown_tunnels(mTunnel);
-    ilclient_state_transition(list, OMX_StateIdle);
+    /* The client is destroyed on initialization errors */
+    if (mClient)
+    {
+        COMPONENT_T *list[4] = { mVideoDecode, mEglRender }; //, mClock, mVideoScheduler };
+        ilclient_flush_tunnels(mTunnel, 0);
+        ilclient_disable_port_buffers(mVideoDecode, 130, NULL, NULL, NULL);
+        ilclient_disable_tunnel(mTunnel);
+        ilclient_teardown_tunnels(mTunnel);
+        ilclient_state_transition(list, OMX_StateIdle);
 
-    ilclient_cleanup_components(list);
+        ilclient_cleanup_components(list);
 
-    OMX_Deinit();
+        OMX_Deinit();
 
-    ilclient_destroy(mClient);
+        ilclient_destroy(mClient);
+    }
 
     if (mInputBufferQueue) delete mInputBufferQueue;
     if (mInputBufferPool) delete mInputBufferPool;
@@ -575,6 +586,11 @@ int VideoCoreOmxAvcDecoder::queueInputBuffer(Buffer *buffer)
         return -1;
     }
 
+    if (buffer->getSize() > mMaxAuSize)
+    {
+        mMaxAuSize = buffer->getSize();
+    }
+
     if (mInputBufferQueue)
     {
         OMX_BUFFERHEADERTYPE *omxBuf = (OMX_BUFFERHEADERTYPE*)buffer->getResPtr();
@@ -631,9 +647,17 @@ int VideoCoreOmxAvcDecoder::queueInputBuffer(Buffer *buffer)
 }
 
 
-BufferQueue *VideoCoreOmxAvcDecoder::addOutputQueue()
+int VideoCoreOmxAvcDecoder::growInputBuffer(Buffer *buffer, unsigned int capacity)
+{
+    /* The input buffers are owned by the codec */
+    ULOGW("videoCoreOmx: input buffers cannot be grown (%d bytes needed)", capacity);
+    return -1;
+}
+
+
+BufferQueue *VideoCoreOmxAvcDecoder::addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy)
 {
-    BufferQueue *q = new BufferQueue();
+    BufferQueue *q = new BufferQueue(maxDepth, policy);
     if (q == NULL)
     {
         ULOGE("videoCoreOmx: queue allocation failed");
@@ -656,12 +680,41 @@ int VideoCoreOmxAvcDecoder::removeOutputQueue(BufferQueue *queue)
     bool found = false;
     std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
 
+    while (q != mOutputBufferQueues.end())
+    {
+        if (*q == queue)
+        {
+            ULOGI("videoCoreOmx: output queue removed (%d frames queued, %d dropped)",
+                  queue->getPushCount(), queue->getDropCount());
+            mOutputBufferQueues.erase(q);
+            delete queue;
+            found = true;
+            break;
+        }
+        q++;
+    }
+
+    return (found) ? 0 : -1;
+}
+
+
+int VideoCoreOmxAvcDecoder::detachOutputQueue(BufferQueue *queue)
+{
+    if (!queue)
+    {
+        ULOGE("videoCoreOmx: invalid queue pointer");
+        return -1;
+    }
+
+    bool found = false;
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+
     while (q != mOutputBufferQueues.end())
     {
         if (*q == queue)
         {
             mOutputBufferQueues.erase(q);
-            delete *q;
+            queue->flush();
             found = true;
             break;
         }
@@ -672,6 +725,19 @@ int VideoCoreOmxAvcDecoder::removeOutputQueue(BufferQueue *queue)
 }
 
 
+int VideoCoreOmxAvcDecoder::attachOutputQueue(BufferQueue *queue)
+{
+    if (!queue)
+    {
+        ULOGE("videoCoreOmx: invalid queue pointer");
+        return -1;
+    }
+
+    mOutputBufferQueues.push_back(queue);
+    return 0;
+}
+
+
 bool VideoCoreOmxAvcDecoder::isOutputQueueValid(BufferQueue *queue)
 {
     if (!queue)
@@ -769,6 +835,40 @@ int VideoCoreOmxAvcDecoder::releaseOutputBuffer(Buffer *buffer)
 }
 
 
+int VideoCoreOmxAvcDecoder::getStats(pdraw_decoder_stats_t *stats)
+{
+    if (!stats)
+    {
+        ULOGE("videoCoreOmx: invalid stats pointer");
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(pdraw_decoder_stats_t));
+    stats->maxAuSize = mMaxAuSize;
+    if (mInputBufferPool)
+    {
+        stats->inputBufferCount = mInputBufferPool->getBufferCount();
+        stats->inputBufferUsedCount = mInputBufferPool->getUsedCount();
+        stats->inputBufferMaxUsedCount = mInputBufferPool->getMaxUsedCount();
+    }
+    if (mOutputBufferPool)
+    {
+        stats->outputBufferCount = mOutputBufferPool->getBufferCount();
+        stats->outputBufferUsedCount = mOutputBufferPool->getUsedCount();
+        stats->outputBufferMaxUsedCount = mOutputBufferPool->getMaxUsedCount();
+    }
+    std::vector<BufferQueue*>::iterator q = mOutputBufferQueues.begin();
+    while (q != mOutputBufferQueues.end())
+    {
+        stats->outputQueueCount++;
+        stats->outputQueueDropCount += (*q)->getDropCount();
+        q++;
+    }
+
+    return 0;
+}
+
+
 int VideoCoreOmxAvcDecoder::stop()
 {
     if (!mConfigured)
@@ -836,7 +936,9 @@ void VideoCoreOmxAvcDecoder::fillBufferDoneCallback(void *data, COMPONENT_T *com
         ULOGW("videoCoreOmx: invalid timestamp in buffer callback");
     }
 
-    outputBuffer = decoder->mOutputBufferPool->getBuffer(false);
+    /* Silent frames are not output */
+    bool silent = ((inputData) && (inputData->isSilent));
+    outputBuffer = (silent) ? NULL : decoder->mOutputBufferPool->getBuffer(false);
     if (outputBuffer)
     {
         outputData = (avc_decoder_output_buffer_t*)outputBuffer->getMetadataPtr();
@@ -902,7 +1004,10 @@ void VideoCoreOmxAvcDecoder::fillBufferDoneCallback(void *data, COMPONENT_T *com
             while (q != decoder->mOutputBufferQueues.end())
             {
                 outputBuffer->ref();
-                (*q)->pushBuffer(outputBuffer);
+                if ((*q)->pushBuffer(outputBuffer) != 0)
+                {
+                    outputBuffer->unref();
+                }
                 q++;
             }
         }
@@ -912,7 +1017,7 @@ void VideoCoreOmxAvcDecoder::fillBufferDoneCallback(void *data, COMPONENT_T *com
         }
         outputBuffer->unref();
     }
-    else
+    else if (!silent)
     {
         ULOGE("videoCoreOmx: failed to get an output buffer");
     }
@@ -73,14 +73,30 @@ public:
 
     avc_decoder_color_format_t getOutputColorFormat() { return mOutputColorFormat; };
 
+    bool isFrameCacheSupported() { return false; };
+
+    unsigned int getOutputDelay() { return 0; };
+
+    unsigned int getFrameCacheMaxCount(unsigned int width, unsigned int height) { return 0; };
+
+    bool isEndOfStreamSupported() { return false; };
+
+    bool isValid() { return ((mInputBufferQueue != NULL) && (mOutputBufferPool != NULL)); };
+
     int getInputBuffer(Buffer **buffer, bool blocking);
 
     int queueInputBuffer(Buffer *buffer);
 
-    BufferQueue *addOutputQueue();
+    int growInputBuffer(Buffer *buffer, unsigned int capacity);
+
+    BufferQueue *addOutputQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy);
 
     int removeOutputQueue(BufferQueue *queue);
 
+    int detachOutputQueue(BufferQueue *queue);
+
+    int attachOutputQueue(BufferQueue *queue);
+
     int dequeueOutputBuffer(BufferQueue *queue, Buffer **buffer, bool blocking);
 
     int releaseOutputBuffer(Buffer *buffer);
@@ -93,6 +109,8 @@ public:
 
     VideoMedia *getVideoMedia() { return (VideoMedia*)mMedia; };
 
+    int getStats(pdraw_decoder_stats_t *stats);
+
 private:
 
     bool isOutputQueueValid(BufferQueue *queue);
@@ -117,6 +135,7 @@ private:
     int mSliceHeight;
     int mStride;
     BufferPool *mInputBufferPool;
+    unsigned int mMaxAuSize;
     BufferQueue *mInputBufferQueue;
     BufferPool *mOutputBufferPool;
     std::vector<BufferQueue*> mOutputBufferQueues;
@@ -38,6 +38,13 @@
 
 #include "pdraw_buffer.hpp"
 
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
 #define ULOG_TAG libpdraw
 #include <ulog.h>
 
@@ -46,12 +53,70 @@ namespace Pdraw
 {
 
 
+static void futexWait(std::atomic<int> *futex, int value)
+{
+    syscall(SYS_futex, (int*)futex, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+
+static void futexWake(std::atomic<int> *futex)
+{
+    syscall(SYS_futex, (int*)futex, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+
+static size_t alignSize(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+
+static void *alignedAlloc(size_t size)
+{
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, BUFFER_ALIGNMENT, size) != 0)
+    {
+        return NULL;
+    }
+    return ptr;
+}
+
+
+/* Grow a metadata or user data slot; inline slots cannot be resized,
+ * the content moves to a heap allocation */
+static int growSlot(void **ptr, unsigned int *capacity, bool *alloc, unsigned int newCapacity)
+{
+    if (newCapacity > *capacity)
+    {
+        void *tmp = alignedAlloc(newCapacity);
+        if (tmp == NULL)
+        {
+            return -1;
+        }
+        if ((*ptr) && (*capacity > 0))
+        {
+            memcpy(tmp, *ptr, *capacity);
+        }
+        if (*alloc)
+        {
+            free(*ptr);
+        }
+        *ptr = tmp;
+        *capacity = newCapacity;
+        *alloc = true;
+    }
+    return (int)*capacity;
+}
+
+
 Buffer::Buffer(BufferPool *bufferPool,
                unsigned int id,
                void *userPtr,
                uint8_t *preallocBuf,
                unsigned int capacity,
+               uint8_t *preallocMetadataBuf,
                unsigned int metadataBufferCapacity,
+               uint8_t *preallocUserDataBuf,
                unsigned int userDataBufferCapacity,
                int(*bufferCreationCb)(Buffer *buffer),
                int(*bufferDeletionCb)(Buffer *buffer))
@@ -64,39 +129,42 @@ Buffer::Buffer(BufferPool *bufferPool,
     mCapacity = capacity;
     mSize = 0;
     mAlloc = ((mCapacity > 0) && (preallocBuf == NULL)) ? true : false;
+    mArena = (preallocBuf != NULL) ? true : false;
     mPtr = preallocBuf;
     mResPtr = NULL;
-    mMetadataPtr = NULL;
+    mMetadataPtr = preallocMetadataBuf;
     mMetadataCapacity = metadataBufferCapacity;
     mMetadataSize = 0;
-    mUserDataPtr = NULL;
+    mMetadataAlloc = ((mMetadataCapacity > 0) && (preallocMetadataBuf == NULL)) ? true : false;
+    mUserDataPtr = preallocUserDataBuf;
     mUserDataCapacity = userDataBufferCapacity;
     mUserDataSize = 0;
+    mUserDataAlloc = ((mUserDataCapacity > 0) && (preallocUserDataBuf == NULL)) ? true : false;
 
-    if ((mAlloc) && (mCapacity > 0))
+    if (mAlloc)
     {
-        mPtr = (void*)malloc(mCapacity);
+        mPtr = alignedAlloc(mCapacity);
         if (mPtr == NULL)
         {
             ULOGE("Buffer: allocation failed (size %d)", mCapacity);
         }
     }
 
-    if (mMetadataCapacity)
+    if (mMetadataAlloc)
     {
-        mMetadataPtr = (void*)malloc(mMetadataCapacity);
+        mMetadataPtr = alignedAlloc(mMetadataCapacity);
         if (mMetadataPtr == NULL)
         {
             ULOGE("Buffer: metadata allocation failed (size %d)", mMetadataCapacity);
         }
     }
 
-    if (mUserDataCapacity)
+    if (mUserDataAlloc)
     {
-        mUserDataPtr = (void*)malloc(mUserDataCapacity);
+        mUserDataPtr = alignedAlloc(mUserDataCapacity);
         if (mUserDataPtr == NULL)
         {
-            ULOGE("Buffer: metadata allocation failed (size %d)", mUserDataCapacity);
+            ULOGE("Buffer: user data allocation failed (size %d)", mUserDataCapacity);
         }
     }
 
@@ -125,12 +193,18 @@ Buffer::~Buffer()
     if (mAlloc)
     {
         free(mPtr);
-        mPtr = NULL;
     }
-
-    free(mMetadataPtr);
-    free(mUserDataPtr);
+    if (mMetadataAlloc)
+    {
+        free(mMetadataPtr);
+    }
+    if (mUserDataAlloc)
+    {
+        free(mUserDataPtr);
+    }
+    mPtr = NULL;
     mMetadataPtr = NULL;
+    mUserDataPtr = NULL;
 }
 
 
@@ -142,8 +216,7 @@ void Buffer::ref()
 
 void Buffer::unref()
 {
-    mRefCount--;
-    if ((mRefCount == 0) && (mBufferPool))
+    if ((--mRefCount == 0) && (mBufferPool))
     {
         mBufferPool->putBuffer(this);
     }
@@ -186,6 +259,38 @@ void Buffer::setCapacity(unsigned int capacity)
 }
 
 
+int Buffer::growCapacity(unsigned int capacity)
+{
+    /* Only buffers allocated here or in the pool arena can be grown;
+     * the content is kept and the payload moves to the heap */
+    if (capacity > mCapacity)
+    {
+        if ((!mAlloc) && (!mArena))
+        {
+            return -1;
+        }
+        void *tmp = alignedAlloc(capacity);
+        if (tmp == NULL)
+        {
+            return -1;
+        }
+        if (mPtr)
+        {
+            memcpy(tmp, mPtr, mCapacity);
+        }
+        if (mAlloc)
+        {
+            free(mPtr);
+        }
+        mPtr = tmp;
+        mCapacity = capacity;
+        mAlloc = true;
+        mArena = false;
+    }
+    return (int)mCapacity;
+}
+
+
 unsigned int Buffer::getSize()
 {
     return mSize;
@@ -218,20 +323,7 @@ unsigned int Buffer::getMetadataCapacity()
 
 int Buffer::setMetadataCapacity(unsigned int capacity)
 {
-    if (capacity > mMetadataCapacity)
-    {
-        void *tmp = (void *)realloc(mMetadataPtr, capacity);
-        if (tmp != NULL)
-        {
-            mMetadataPtr = tmp;
-            mMetadataCapacity = capacity;
-        }
-        else
-        {
-            return -1;
-        }
-    }
-    return (int)mMetadataCapacity;
+    return growSlot(&mMetadataPtr, &mMetadataCapacity, &mMetadataAlloc, capacity);
 }
 
 
@@ -261,20 +353,7 @@ unsigned int Buffer::getUserDataCapacity()
 
 int Buffer::setUserDataCapacity(unsigned int capacity)
 {
-    if (capacity > mUserDataCapacity)
-    {
-        void *tmp = (void *)realloc(mUserDataPtr, capacity);
-        if (tmp != NULL)
-        {
-            mUserDataPtr = tmp;
-            mUserDataCapacity = capacity;
-        }
-        else
-        {
-            return -1;
-        }
-    }
-    return (int)mUserDataCapacity;
+    return growSlot(&mUserDataPtr, &mUserDataCapacity, &mUserDataAlloc, capacity);
 }
 
 
@@ -313,41 +392,53 @@ BufferPool::BufferPool(unsigned int bufferCount,
                        unsigned int metadataBufferSize,
                        unsigned int userDataBufferSize,
                        int(*bufferCreationCb)(Buffer *buffer),
-                       int(*bufferDeletionCb)(Buffer *buffer))
+                       int(*bufferDeletionCb)(Buffer *buffer),
+                       int(*bufferReleaseCb)(Buffer *buffer),
+                       bool hugePages)
 {
     unsigned int i;
-    int ret;
+    size_t metadataStride = alignSize(metadataBufferSize, BUFFER_ALIGNMENT);
+    size_t userDataStride = alignSize(userDataBufferSize, BUFFER_ALIGNMENT);
+    size_t stride = metadataStride + userDataStride + alignSize(bufferSize, BUFFER_ALIGNMENT);
 
     mBufferCount = bufferCount;
     mBufferSize = bufferSize;
+    mBufferReleaseCb = bufferReleaseCb;
+    mArena = NULL;
+    mArenaSize = stride * bufferCount;
+    mArenaMapped = false;
+    mHead = 0;
+    mFreeCount = 0;
+    mMaxUsedCount = 0;
+    mFutex = 0;
+    mWaiters = 0;
+    mSignalCount = 0;
+    mSignalSeen = 0;
 
     mBuffers = new std::vector<Buffer*>(bufferCount);
-    
-    /* Allocate all buffers */
-    for (i = 0; i < mBuffers->size(); i++)
+    mNext = new std::atomic<unsigned int>[bufferCount];
+
+    if ((mArenaSize > 0) && (allocArena(hugePages) != 0))
     {
-        (*mBuffers)[i] = new Buffer(this, i, NULL, NULL, bufferSize,
-                                    metadataBufferSize, userDataBufferSize,
-                                    bufferCreationCb, bufferDeletionCb); //TODO
+        /* The buffers allocate their own memory */
+        ULOGW("BufferPool: arena allocation failed (size %zu)", mArenaSize);
     }
 
-    mPool = new std::queue<Buffer*>();
-
-    /* Add all buffers in the pool */
+    /* Allocate all buffers */
     for (i = 0; i < mBuffers->size(); i++)
     {
-        mPool->push(((*mBuffers)[i]));
+        uint8_t *base = (mArena) ? mArena + i * stride : NULL;
+        (*mBuffers)[i] = new Buffer(this, i, NULL,
+                                    ((base) && (bufferSize)) ? base + metadataStride + userDataStride : NULL, bufferSize,
+                                    ((base) && (metadataBufferSize)) ? base : NULL, metadataBufferSize,
+                                    ((base) && (userDataBufferSize)) ? base + metadataStride : NULL, userDataBufferSize,
+                                    bufferCreationCb, bufferDeletionCb);
     }
 
-    ret = pthread_mutex_init(&mMutex, NULL);
-    if (ret != 0)
-    {
-        ULOGE("BufferPool: mutex creation failed (%d)", ret);
-    }
-    ret = pthread_cond_init(&mCond, NULL);
-    if (ret != 0)
+    /* Add all buffers in the pool */
+    for (i = mBuffers->size(); i > 0; i--)
     {
-        ULOGE("BufferPool: cond creation failed (%d)", ret);
+        push((*mBuffers)[i - 1]);
     }
 }
 
@@ -356,12 +447,9 @@ BufferPool::~BufferPool()
 {
     unsigned int i, cnt;
 
-    pthread_mutex_destroy(&mMutex);
-    pthread_cond_destroy(&mCond);
-
-    if (mPool->size() != mBufferCount)
+    if (mFreeCount != mBufferCount)
     {
-        ULOGE("BufferPool: buffer count mismatch - not all buffers have been returned (%zu vs. %d)", mPool->size(), mBufferCount);
+        ULOGE("BufferPool: buffer count mismatch - not all buffers have been returned (%d vs. %d)", mFreeCount.load(), mBufferCount);
     }
 
     for (i = 0; i < mBuffers->size(); i++)
@@ -374,28 +462,114 @@ BufferPool::~BufferPool()
     }
 
     delete mBuffers;
-    delete mPool;
+    delete[] mNext;
+
+    freeArena();
+}
+
+
+int BufferPool::allocArena(bool hugePages)
+{
+    if ((hugePages) && (mArenaSize >= BUFFER_HUGE_PAGE_SIZE))
+    {
+        size_t size = alignSize(mArenaSize, BUFFER_HUGE_PAGE_SIZE);
+        void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (ptr == MAP_FAILED)
+        {
+            /* No reserved huge pages: fall back to transparent huge pages */
+            ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (ptr != MAP_FAILED)
+            {
+                madvise(ptr, size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        if (ptr != MAP_FAILED)
+        {
+            mArena = (uint8_t*)ptr;
+            mArenaSize = size;
+            mArenaMapped = true;
+            return 0;
+        }
+    }
+
+    mArena = (uint8_t*)alignedAlloc(mArenaSize);
+    return (mArena) ? 0 : -1;
+}
+
+
+void BufferPool::freeArena()
+{
+    if (mArenaMapped)
+    {
+        munmap(mArena, mArenaSize);
+    }
+    else
+    {
+        free(mArena);
+    }
+    mArena = NULL;
+    mArenaMapped = false;
 }
 
 
 void BufferPool::signal()
 {
-    pthread_cond_signal(&mCond);
+    mSignalCount++;
+    mFutex++;
+    if (mWaiters > 0)
+    {
+        futexWake(&mFutex);
+    }
 }
 
 
 bool BufferPool::bufferIsValid(Buffer *buffer)
 {
-    /* Find the buffer */
-    unsigned int i;
-    for (i = 0; i < mBuffers->size(); i++)
+    unsigned int id = buffer->getId();
+    return ((buffer->mBufferPool == this) && (id < mBuffers->size()) && ((*mBuffers)[id] == buffer)) ? true : false;
+}
+
+
+Buffer *BufferPool::pop()
+{
+    uint64_t head = mHead.load(std::memory_order_acquire);
+
+    while ((head & 0xFFFFFFFF) != 0)
     {
-        if (buffer == (*mBuffers)[i])
+        unsigned int index = (unsigned int)(head & 0xFFFFFFFF) - 1;
+        uint64_t tag = (head >> 32) + 1;
+        uint64_t newHead = (tag << 32) | mNext[index].load(std::memory_order_relaxed);
+        if (mHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire))
         {
-            return true;
+            mFreeCount--;
+            return (*mBuffers)[index];
         }
     }
-    return false;
+
+    return NULL;
+}
+
+
+void BufferPool::push(Buffer *buffer)
+{
+    unsigned int index = buffer->getId();
+    uint64_t head = mHead.load(std::memory_order_relaxed);
+    uint64_t newHead;
+
+    mFreeCount++;
+    do
+    {
+        mNext[index].store((unsigned int)(head & 0xFFFFFFFF), std::memory_order_relaxed);
+        newHead = (((head >> 32) + 1) << 32) | (uint64_t)(index + 1);
+    }
+    while (!mHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
 }
 
 
@@ -403,34 +577,38 @@ Buffer *BufferPool::getBuffer(bool blocking)
 {
     Buffer *buffer = NULL;
 
-    pthread_mutex_lock(&mMutex);
-
-    if (mPool->size() == 0)
+    while ((buffer = pop()) == NULL)
     {
-        if (blocking)
+        if (!blocking)
         {
-            /* The pool is empty, wait for a new buffer */
-            pthread_cond_wait(&mCond, &mMutex);
+            return NULL;
         }
-        else
+
+        /* The pool is empty, wait for a new buffer or a signal;
+         * the futex value is read before checking the pool again
+         * so that a put in between is not missed */
+        mWaiters++;
+        int futex = mFutex;
+        if ((mHead & 0xFFFFFFFF) != 0)
         {
-            pthread_mutex_unlock(&mMutex);
+            mWaiters--;
+            continue;
+        }
+        unsigned int signalCount = mSignalCount;
+        unsigned int signalSeen = mSignalSeen;
+        if ((signalCount != signalSeen) && (mSignalSeen.compare_exchange_strong(signalSeen, signalCount)))
+        {
+            mWaiters--;
             return NULL;
         }
+        futexWait(&mFutex, futex);
+        mWaiters--;
     }
 
-    if (mPool->size() != 0)
-    {
-        buffer = mPool->front();
-        mPool->pop();
-    }
-    else
-    {
-        pthread_mutex_unlock(&mMutex);
-        return NULL;
-    }
-
-    pthread_mutex_unlock(&mMutex);
+    /* Occupancy high-water mark */
+    unsigned int used = mBufferCount - mFreeCount;
+    unsigned int maxUsed = mMaxUsedCount;
+    while ((used > maxUsed) && (!mMaxUsedCount.compare_exchange_weak(maxUsed, used)));
 
     buffer->ref();
     return buffer;
@@ -442,34 +620,47 @@ void BufferPool::putBuffer(Buffer *buffer)
     if (buffer == NULL)
         return;
 
-    pthread_mutex_lock(&mMutex);
-
     /* Check that this is one of our buffers */
     if (!bufferIsValid(buffer))
     {
-        pthread_mutex_unlock(&mMutex);
         ULOGE("BufferPool: invalid buffer");
         return;
     }
 
+    /* Release the resources held by the buffer before it can be reused */
+    if (mBufferReleaseCb)
+    {
+        int ret = mBufferReleaseCb(buffer);
+        if (ret != 0)
+        {
+            ULOGE("BufferPool: buffer release callback failed (%d)", ret);
+        }
+    }
+
     /* Put the buffer in the pool */
     buffer->setRefCount(0);
-    mPool->push(buffer);
-    if (mPool->size() == 1)
+    push(buffer);
+
+    /* Someone might been waiting for a buffer */
+    mFutex++;
+    if (mWaiters > 0)
     {
-        /* The pool was empty, someone might been waiting for a buffer */
-        pthread_cond_signal(&mCond);
+        futexWake(&mFutex);
     }
-
-    pthread_mutex_unlock(&mMutex);
 }
 
 
-BufferQueue::BufferQueue()
+BufferQueue::BufferQueue(unsigned int maxDepth, buffer_queue_overflow_policy_t policy)
 {
     int ret;
 
+    mMaxDepth = maxDepth;
+    mPolicy = policy;
+    mPushCount = 0;
+    mDropCount = 0;
     mQueue = new std::queue<Buffer*>();
+    mSignaled = false;
+    mSignalCount = 0;
 
     ret = pthread_mutex_init(&mMutex, NULL);
     if (ret != 0)
@@ -481,6 +672,11 @@ BufferQueue::BufferQueue()
     {
         ULOGE("BufferQueue: cond creation failed (%d)", ret);
     }
+    ret = pthread_cond_init(&mSpaceCond, NULL);
+    if (ret != 0)
+    {
+        ULOGE("BufferQueue: cond creation failed (%d)", ret);
+    }
 }
 
 
@@ -490,6 +686,7 @@ BufferQueue::~BufferQueue()
 
     pthread_mutex_destroy(&mMutex);
     pthread_cond_destroy(&mCond);
+    pthread_cond_destroy(&mSpaceCond);
 
     delete mQueue;
 }
@@ -497,7 +694,14 @@ BufferQueue::~BufferQueue()
 
 void BufferQueue::signal()
 {
+    /* Wake the current blocking wait, or the next one if nobody is waiting,
+     * and a producer waiting for room in the queue */
+    pthread_mutex_lock(&mMutex);
+    mSignaled = true;
+    mSignalCount++;
     pthread_cond_signal(&mCond);
+    pthread_cond_broadcast(&mSpaceCond);
+    pthread_mutex_unlock(&mMutex);
 }
 
 
@@ -522,8 +726,12 @@ Buffer *BufferQueue::peekBuffer(bool blocking)
     {
         if (blocking)
         {
-            /* The queue is empty, wait for a new buffer */
-            pthread_cond_wait(&mCond, &mMutex);
+            /* The queue is empty, wait for a new buffer or a signal */
+            while ((mQueue->size() == 0) && (!mSignaled))
+            {
+                pthread_cond_wait(&mCond, &mMutex);
+            }
+            mSignaled = false;
         }
         else
         {
@@ -558,8 +766,12 @@ Buffer *BufferQueue::popBuffer(bool blocking)
     {
         if (blocking)
         {
-            /* The queue is empty, wait for a new buffer */
-            pthread_cond_wait(&mCond, &mMutex);
+            /* The queue is empty, wait for a new buffer or a signal */
+            while ((mQueue->size() == 0) && (!mSignaled))
+            {
+                pthread_cond_wait(&mCond, &mMutex);
+            }
+            mSignaled = false;
         }
         else
         {
@@ -572,6 +784,10 @@ Buffer *BufferQueue::popBuffer(bool blocking)
     {
         buffer = mQueue->front();
         mQueue->pop();
+        if (mPolicy == BUFFER_QUEUE_OVERFLOW_BLOCK)
+        {
+            pthread_cond_signal(&mSpaceCond);
+        }
     }
     else
     {
@@ -585,15 +801,45 @@ Buffer *BufferQueue::popBuffer(bool blocking)
 }
 
 
-void BufferQueue::pushBuffer(Buffer *buffer)
+int BufferQueue::pushBuffer(Buffer *buffer)
 {
     if (buffer == NULL)
-        return;
+        return -1;
 
     pthread_mutex_lock(&mMutex);
 
+    if ((mMaxDepth > 0) && (mQueue->size() >= mMaxDepth))
+    {
+        if (mPolicy == BUFFER_QUEUE_OVERFLOW_DROP_OLDEST)
+        {
+            while (mQueue->size() >= mMaxDepth)
+            {
+                Buffer *oldest = mQueue->front();
+                mQueue->pop();
+                oldest->unref();
+                mDropCount++;
+            }
+        }
+        else if (mPolicy == BUFFER_QUEUE_OVERFLOW_BLOCK)
+        {
+            /* Wait for the consumer; a signal interrupts the wait */
+            unsigned int signalCount = mSignalCount;
+            while ((mQueue->size() >= mMaxDepth) && (mSignalCount == signalCount))
+            {
+                pthread_cond_wait(&mSpaceCond, &mMutex);
+            }
+        }
+        if (mQueue->size() >= mMaxDepth)
+        {
+            mDropCount++;
+            pthread_mutex_unlock(&mMutex);
+            return -1;
+        }
+    }
+
     /* Put the buffer in the queue */
     mQueue->push(buffer);
+    mPushCount++;
     if (mQueue->size() == 1)
     {
         /* The queue was empty, someone might been waiting for a buffer */
@@ -601,6 +847,223 @@ void BufferQueue::pushBuffer(Buffer *buffer)
     }
 
     pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+
+SpscBufferQueue::SpscBufferQueue(unsigned int capacity, buffer_queue_overflow_policy_t policy)
+    : BufferQueue(capacity, policy)
+{
+    if (capacity == 0)
+    {
+        capacity = SPSC_BUFFER_QUEUE_DEFAULT_CAPACITY;
+        mMaxDepth = capacity;
+    }
+
+    /* Round the ring size up to a power of 2 strictly greater than the
+     * capacity: the slot written by the producer is then never the one
+     * read by the consumer, even when the producer drops the oldest */
+    mCapacity = 1;
+    while (mCapacity <= capacity)
+    {
+        mCapacity <<= 1;
+    }
+    mMask = mCapacity - 1;
+    mHead = 0;
+    mTail = 0;
+    mFutex = 0;
+    mWaiters = 0;
+    mSignalCount = 0;
+    mSignalSeen = 0;
+    mSpaceFutex = 0;
+    mSpaceWaiters = 0;
+
+    mRing = (Buffer**)calloc(mCapacity, sizeof(Buffer*));
+    if (mRing == NULL)
+    {
+        /* Every push is then rejected */
+        ULOGE("SpscBufferQueue: allocation failed (size %d)", mCapacity);
+        mCapacity = 0;
+        mMask = 0;
+    }
+}
+
+
+SpscBufferQueue::~SpscBufferQueue()
+{
+    flush();
+
+    free(mRing);
+}
+
+
+void SpscBufferQueue::wake()
+{
+    mFutex++;
+    if (mWaiters > 0)
+    {
+        futexWake(&mFutex);
+    }
+}
+
+
+void SpscBufferQueue::wakeProducer()
+{
+    mSpaceFutex++;
+    if (mSpaceWaiters > 0)
+    {
+        futexWake(&mSpaceFutex);
+    }
+}
+
+
+void SpscBufferQueue::signal()
+{
+    mSignalCount++;
+    wake();
+    wakeProducer();
+}
+
+
+void SpscBufferQueue::flush()
+{
+    Buffer *buffer = NULL;
+
+    while ((buffer = popBuffer(false)) != NULL)
+    {
+        buffer->unref();
+    }
+}
+
+
+Buffer *SpscBufferQueue::peekBuffer(bool blocking)
+{
+    unsigned int head;
+    return peek(blocking, &head);
+}
+
+
+Buffer *SpscBufferQueue::peek(bool blocking, unsigned int *pHead)
+{
+    while (true)
+    {
+        /* The head can also be moved by the producer (drop-oldest) */
+        unsigned int head = mHead.load(std::memory_order_acquire);
+        if (head != mTail.load(std::memory_order_acquire))
+        {
+            *pHead = head;
+            return mRing[head & mMask];
+        }
+        if (!blocking)
+        {
+            return NULL;
+        }
+
+        /* The queue is empty, wait for a new buffer or a signal;
+         * the futex value is read before checking the queue again
+         * so that a push in between is not missed */
+        mWaiters++;
+        int futex = mFutex;
+        if (head != mTail)
+        {
+            mWaiters--;
+            continue;
+        }
+        unsigned int signalCount = mSignalCount;
+        if (signalCount != mSignalSeen)
+        {
+            mSignalSeen = signalCount;
+            mWaiters--;
+            return NULL;
+        }
+        futexWait(&mFutex, futex);
+        mWaiters--;
+    }
+}
+
+
+Buffer *SpscBufferQueue::popBuffer(bool blocking)
+{
+    Buffer *buffer;
+    unsigned int head;
+
+    /* The producer may drop the oldest buffer concurrently: whoever
+     * moves the head owns the buffer */
+    while ((buffer = peek(blocking, &head)) != NULL)
+    {
+        if (mHead.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            if (mPolicy == BUFFER_QUEUE_OVERFLOW_BLOCK)
+            {
+                wakeProducer();
+            }
+            return buffer;
+        }
+    }
+
+    return NULL;
+}
+
+
+int SpscBufferQueue::pushBuffer(Buffer *buffer)
+{
+    if ((buffer == NULL) || (mRing == NULL))
+        return -1;
+
+    unsigned int tail = mTail.load(std::memory_order_relaxed);
+    unsigned int head = mHead.load(std::memory_order_acquire);
+    if (tail - head >= mMaxDepth)
+    {
+        if (mPolicy == BUFFER_QUEUE_OVERFLOW_DROP_OLDEST)
+        {
+            while (tail - head >= mMaxDepth)
+            {
+                Buffer *oldest = mRing[head & mMask];
+                if (mHead.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    oldest->unref();
+                    mDropCount++;
+                    head++;
+                }
+            }
+        }
+        else if (mPolicy == BUFFER_QUEUE_OVERFLOW_BLOCK)
+        {
+            /* Wait for the consumer; a signal interrupts the wait */
+            unsigned int signalCount = mSignalCount;
+            while ((tail - head >= mMaxDepth) && (mSignalCount == signalCount))
+            {
+                mSpaceWaiters++;
+                int futex = mSpaceFutex;
+                head = mHead.load(std::memory_order_acquire);
+                if ((tail - head < mMaxDepth) || (mSignalCount != signalCount))
+                {
+                    mSpaceWaiters--;
+                    break;
+                }
+                futexWait(&mSpaceFutex, futex);
+                mSpaceWaiters--;
+                head = mHead.load(std::memory_order_acquire);
+            }
+        }
+        if (tail - head >= mMaxDepth)
+        {
+            mDropCount++;
+            return -1;
+        }
+    }
+
+    /* Put the buffer in the queue */
+    mRing[tail & mMask] = buffer;
+    mTail.store(tail + 1, std::memory_order_release);
+    mPushCount++;
+
+    /* Someone might been waiting for a buffer */
+    wake();
+
+    return 0;
 }
 
 }
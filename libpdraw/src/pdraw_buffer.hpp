@@ -44,12 +44,28 @@
 #include <stdint.h>
 #include <string.h>
 #include <pthread.h>
+#include <atomic>
+
+
+#define BUFFER_ALIGNMENT 64
+#define BUFFER_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define SPSC_BUFFER_QUEUE_DEFAULT_CAPACITY 64 /* when no capacity is given */
 
 
 namespace Pdraw
 {
 
 
+/* What pushBuffer() does when a bounded queue is full */
+typedef enum
+{
+    BUFFER_QUEUE_OVERFLOW_DROP_NEWEST = 0, /* reject the new buffer */
+    BUFFER_QUEUE_OVERFLOW_DROP_OLDEST, /* unref the oldest queued buffer */
+    BUFFER_QUEUE_OVERFLOW_BLOCK, /* wait for the consumer, or a signal */
+
+} buffer_queue_overflow_policy_t;
+
+
 class BufferPool;
 
 
@@ -62,7 +78,9 @@ public:
            void *userPtr,
            uint8_t *preallocBuf,
            unsigned int capacity,
+           uint8_t *preallocMetadataBuf,
            unsigned int metadataBufferCapacity,
+           uint8_t *preallocUserDataBuf,
            unsigned int userDataBufferCapacity,
            int(*bufferCreationCb)(Buffer *buffer),
            int(*bufferDeletionCb)(Buffer *buffer));
@@ -87,6 +105,8 @@ public:
 
     void setCapacity(unsigned int capacity);
 
+    int growCapacity(unsigned int capacity);
+
     unsigned int getSize();
 
     void setSize(unsigned int size);
@@ -125,23 +145,36 @@ private:
 
     BufferPool *mBufferPool;
     int(*mBufferDeletionCb)(Buffer *buffer);
-    unsigned int mRefCount;
+    std::atomic<unsigned int> mRefCount;
     unsigned int mId;
     void *mUserPtr;
     unsigned int mCapacity;
     unsigned int mSize;
     bool mAlloc;
+    bool mArena;
     void *mPtr;
     void *mResPtr;
     void *mMetadataPtr;
     unsigned int mMetadataCapacity;
     unsigned int mMetadataSize;
+    bool mMetadataAlloc;
     void *mUserDataPtr;
     unsigned int mUserDataCapacity;
     unsigned int mUserDataSize;
+    bool mUserDataAlloc;
 };
 
 
+/*
+ * All the buffers of a pool are carved out of a single arena: each
+ * buffer has an inline metadata slot, an inline user data slot and
+ * its payload, all starting on a BUFFER_ALIGNMENT boundary. With
+ * hugePages the arena is backed by huge pages when it is large enough
+ * (MAP_HUGETLB, or transparent huge pages if none are reserved).
+ * Buffers that outgrow their slots fall back to heap allocations.
+ */
+
+
 class BufferPool
 {
 public:
@@ -151,7 +184,9 @@ public:
                unsigned int metadataBufferSize,
                unsigned int userDataBufferSize,
                int(*bufferCreationCb)(Buffer *buffer),
-               int(*bufferDeletionCb)(Buffer *buffer));
+               int(*bufferDeletionCb)(Buffer *buffer),
+               int(*bufferReleaseCb)(Buffer *buffer),
+               bool hugePages);
 
     ~BufferPool();
 
@@ -161,26 +196,116 @@ public:
 
     void putBuffer(Buffer *buffer);
 
+    unsigned int getBufferCount() { return mBufferCount; };
+
+    unsigned int getUsedCount() { return mBufferCount - mFreeCount; };
+
+    unsigned int getMaxUsedCount() { return mMaxUsedCount; };
+
 private:
 
     bool bufferIsValid(Buffer *buffer);
 
+    int allocArena(bool hugePages);
+
+    void freeArena();
+
+    Buffer *pop();
+
+    void push(Buffer *buffer);
+
     unsigned int mBufferCount;
     unsigned int mBufferSize;
+    int(*mBufferReleaseCb)(Buffer *buffer);
     std::vector<Buffer*> *mBuffers;
-    std::queue<Buffer*> *mPool;
+    uint8_t *mArena;
+    size_t mArenaSize;
+    bool mArenaMapped;
+    /* Lock-free free list (Treiber stack of buffer indexes): the head
+     * holds a modification tag in the upper 32 bits to prevent ABA
+     * and the index of the first free buffer plus one (0 if empty)
+     * in the lower 32 bits */
+    std::atomic<uint64_t> mHead;
+    std::atomic<unsigned int> *mNext;
+    std::atomic<unsigned int> mFreeCount;
+    std::atomic<unsigned int> mMaxUsedCount;
+    std::atomic<int> mFutex;
+    std::atomic<int> mWaiters;
+    std::atomic<unsigned int> mSignalCount;
+    std::atomic<unsigned int> mSignalSeen;
+};
+
+
+/*
+ * maxDepth bounds the number of queued buffers (0: unbounded) and
+ * policy tells what happens on overflow. A buffer rejected by
+ * pushBuffer() (-1) is still owned by the caller; a buffer dropped by
+ * BUFFER_QUEUE_OVERFLOW_DROP_OLDEST is unreferenced by the queue.
+ * With drop-oldest a buffer returned by peekBuffer() can be dropped
+ * before it is popped: it must not be dereferenced.
+ */
+class BufferQueue
+{
+public:
+
+    BufferQueue(unsigned int maxDepth = 0,
+                buffer_queue_overflow_policy_t policy = BUFFER_QUEUE_OVERFLOW_DROP_NEWEST);
+
+    virtual ~BufferQueue();
+
+    virtual void signal();
+
+    virtual void flush();
+
+    virtual Buffer *peekBuffer(bool blocking);
+
+    virtual Buffer *popBuffer(bool blocking);
+
+    virtual int pushBuffer(Buffer *buffer);
+
+    unsigned int getMaxDepth() { return mMaxDepth; };
+
+    buffer_queue_overflow_policy_t getOverflowPolicy() { return mPolicy; };
+
+    unsigned int getPushCount() { return mPushCount; };
+
+    unsigned int getDropCount() { return mDropCount; };
+
+protected:
+
+    unsigned int mMaxDepth;
+    buffer_queue_overflow_policy_t mPolicy;
+    std::atomic<unsigned int> mPushCount;
+    std::atomic<unsigned int> mDropCount;
+
+private:
+
+    std::queue<Buffer*> *mQueue;
+    bool mSignaled;
+    unsigned int mSignalCount;
     pthread_mutex_t mMutex;
     pthread_cond_t mCond;
+    pthread_cond_t mSpaceCond;
 };
 
 
-class BufferQueue
+/*
+ * Bounded lock-free single-producer/single-consumer queue:
+ * pushBuffer() must always be called from the same thread and
+ * peekBuffer()/popBuffer()/flush() from another single thread.
+ * Blocking waits use a futex; signal() wakes the current blocking
+ * wait, or the next one if the consumer is not waiting, and a
+ * producer blocked on a full queue. The queue cannot be unbounded:
+ * a zero capacity means SPSC_BUFFER_QUEUE_DEFAULT_CAPACITY.
+ */
+class SpscBufferQueue : public BufferQueue
 {
 public:
 
-    BufferQueue();
+    SpscBufferQueue(unsigned int capacity,
+                    buffer_queue_overflow_policy_t policy = BUFFER_QUEUE_OVERFLOW_DROP_NEWEST);
 
-    ~BufferQueue();
+    ~SpscBufferQueue();
 
     void signal();
 
@@ -190,13 +315,27 @@ public:
 
     Buffer *popBuffer(bool blocking);
 
-    void pushBuffer(Buffer *buffer);
+    int pushBuffer(Buffer *buffer);
 
 private:
 
-    std::queue<Buffer*> *mQueue;
-    pthread_mutex_t mMutex;
-    pthread_cond_t mCond;
+    void wake();
+
+    void wakeProducer();
+
+    Buffer *peek(bool blocking, unsigned int *head);
+
+    Buffer **mRing;
+    unsigned int mCapacity;
+    unsigned int mMask;
+    std::atomic<unsigned int> mHead;
+    std::atomic<unsigned int> mTail;
+    std::atomic<int> mFutex;
+    std::atomic<int> mWaiters;
+    std::atomic<unsigned int> mSignalCount;
+    unsigned int mSignalSeen;
+    std::atomic<int> mSpaceFutex;
+    std::atomic<int> mSpaceWaiters;
 };
 
 }
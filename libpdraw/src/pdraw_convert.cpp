@@ -0,0 +1,504 @@
+/**
+ * @file pdraw_convert.cpp
+ * @brief Parrot Drones Awesome Video Viewer Library - frame color conversion
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PDRAW_CONVERT_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PDRAW_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pdraw_convert.hpp"
+#include "pdraw_copy.hpp"
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+/*
+ * The luma (Q14) and chroma (Q13) coefficients are applied with a
+ * rounding high multiply (a * b + 2^14) >> 15 on samples scaled by
+ * 2^7 and 2^8 respectively, which gives RGB values in 6-bit fixed
+ * point that fit in 16-bit lanes
+ */
+#define PDRAW_CONVERT_SHIFT 6
+#define PDRAW_CONVERT_MULHRS(_a, _b) (((_a) * (_b) + 0x4000) >> 15)
+
+
+typedef struct
+{
+    int16_t y;
+    int16_t rv;
+    int16_t gu;
+    int16_t gv;
+    int16_t bu;
+
+} pdraw_convert_coefs_t;
+
+
+/*
+ * Convert a row; chromaStep is 1 for planar chroma, 2 for interleaved
+ * chroma (v = u + 1); bpp is 3 (RGB24 or BGR24 if swap) or 4 (RGBA).
+ */
+typedef void (*pdraw_convert_row_t)(uint8_t *dst, const uint8_t *srcY,
+    const uint8_t *srcU, const uint8_t *srcV, unsigned int chromaStep,
+    unsigned int width, unsigned int bpp, bool swap,
+    const pdraw_convert_coefs_t *coefs);
+
+
+typedef struct
+{
+    const char *name;
+    pdraw_convert_row_t row;
+
+} pdraw_convert_impl_t;
+
+
+/* Limited range BT.601 and BT.709 */
+static const pdraw_convert_coefs_t pdraw_convertBt601 = { 19077, 13075, 3209, 6660, 16525 };
+static const pdraw_convert_coefs_t pdraw_convertBt709 = { 19077, 14686, 1747, 4366, 17305 };
+
+static pthread_once_t pdraw_convertOnce = PTHREAD_ONCE_INIT;
+static pdraw_convert_impl_t pdraw_convertImpl;
+
+
+static inline uint8_t pdraw_convertClamp(int v)
+{
+    return (v < 0) ? 0 : ((v > 255) ? 255 : v);
+}
+
+
+static void pdraw_convertRowC(uint8_t *dst, const uint8_t *srcY,
+    const uint8_t *srcU, const uint8_t *srcV, unsigned int chromaStep,
+    unsigned int width, unsigned int bpp, bool swap,
+    const pdraw_convert_coefs_t *coefs)
+{
+    unsigned int x;
+    int r = (swap) ? 2 : 0, b = (swap) ? 0 : 2;
+    for (x = 0; x < width; x++)
+    {
+        int yy = PDRAW_CONVERT_MULHRS((srcY[x] - 16) * 128, coefs->y) + (1 << (PDRAW_CONVERT_SHIFT - 1));
+        int u = (srcU[(x / 2) * chromaStep] - 128) * 256;
+        int v = (srcV[(x / 2) * chromaStep] - 128) * 256;
+        dst[r] = pdraw_convertClamp((yy + PDRAW_CONVERT_MULHRS(v, coefs->rv)) >> PDRAW_CONVERT_SHIFT);
+        dst[1] = pdraw_convertClamp((yy - PDRAW_CONVERT_MULHRS(u, coefs->gu) - PDRAW_CONVERT_MULHRS(v, coefs->gv)) >> PDRAW_CONVERT_SHIFT);
+        dst[b] = pdraw_convertClamp((yy + PDRAW_CONVERT_MULHRS(u, coefs->bu)) >> PDRAW_CONVERT_SHIFT);
+        if (bpp == 4)
+            dst[3] = 255;
+        dst += bpp;
+    }
+}
+
+
+#ifdef PDRAW_CONVERT_X86
+
+__attribute__((target("ssse3")))
+static void pdraw_convertRowSsse3(uint8_t *dst, const uint8_t *srcY,
+    const uint8_t *srcU, const uint8_t *srcV, unsigned int chromaStep,
+    unsigned int width, unsigned int bpp, bool swap,
+    const pdraw_convert_coefs_t *coefs)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8((char)0xFF);
+    const __m128i lowMask = _mm_set1_epi16(0x00FF);
+    const __m128i c16 = _mm_set1_epi16(16);
+    const __m128i c128 = _mm_set1_epi16(128);
+    const __m128i round = _mm_set1_epi16(1 << (PDRAW_CONVERT_SHIFT - 1));
+    const __m128i cy = _mm_set1_epi16(coefs->y);
+    const __m128i crv = _mm_set1_epi16(coefs->rv);
+    const __m128i cgu = _mm_set1_epi16(coefs->gu);
+    const __m128i cgv = _mm_set1_epi16(coefs->gv);
+    const __m128i cbu = _mm_set1_epi16(coefs->bu);
+    /* Drop the alpha bytes of 4 RGBA pixels */
+    const __m128i rgbShuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    unsigned int x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i y = _mm_loadu_si128((const __m128i*)(srcY + x));
+        __m128i yLo = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(y, zero), c16), 7);
+        __m128i yHi = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(y, zero), c16), 7);
+        yLo = _mm_add_epi16(_mm_mulhrs_epi16(yLo, cy), round);
+        yHi = _mm_add_epi16(_mm_mulhrs_epi16(yHi, cy), round);
+
+        /* 8 chroma samples for 16 pixels */
+        __m128i u, v;
+        if (chromaStep == 1)
+        {
+            u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(srcU + x / 2)), zero);
+            v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(srcV + x / 2)), zero);
+        }
+        else
+        {
+            __m128i uv = _mm_loadu_si128((const __m128i*)(srcU + x));
+            u = _mm_and_si128(uv, lowMask);
+            v = _mm_srli_epi16(uv, 8);
+        }
+        u = _mm_slli_epi16(_mm_sub_epi16(u, c128), 8);
+        v = _mm_slli_epi16(_mm_sub_epi16(v, c128), 8);
+
+        __m128i rt = _mm_mulhrs_epi16(v, crv);
+        __m128i gt = _mm_add_epi16(_mm_mulhrs_epi16(u, cgu), _mm_mulhrs_epi16(v, cgv));
+        __m128i bt = _mm_mulhrs_epi16(u, cbu);
+
+        /* The saturated sums are out of the output range anyway */
+        __m128i r = _mm_packus_epi16(
+            _mm_srai_epi16(_mm_adds_epi16(yLo, _mm_unpacklo_epi16(rt, rt)), PDRAW_CONVERT_SHIFT),
+            _mm_srai_epi16(_mm_adds_epi16(yHi, _mm_unpackhi_epi16(rt, rt)), PDRAW_CONVERT_SHIFT));
+        __m128i g = _mm_packus_epi16(
+            _mm_srai_epi16(_mm_subs_epi16(yLo, _mm_unpacklo_epi16(gt, gt)), PDRAW_CONVERT_SHIFT),
+            _mm_srai_epi16(_mm_subs_epi16(yHi, _mm_unpackhi_epi16(gt, gt)), PDRAW_CONVERT_SHIFT));
+        __m128i b = _mm_packus_epi16(
+            _mm_srai_epi16(_mm_adds_epi16(yLo, _mm_unpacklo_epi16(bt, bt)), PDRAW_CONVERT_SHIFT),
+            _mm_srai_epi16(_mm_adds_epi16(yHi, _mm_unpackhi_epi16(bt, bt)), PDRAW_CONVERT_SHIFT));
+        if (swap)
+        {
+            __m128i tmp = r;
+            r = b;
+            b = tmp;
+        }
+
+        __m128i rgLo = _mm_unpacklo_epi8(r, g);
+        __m128i rgHi = _mm_unpackhi_epi8(r, g);
+        __m128i baLo = _mm_unpacklo_epi8(b, alpha);
+        __m128i baHi = _mm_unpackhi_epi8(b, alpha);
+        __m128i p0 = _mm_unpacklo_epi16(rgLo, baLo);
+        __m128i p1 = _mm_unpackhi_epi16(rgLo, baLo);
+        __m128i p2 = _mm_unpacklo_epi16(rgHi, baHi);
+        __m128i p3 = _mm_unpackhi_epi16(rgHi, baHi);
+
+        if (bpp == 4)
+        {
+            _mm_storeu_si128((__m128i*)dst, p0);
+            _mm_storeu_si128((__m128i*)(dst + 16), p1);
+            _mm_storeu_si128((__m128i*)(dst + 32), p2);
+            _mm_storeu_si128((__m128i*)(dst + 48), p3);
+            dst += 64;
+        }
+        else
+        {
+            /* Each store overwrites the 4 padding bytes of the previous
+             * one; the last one must not write past the 16 pixels */
+            _mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi8(p0, rgbShuffle));
+            _mm_storeu_si128((__m128i*)(dst + 12), _mm_shuffle_epi8(p1, rgbShuffle));
+            _mm_storeu_si128((__m128i*)(dst + 24), _mm_shuffle_epi8(p2, rgbShuffle));
+            p3 = _mm_shuffle_epi8(p3, rgbShuffle);
+            _mm_storel_epi64((__m128i*)(dst + 36), p3);
+            uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(p3, 8));
+            memcpy(dst + 44, &last, 4);
+            dst += 48;
+        }
+    }
+
+    pdraw_convertRowC(dst, srcY + x, srcU + (x / 2) * chromaStep, srcV + (x / 2) * chromaStep,
+                      chromaStep, width - x, bpp, swap, coefs);
+}
+
+#endif /* PDRAW_CONVERT_X86 */
+
+
+#ifdef PDRAW_CONVERT_NEON
+
+static void pdraw_convertRowNeon(uint8_t *dst, const uint8_t *srcY,
+    const uint8_t *srcU, const uint8_t *srcV, unsigned int chromaStep,
+    unsigned int width, unsigned int bpp, bool swap,
+    const pdraw_convert_coefs_t *coefs)
+{
+    const int16x8_t c16 = vdupq_n_s16(16);
+    const int16x8_t c128 = vdupq_n_s16(128);
+    unsigned int x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        uint8x16_t y = vld1q_u8(srcY + x);
+        int16x8_t yLo = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y))), c16), 7);
+        int16x8_t yHi = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y))), c16), 7);
+        yLo = vqrdmulhq_n_s16(yLo, coefs->y);
+        yHi = vqrdmulhq_n_s16(yHi, coefs->y);
+
+        /* 8 chroma samples for 16 pixels */
+        uint8x8_t u8, v8;
+        if (chromaStep == 1)
+        {
+            u8 = vld1_u8(srcU + x / 2);
+            v8 = vld1_u8(srcV + x / 2);
+        }
+        else
+        {
+            uint8x8x2_t uv = vld2_u8(srcU + x);
+            u8 = uv.val[0];
+            v8 = uv.val[1];
+        }
+        int16x8_t u = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), c128), 8);
+        int16x8_t v = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), c128), 8);
+
+        int16x8_t rt1 = vqrdmulhq_n_s16(v, coefs->rv);
+        int16x8_t gt1 = vaddq_s16(vqrdmulhq_n_s16(u, coefs->gu), vqrdmulhq_n_s16(v, coefs->gv));
+        int16x8_t bt1 = vqrdmulhq_n_s16(u, coefs->bu);
+        int16x8x2_t rt = vzipq_s16(rt1, rt1);
+        int16x8x2_t gt = vzipq_s16(gt1, gt1);
+        int16x8x2_t bt = vzipq_s16(bt1, bt1);
+
+        /* Rounding shift and saturation to the output range */
+        uint8x16_t r = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(yLo, rt.val[0]), PDRAW_CONVERT_SHIFT),
+                                   vqrshrun_n_s16(vqaddq_s16(yHi, rt.val[1]), PDRAW_CONVERT_SHIFT));
+        uint8x16_t g = vcombine_u8(vqrshrun_n_s16(vqsubq_s16(yLo, gt.val[0]), PDRAW_CONVERT_SHIFT),
+                                   vqrshrun_n_s16(vqsubq_s16(yHi, gt.val[1]), PDRAW_CONVERT_SHIFT));
+        uint8x16_t b = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(yLo, bt.val[0]), PDRAW_CONVERT_SHIFT),
+                                   vqrshrun_n_s16(vqaddq_s16(yHi, bt.val[1]), PDRAW_CONVERT_SHIFT));
+
+        if (bpp == 4)
+        {
+            uint8x16x4_t rgba;
+            rgba.val[0] = (swap) ? b : r;
+            rgba.val[1] = g;
+            rgba.val[2] = (swap) ? r : b;
+            rgba.val[3] = vdupq_n_u8(255);
+            vst4q_u8(dst, rgba);
+            dst += 64;
+        }
+        else
+        {
+            uint8x16x3_t rgb;
+            rgb.val[0] = (swap) ? b : r;
+            rgb.val[1] = g;
+            rgb.val[2] = (swap) ? r : b;
+            vst3q_u8(dst, rgb);
+            dst += 48;
+        }
+    }
+
+    pdraw_convertRowC(dst, srcY + x, srcU + (x / 2) * chromaStep, srcV + (x / 2) * chromaStep,
+                      chromaStep, width - x, bpp, swap, coefs);
+}
+
+#endif /* PDRAW_CONVERT_NEON */
+
+
+static void pdraw_convertInit(void)
+{
+    pdraw_convertImpl.name = "c";
+    pdraw_convertImpl.row = pdraw_convertRowC;
+
+#if defined(PDRAW_CONVERT_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        pdraw_convertImpl.name = "ssse3";
+        pdraw_convertImpl.row = pdraw_convertRowSsse3;
+    }
+#elif defined(PDRAW_CONVERT_NEON)
+    pdraw_convertImpl.name = "neon";
+    pdraw_convertImpl.row = pdraw_convertRowNeon;
+#endif
+
+    ULOGI("convert: using %s kernels", pdraw_convertImpl.name);
+}
+
+
+static inline const pdraw_convert_impl_t *pdraw_convertGetImpl(void)
+{
+    pthread_once(&pdraw_convertOnce, pdraw_convertInit);
+    return &pdraw_convertImpl;
+}
+
+
+unsigned int pdraw_convertGetFrameSize(pdraw_color_format_t format,
+    unsigned int width, unsigned int height)
+{
+    switch(format)
+    {
+        default:
+        case PDRAW_COLOR_FORMAT_UNKNOWN:
+            return 0;
+        case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+        case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+            return width * height * 3 / 2;
+        case PDRAW_COLOR_FORMAT_RGB24:
+        case PDRAW_COLOR_FORMAT_BGR24:
+            return width * height * 3;
+        case PDRAW_COLOR_FORMAT_RGBA:
+            return width * height * 4;
+        case PDRAW_COLOR_FORMAT_GRAY:
+            return width * height;
+    }
+}
+
+
+static int pdraw_convertYuv(const pdraw_video_frame_t *src,
+    pdraw_video_frame_t *dst, uint8_t *dstBuf)
+{
+    unsigned int width = src->width;
+    unsigned int height = src->height;
+
+    dst->plane[0] = dstBuf;
+    dst->stride[0] = width;
+    pdraw_copyPlane(dst->plane[0], dst->stride[0], src->plane[0], src->stride[0], width, height);
+
+    if (dst->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR)
+    {
+        dst->plane[1] = dstBuf + width * height;
+        dst->plane[2] = dstBuf + width * height * 5 / 4;
+        dst->stride[1] = width / 2;
+        dst->stride[2] = width / 2;
+        if (src->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR)
+        {
+            pdraw_copyPlane(dst->plane[1], dst->stride[1], src->plane[1], src->stride[1], width / 2, height / 2);
+            pdraw_copyPlane(dst->plane[2], dst->stride[2], src->plane[2], src->stride[2], width / 2, height / 2);
+        }
+        else
+        {
+            pdraw_deinterleaveUv(dst->plane[1], dst->stride[1], dst->plane[2], dst->stride[2],
+                                 src->plane[1], src->stride[1], width / 2, height / 2);
+        }
+    }
+    else
+    {
+        dst->plane[1] = dstBuf + width * height;
+        dst->plane[2] = NULL;
+        dst->stride[1] = width;
+        dst->stride[2] = 0;
+        if (src->colorFormat == PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR)
+        {
+            pdraw_copyPlane(dst->plane[1], dst->stride[1], src->plane[1], src->stride[1], width, height / 2);
+        }
+        else
+        {
+            pdraw_interleaveUv(dst->plane[1], dst->stride[1], src->plane[1], src->stride[1],
+                               src->plane[2], src->stride[2], width / 2, height / 2);
+        }
+    }
+
+    return 0;
+}
+
+
+int pdraw_convertFrame(const pdraw_video_frame_t *src,
+    pdraw_video_frame_t *dst, uint8_t *dstBuf,
+    pdraw_color_format_t dstFormat, pdraw_color_matrix_t matrix)
+{
+    if ((!src) || (!dst) || (!dstBuf))
+    {
+        ULOGE("convert: invalid pointer");
+        return -1;
+    }
+    if ((src->colorFormat != PDRAW_COLOR_FORMAT_YUV420PLANAR)
+            && (src->colorFormat != PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR))
+    {
+        ULOGE("convert: unsupported source format (%d)", src->colorFormat);
+        return -1;
+    }
+    if (dstFormat == PDRAW_COLOR_FORMAT_UNKNOWN)
+    {
+        dstFormat = src->colorFormat;
+    }
+
+    memcpy(dst, src, sizeof(*dst));
+    dst->colorFormat = dstFormat;
+
+    unsigned int width = src->width;
+    unsigned int height = src->height;
+    unsigned int bpp = 0;
+    bool swap = false;
+    switch(dstFormat)
+    {
+        default:
+        case PDRAW_COLOR_FORMAT_UNKNOWN:
+            ULOGE("convert: unsupported destination format (%d)", dstFormat);
+            return -1;
+        case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+        case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+            return pdraw_convertYuv(src, dst, dstBuf);
+        case PDRAW_COLOR_FORMAT_GRAY:
+            bpp = 1;
+            break;
+        case PDRAW_COLOR_FORMAT_RGB24:
+            bpp = 3;
+            break;
+        case PDRAW_COLOR_FORMAT_BGR24:
+            bpp = 3;
+            swap = true;
+            break;
+        case PDRAW_COLOR_FORMAT_RGBA:
+            bpp = 4;
+            break;
+    }
+
+    dst->plane[0] = dstBuf;
+    dst->plane[1] = NULL;
+    dst->plane[2] = NULL;
+    dst->stride[0] = width * bpp;
+    dst->stride[1] = 0;
+    dst->stride[2] = 0;
+
+    if (dstFormat == PDRAW_COLOR_FORMAT_GRAY)
+    {
+        /* The luma plane is used as is */
+        pdraw_copyPlane(dst->plane[0], dst->stride[0], src->plane[0], src->stride[0], width, height);
+        return 0;
+    }
+
+    if (matrix == PDRAW_COLOR_MATRIX_AUTO)
+    {
+        matrix = (height >= 720) ? PDRAW_COLOR_MATRIX_BT709 : PDRAW_COLOR_MATRIX_BT601;
+    }
+    const pdraw_convert_coefs_t *coefs = (matrix == PDRAW_COLOR_MATRIX_BT709) ?
+        &pdraw_convertBt709 : &pdraw_convertBt601;
+    const pdraw_convert_impl_t *impl = pdraw_convertGetImpl();
+    unsigned int chromaStep = (src->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR) ? 1 : 2;
+    const uint8_t *srcV = (chromaStep == 1) ? src->plane[2] : src->plane[1] + 1;
+    unsigned int y;
+    for (y = 0; y < height; y++)
+    {
+        impl->row(dstBuf + y * dst->stride[0], src->plane[0] + y * src->stride[0],
+                  src->plane[1] + (y / 2) * src->stride[1], srcV + (y / 2) * src->stride[chromaStep == 1 ? 2 : 1],
+                  chromaStep, width, bpp, swap, coefs);
+    }
+
+    return 0;
+}
+
+
+const char *pdraw_convertGetImplName(void)
+{
+    return pdraw_convertGetImpl()->name;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file pdraw_convert.hpp
+ * @brief Parrot Drones Awesome Video Viewer Library - frame color conversion
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_CONVERT_HPP_
+#define _PDRAW_CONVERT_HPP_
+
+#include <inttypes.h>
+
+#include <pdraw/pdraw_defs.h>
+
+
+/*
+ * Size of a compact frame (no stride padding) in the given format;
+ * 0 if the format is unknown.
+ */
+unsigned int pdraw_convertGetFrameSize(pdraw_color_format_t format,
+    unsigned int width, unsigned int height);
+
+
+/*
+ * Convert a YUV 4:2:0 frame into dstBuf (of at least
+ * pdraw_convertGetFrameSize() bytes) in dstFormat; the destination
+ * frame is a copy of the source frame with its format, planes and
+ * strides updated. PDRAW_COLOR_FORMAT_UNKNOWN keeps the source format.
+ * RGB conversions use limited range BT.601 or BT.709 coefficients.
+ */
+int pdraw_convertFrame(const pdraw_video_frame_t *src,
+    pdraw_video_frame_t *dst, uint8_t *dstBuf,
+    pdraw_color_format_t dstFormat, pdraw_color_matrix_t matrix);
+
+
+/* Name of the kernels selected at runtime ("ssse3", "neon", "c") */
+const char *pdraw_convertGetImplName(void);
+
+#endif /* !_PDRAW_CONVERT_HPP_ */
@@ -0,0 +1,398 @@
+/**
+ * @file pdraw_copy.cpp
+ * @brief Parrot Drones Awesome Video Viewer Library - frame copy kernels
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PDRAW_COPY_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PDRAW_COPY_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pdraw_copy.hpp"
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+typedef struct
+{
+    const char *name;
+    void (*copyRowNt)(uint8_t *dst, const uint8_t *src, unsigned int len);
+    void (*interleaveRow)(uint8_t *dst, const uint8_t *srcU, const uint8_t *srcV, unsigned int len);
+    void (*deinterleaveRow)(uint8_t *dstU, uint8_t *dstV, const uint8_t *src, unsigned int len);
+    void (*fence)(void);
+
+} pdraw_copy_impl_t;
+
+
+static pthread_once_t pdraw_copyOnce = PTHREAD_ONCE_INIT;
+static pdraw_copy_impl_t pdraw_copyImpl;
+
+
+/* Scalar kernels; plain copies always use memcpy, which is already
+ * vectorized by the C library */
+
+static void pdraw_copyRowNtC(uint8_t *dst, const uint8_t *src, unsigned int len)
+{
+    memcpy(dst, src, len);
+}
+
+
+static void pdraw_interleaveRowC(uint8_t *dst, const uint8_t *srcU, const uint8_t *srcV, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i < len; i++)
+    {
+        dst[2 * i] = srcU[i];
+        dst[2 * i + 1] = srcV[i];
+    }
+}
+
+
+static void pdraw_deinterleaveRowC(uint8_t *dstU, uint8_t *dstV, const uint8_t *src, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i < len; i++)
+    {
+        dstU[i] = src[2 * i];
+        dstV[i] = src[2 * i + 1];
+    }
+}
+
+
+static void pdraw_fenceC(void)
+{
+}
+
+
+#ifdef PDRAW_COPY_X86
+
+__attribute__((target("sse2")))
+static void pdraw_copyRowNtSse2(uint8_t *dst, const uint8_t *src, unsigned int len)
+{
+    /* Align the destination for the streaming stores */
+    unsigned int head = (16 - ((uintptr_t)dst & 15)) & 15;
+    if (head > len)
+        head = len;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    len -= head;
+
+    while (len >= 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)src);
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+        _mm_stream_si128((__m128i*)dst, a);
+        _mm_stream_si128((__m128i*)(dst + 16), b);
+        _mm_stream_si128((__m128i*)(dst + 32), c);
+        _mm_stream_si128((__m128i*)(dst + 48), d);
+        src += 64;
+        dst += 64;
+        len -= 64;
+    }
+
+    memcpy(dst, src, len);
+}
+
+
+__attribute__((target("sse2")))
+static void pdraw_interleaveRowSse2(uint8_t *dst, const uint8_t *srcU, const uint8_t *srcV, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i u = _mm_loadu_si128((const __m128i*)(srcU + i));
+        __m128i v = _mm_loadu_si128((const __m128i*)(srcV + i));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_unpacklo_epi8(u, v));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i + 16), _mm_unpackhi_epi8(u, v));
+    }
+    pdraw_interleaveRowC(dst + 2 * i, srcU + i, srcV + i, len - i);
+}
+
+
+__attribute__((target("sse2")))
+static void pdraw_deinterleaveRowSse2(uint8_t *dstU, uint8_t *dstV, const uint8_t *src, unsigned int len)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    unsigned int i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 2 * i + 16));
+        __m128i u = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+        __m128i v = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+        _mm_storeu_si128((__m128i*)(dstU + i), u);
+        _mm_storeu_si128((__m128i*)(dstV + i), v);
+    }
+    pdraw_deinterleaveRowC(dstU + i, dstV + i, src + 2 * i, len - i);
+}
+
+
+__attribute__((target("sse2")))
+static void pdraw_fenceSse2(void)
+{
+    /* Order the streaming stores before the frame is published */
+    _mm_sfence();
+}
+
+
+__attribute__((target("avx2")))
+static void pdraw_copyRowNtAvx2(uint8_t *dst, const uint8_t *src, unsigned int len)
+{
+    /* Align the destination for the streaming stores */
+    unsigned int head = (32 - ((uintptr_t)dst & 31)) & 31;
+    if (head > len)
+        head = len;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    len -= head;
+
+    while (len >= 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)src);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + 96));
+        _mm256_stream_si256((__m256i*)dst, a);
+        _mm256_stream_si256((__m256i*)(dst + 32), b);
+        _mm256_stream_si256((__m256i*)(dst + 64), c);
+        _mm256_stream_si256((__m256i*)(dst + 96), d);
+        src += 128;
+        dst += 128;
+        len -= 128;
+    }
+
+    memcpy(dst, src, len);
+}
+
+
+__attribute__((target("avx2")))
+static void pdraw_interleaveRowAvx2(uint8_t *dst, const uint8_t *srcU, const uint8_t *srcV, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i u = _mm256_loadu_si256((const __m256i*)(srcU + i));
+        __m256i v = _mm256_loadu_si256((const __m256i*)(srcV + i));
+        /* The unpacks work on 128-bit lanes */
+        __m256i lo = _mm256_unpacklo_epi8(u, v);
+        __m256i hi = _mm256_unpackhi_epi8(u, v);
+        _mm256_storeu_si256((__m256i*)(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    pdraw_interleaveRowSse2(dst + 2 * i, srcU + i, srcV + i, len - i);
+}
+
+
+__attribute__((target("avx2")))
+static void pdraw_deinterleaveRowAvx2(uint8_t *dstU, uint8_t *dstV, const uint8_t *src, unsigned int len)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    unsigned int i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + 2 * i + 32));
+        __m256i u = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i v = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        /* The packs work on 128-bit lanes */
+        _mm256_storeu_si256((__m256i*)(dstU + i), _mm256_permute4x64_epi64(u, 0xD8));
+        _mm256_storeu_si256((__m256i*)(dstV + i), _mm256_permute4x64_epi64(v, 0xD8));
+    }
+    pdraw_deinterleaveRowSse2(dstU + i, dstV + i, src + 2 * i, len - i);
+}
+
+#endif /* PDRAW_COPY_X86 */
+
+
+#ifdef PDRAW_COPY_NEON
+
+static void pdraw_interleaveRowNeon(uint8_t *dst, const uint8_t *srcU, const uint8_t *srcV, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(srcU + i);
+        uv.val[1] = vld1q_u8(srcV + i);
+        vst2q_u8(dst + 2 * i, uv);
+    }
+    pdraw_interleaveRowC(dst + 2 * i, srcU + i, srcV + i, len - i);
+}
+
+
+static void pdraw_deinterleaveRowNeon(uint8_t *dstU, uint8_t *dstV, const uint8_t *src, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        uint8x16x2_t uv = vld2q_u8(src + 2 * i);
+        vst1q_u8(dstU + i, uv.val[0]);
+        vst1q_u8(dstV + i, uv.val[1]);
+    }
+    pdraw_deinterleaveRowC(dstU + i, dstV + i, src + 2 * i, len - i);
+}
+
+#endif /* PDRAW_COPY_NEON */
+
+
+static void pdraw_copyInit(void)
+{
+    pdraw_copyImpl.name = "c";
+    pdraw_copyImpl.copyRowNt = pdraw_copyRowNtC;
+    pdraw_copyImpl.interleaveRow = pdraw_interleaveRowC;
+    pdraw_copyImpl.deinterleaveRow = pdraw_deinterleaveRowC;
+    pdraw_copyImpl.fence = pdraw_fenceC;
+
+#if defined(PDRAW_COPY_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        pdraw_copyImpl.name = "avx2";
+        pdraw_copyImpl.copyRowNt = pdraw_copyRowNtAvx2;
+        pdraw_copyImpl.interleaveRow = pdraw_interleaveRowAvx2;
+        pdraw_copyImpl.deinterleaveRow = pdraw_deinterleaveRowAvx2;
+        pdraw_copyImpl.fence = pdraw_fenceSse2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        pdraw_copyImpl.name = "sse2";
+        pdraw_copyImpl.copyRowNt = pdraw_copyRowNtSse2;
+        pdraw_copyImpl.interleaveRow = pdraw_interleaveRowSse2;
+        pdraw_copyImpl.deinterleaveRow = pdraw_deinterleaveRowSse2;
+        pdraw_copyImpl.fence = pdraw_fenceSse2;
+    }
+#elif defined(PDRAW_COPY_NEON)
+    /* No non-temporal store intrinsic: streaming copies use memcpy */
+    pdraw_copyImpl.name = "neon";
+    pdraw_copyImpl.interleaveRow = pdraw_interleaveRowNeon;
+    pdraw_copyImpl.deinterleaveRow = pdraw_deinterleaveRowNeon;
+#endif
+
+    ULOGI("copy: using %s kernels", pdraw_copyImpl.name);
+}
+
+
+static inline const pdraw_copy_impl_t *pdraw_copyGetImpl(void)
+{
+    pthread_once(&pdraw_copyOnce, pdraw_copyInit);
+    return &pdraw_copyImpl;
+}
+
+
+void pdraw_copyPlane(uint8_t *dst, unsigned int dstStride,
+    const uint8_t *src, unsigned int srcStride,
+    unsigned int width, unsigned int height)
+{
+    if ((dstStride == width) && (srcStride == width))
+    {
+        /* No padding: copy the plane at once */
+        width *= height;
+        height = 1;
+    }
+
+    if (width * height < PDRAW_COPY_NON_TEMPORAL_THRESHOLD)
+    {
+        unsigned int y;
+        for (y = 0; y < height; y++)
+        {
+            memcpy(dst, src, width);
+            src += srcStride;
+            dst += dstStride;
+        }
+        return;
+    }
+
+    const pdraw_copy_impl_t *impl = pdraw_copyGetImpl();
+    unsigned int y;
+    for (y = 0; y < height; y++)
+    {
+        impl->copyRowNt(dst, src, width);
+        src += srcStride;
+        dst += dstStride;
+    }
+    impl->fence();
+}
+
+
+void pdraw_interleaveUv(uint8_t *dstUv, unsigned int dstStride,
+    const uint8_t *srcU, unsigned int srcUStride,
+    const uint8_t *srcV, unsigned int srcVStride,
+    unsigned int width, unsigned int height)
+{
+    const pdraw_copy_impl_t *impl = pdraw_copyGetImpl();
+    unsigned int y;
+    for (y = 0; y < height; y++)
+    {
+        impl->interleaveRow(dstUv, srcU, srcV, width);
+        srcU += srcUStride;
+        srcV += srcVStride;
+        dstUv += dstStride;
+    }
+}
+
+
+void pdraw_deinterleaveUv(uint8_t *dstU, unsigned int dstUStride,
+    uint8_t *dstV, unsigned int dstVStride,
+    const uint8_t *srcUv, unsigned int srcStride,
+    unsigned int width, unsigned int height)
+{
+    const pdraw_copy_impl_t *impl = pdraw_copyGetImpl();
+    unsigned int y;
+    for (y = 0; y < height; y++)
+    {
+        impl->deinterleaveRow(dstU, dstV, srcUv, width);
+        srcUv += srcStride;
+        dstU += dstUStride;
+        dstV += dstVStride;
+    }
+}
+
+
+const char *pdraw_copyGetImplName(void)
+{
+    return pdraw_copyGetImpl()->name;
+}
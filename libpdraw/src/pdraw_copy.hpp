@@ -0,0 +1,82 @@
+/**
+ * @file pdraw_copy.hpp
+ * @brief Parrot Drones Awesome Video Viewer Library - frame copy kernels
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_COPY_HPP_
+#define _PDRAW_COPY_HPP_
+
+#include <inttypes.h>
+
+
+/* Planes larger than this are copied with non-temporal stores
+ * (the destination is not expected to be in cache) */
+#define PDRAW_COPY_NON_TEMPORAL_THRESHOLD (1024 * 1024)
+
+
+/*
+ * Copy a plane, removing the source stride padding.
+ * width is in bytes.
+ */
+void pdraw_copyPlane(uint8_t *dst, unsigned int dstStride,
+    const uint8_t *src, unsigned int srcStride,
+    unsigned int width, unsigned int height);
+
+
+/*
+ * Interleave U and V planes into a UV plane (I420 to NV12 chroma).
+ * width is the chroma width in samples.
+ */
+void pdraw_interleaveUv(uint8_t *dstUv, unsigned int dstStride,
+    const uint8_t *srcU, unsigned int srcUStride,
+    const uint8_t *srcV, unsigned int srcVStride,
+    unsigned int width, unsigned int height);
+
+
+/*
+ * Deinterleave a UV plane into U and V planes (NV12 to I420 chroma).
+ * width is the chroma width in samples.
+ */
+void pdraw_deinterleaveUv(uint8_t *dstU, unsigned int dstUStride,
+    uint8_t *dstV, unsigned int dstVStride,
+    const uint8_t *srcUv, unsigned int srcStride,
+    unsigned int width, unsigned int height);
+
+
+/* Name of the kernels selected at runtime ("avx2", "sse2", "neon", "c") */
+const char *pdraw_copyGetImplName(void);
+
+#endif /* !_PDRAW_COPY_HPP_ */
@@ -0,0 +1,367 @@
+/**
+ * @file pdraw_decoder_pool.cpp
+ * @brief Parrot Drones Awesome Video Viewer Library - shared decoder worker pool
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_decoder_pool.hpp"
+
+#include <unistd.h>
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+namespace Pdraw
+{
+
+
+DecoderPool *DecoderPool::getInstance()
+{
+    static DecoderPool instance;
+    return &instance;
+}
+
+
+DecoderPool::DecoderPool()
+{
+    mWorkerCount = 0;
+    mWorkersShouldStop = false;
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_mutex_init(&mWorkersMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+    pthread_cond_init(&mJobDoneCond, NULL);
+}
+
+
+DecoderPool::~DecoderPool()
+{
+    pthread_mutex_lock(&mMutex);
+    mWorkersShouldStop = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    std::vector<pthread_t>::iterator w;
+    for (w = mWorkers.begin(); w != mWorkers.end(); w++)
+        pthread_join(*w, NULL);
+    mWorkers.clear();
+
+    std::vector<decoder_pool_client_t*>::iterator c;
+    for (c = mClients.begin(); c != mClients.end(); c++)
+        delete *c;
+    mClients.clear();
+    mReadyQueue.clear();
+
+    pthread_mutex_destroy(&mMutex);
+    pthread_mutex_destroy(&mWorkersMutex);
+    pthread_cond_destroy(&mCond);
+    pthread_cond_destroy(&mJobDoneCond);
+}
+
+
+int DecoderPool::setWorkerCount(unsigned int count)
+{
+    if (count > DECODER_POOL_MAX_WORKER_COUNT)
+    {
+        ULOGE("DecoderPool: invalid worker count %d", count);
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    mWorkerCount = count;
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+unsigned int DecoderPool::getWorkerCount()
+{
+    pthread_mutex_lock(&mMutex);
+    unsigned int count = (mWorkers.size() > 0) ? mWorkers.size() : mWorkerCount;
+    pthread_mutex_unlock(&mMutex);
+
+    if (count == 0)
+    {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (cpuCount > 0) ? (unsigned int)cpuCount : 1;
+    }
+
+    return count;
+}
+
+
+int DecoderPool::addClient(DecoderPoolClient *client)
+{
+    if (!client)
+    {
+        ULOGE("DecoderPool: invalid client");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mWorkersMutex);
+    pthread_mutex_lock(&mMutex);
+
+    if (findClient(client))
+    {
+        pthread_mutex_unlock(&mMutex);
+        pthread_mutex_unlock(&mWorkersMutex);
+        ULOGE("DecoderPool: client already registered");
+        return -1;
+    }
+
+    if ((mClients.size() == 0) && (startWorkers() != 0))
+    {
+        pthread_mutex_unlock(&mMutex);
+        pthread_mutex_unlock(&mWorkersMutex);
+        return -1;
+    }
+
+    decoder_pool_client_t *c = new decoder_pool_client_t;
+    c->client = client;
+    c->queued = false;
+    c->running = false;
+    c->notified = false;
+    mClients.push_back(c);
+
+    pthread_mutex_unlock(&mMutex);
+    pthread_mutex_unlock(&mWorkersMutex);
+
+    return 0;
+}
+
+
+int DecoderPool::removeClient(DecoderPoolClient *client)
+{
+    pthread_mutex_lock(&mMutex);
+
+    decoder_pool_client_t *c = findClient(client);
+    if (!c)
+    {
+        pthread_mutex_unlock(&mMutex);
+        ULOGE("DecoderPool: client not found");
+        return -1;
+    }
+
+    while (c->running)
+        pthread_cond_wait(&mJobDoneCond, &mMutex);
+
+    std::deque<decoder_pool_client_t*>::iterator q;
+    for (q = mReadyQueue.begin(); q != mReadyQueue.end(); q++)
+    {
+        if (*q == c)
+        {
+            mReadyQueue.erase(q);
+            break;
+        }
+    }
+
+    std::vector<decoder_pool_client_t*>::iterator it;
+    for (it = mClients.begin(); it != mClients.end(); it++)
+    {
+        if (*it == c)
+        {
+            mClients.erase(it);
+            break;
+        }
+    }
+    delete c;
+
+    bool stop = (mClients.size() == 0);
+
+    pthread_mutex_unlock(&mMutex);
+
+    if (stop)
+        stopWorkers();
+
+    return 0;
+}
+
+
+void DecoderPool::notify(DecoderPoolClient *client)
+{
+    pthread_mutex_lock(&mMutex);
+
+    decoder_pool_client_t *c = findClient(client);
+    if (c)
+    {
+        if (c->running)
+        {
+            /* requeued by the worker when the current job is done */
+            c->notified = true;
+        }
+        else if (!c->queued)
+        {
+            c->queued = true;
+            mReadyQueue.push_back(c);
+            pthread_cond_signal(&mCond);
+        }
+    }
+
+    pthread_mutex_unlock(&mMutex);
+}
+
+
+decoder_pool_client_t *DecoderPool::findClient(DecoderPoolClient *client)
+{
+    std::vector<decoder_pool_client_t*>::iterator c;
+    for (c = mClients.begin(); c != mClients.end(); c++)
+    {
+        if ((*c)->client == client)
+            return *c;
+    }
+
+    return NULL;
+}
+
+
+int DecoderPool::startWorkers()
+{
+    if (mWorkers.size() > 0)
+    {
+        /* still running, the last client was removed meanwhile */
+        mWorkersShouldStop = false;
+        return 0;
+    }
+
+    unsigned int count = mWorkerCount;
+    if (count == 0)
+    {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (cpuCount > 0) ? (unsigned int)cpuCount : 1;
+        if (count > DECODER_POOL_MAX_WORKER_COUNT)
+            count = DECODER_POOL_MAX_WORKER_COUNT;
+    }
+
+    mWorkersShouldStop = false;
+
+    unsigned int i;
+    for (i = 0; i < count; i++)
+    {
+        pthread_t thread;
+        int thErr = pthread_create(&thread, NULL, runWorkerThread, (void*)this);
+        if (thErr != 0)
+        {
+            ULOGE("DecoderPool: worker thread creation failed (%d)", thErr);
+            break;
+        }
+        mWorkers.push_back(thread);
+    }
+
+    if (mWorkers.size() == 0)
+        return -1;
+
+    ULOGI("DecoderPool: started %zu workers", mWorkers.size());
+
+    return 0;
+}
+
+
+void DecoderPool::stopWorkers()
+{
+    std::vector<pthread_t> workers;
+
+    pthread_mutex_lock(&mWorkersMutex);
+    pthread_mutex_lock(&mMutex);
+    if (mClients.size() > 0)
+    {
+        /* a new client was added meanwhile */
+        pthread_mutex_unlock(&mMutex);
+        pthread_mutex_unlock(&mWorkersMutex);
+        return;
+    }
+    mWorkersShouldStop = true;
+    workers.swap(mWorkers);
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    std::vector<pthread_t>::iterator w;
+    for (w = workers.begin(); w != workers.end(); w++)
+        pthread_join(*w, NULL);
+
+    pthread_mutex_unlock(&mWorkersMutex);
+
+    if (workers.size() > 0)
+        ULOGI("DecoderPool: stopped %zu workers", workers.size());
+}
+
+
+void* DecoderPool::runWorkerThread(void *ptr)
+{
+    DecoderPool *pool = (DecoderPool*)ptr;
+
+    pthread_mutex_lock(&pool->mMutex);
+
+    while (!pool->mWorkersShouldStop)
+    {
+        if (pool->mReadyQueue.size() == 0)
+        {
+            pthread_cond_wait(&pool->mCond, &pool->mMutex);
+            continue;
+        }
+
+        decoder_pool_client_t *c = pool->mReadyQueue.front();
+        pool->mReadyQueue.pop_front();
+        c->queued = false;
+        c->running = true;
+        c->notified = false;
+
+        pthread_mutex_unlock(&pool->mMutex);
+
+        bool pending = c->client->runPoolJob();
+
+        pthread_mutex_lock(&pool->mMutex);
+
+        c->running = false;
+
+        if ((pending) || (c->notified))
+        {
+            /* back of the queue: round-robin between the clients */
+            c->queued = true;
+            c->notified = false;
+            pool->mReadyQueue.push_back(c);
+            pthread_cond_signal(&pool->mCond);
+        }
+
+        pthread_cond_broadcast(&pool->mJobDoneCond);
+    }
+
+    pthread_mutex_unlock(&pool->mMutex);
+
+    return NULL;
+}
+
+}
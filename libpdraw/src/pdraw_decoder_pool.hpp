@@ -0,0 +1,133 @@
+/**
+ * @file pdraw_decoder_pool.hpp
+ * @brief Parrot Drones Awesome Video Viewer Library - shared decoder worker pool
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_DECODER_POOL_HPP_
+#define _PDRAW_DECODER_POOL_HPP_
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <vector>
+#include <deque>
+
+
+#define DECODER_POOL_MAX_WORKER_COUNT 64
+
+
+namespace Pdraw
+{
+
+
+/*
+ * Decoder running its jobs on the shared worker pool instead of a
+ * dedicated thread; the jobs of a client are never run concurrently
+ */
+class DecoderPoolClient
+{
+public:
+
+    virtual ~DecoderPoolClient() {};
+
+    /* Run one job (one access unit); returns true if more work is pending */
+    virtual bool runPoolJob() = 0;
+};
+
+
+typedef struct
+{
+    DecoderPoolClient *client;
+    bool queued;
+    bool running;
+    bool notified;
+
+} decoder_pool_client_t;
+
+
+/*
+ * Process-wide pool of decoding threads shared by all the sessions: the
+ * clients with pending work are served in round-robin order, one job
+ * at a time, so that no stream can starve the others. The workers are
+ * started with the first client and stopped with the last one.
+ */
+class DecoderPool
+{
+public:
+
+    static DecoderPool *getInstance();
+
+    /* Applied when the workers are next started (0: one per CPU) */
+    int setWorkerCount(unsigned int count);
+
+    unsigned int getWorkerCount();
+
+    int addClient(DecoderPoolClient *client);
+
+    /* Waits for the running job of the client, if any */
+    int removeClient(DecoderPoolClient *client);
+
+    /* Work is available for the client */
+    void notify(DecoderPoolClient *client);
+
+private:
+
+    DecoderPool();
+
+    ~DecoderPool();
+
+    decoder_pool_client_t *findClient(DecoderPoolClient *client);
+
+    /* Called with mWorkersMutex and mMutex held */
+    int startWorkers();
+
+    void stopWorkers();
+
+    static void* runWorkerThread(void *ptr);
+
+    pthread_mutex_t mMutex;
+    pthread_mutex_t mWorkersMutex;
+    pthread_cond_t mCond;
+    pthread_cond_t mJobDoneCond;
+    std::vector<decoder_pool_client_t*> mClients;
+    std::deque<decoder_pool_client_t*> mReadyQueue;
+    std::vector<pthread_t> mWorkers;
+    unsigned int mWorkerCount;
+    bool mWorkersShouldStop;
+};
+
+}
+
+#endif /* !_PDRAW_DECODER_POOL_HPP_ */
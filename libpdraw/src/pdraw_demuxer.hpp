@@ -92,18 +92,22 @@ public:
     virtual int stop() = 0;
 
     virtual int seekTo
-            (uint64_t timestamp) = 0;
+            (uint64_t timestamp, bool exact) = 0;
 
     virtual int seekForward
-            (uint64_t delta) = 0;
+            (uint64_t delta, bool exact) = 0;
 
     virtual int seekBack
-            (uint64_t delta) = 0;
+            (uint64_t delta, bool exact) = 0;
 
     virtual uint64_t getDuration() = 0;
 
     virtual uint64_t getCurrentTime() = 0;
 
+    virtual int setSpeed(float speed) = 0;
+
+    virtual float getSpeed() = 0;
+
     virtual Session *getSession() = 0;
 
 protected:
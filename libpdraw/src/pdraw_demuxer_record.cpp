@@ -38,8 +38,10 @@
 
 #include "pdraw_demuxer_record.hpp"
 #include "pdraw_session.hpp"
+#include "pdraw_settings.hpp"
 
 #include <stdio.h>
+#include <errno.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
@@ -99,23 +101,23 @@ RecordDemuxer::RecordDemuxer(Session *session)
     mSession = session;
     mConfigured = false;
     mDemux = NULL;
+    mIndex = NULL;
     mRunning = false;
     mDemuxerThreadLaunched = false;
     mThreadShouldStop = false;
-    mVideoTrackCount = 0;
-    mVideoTrackId = 0;
-    mMetadataMimeType = NULL;
-    mFirstFrame = true;
-    mDecoder = NULL;
+    mEndOfFile = false;
+    mDecoderCount = 0;
     mLastFrameOutputTime = 0;
     mLastFrameTimestamp = 0;
     mDuration = 0;
     mCurrentTime = 0;
     mPendingSeekTs = -1;
-    mCurrentBuffer = NULL;
-    mWidth = mHeight = 0;
-    mCropLeft = mCropRight = mCropTop = mCropBottom = 0;
-    mSarWidth = mSarHeight = 0;
+    mPendingSeekExact = false;
+    mSpeed = 1.f;
+    mPacingSpeed = 1.f;
+    mOutputTimeError = 0;
+    mPendingStep = 0;
+    mSeiBuffer = NULL;
     mHfov = mVfov = 0.;
 
     mMetadataBufferSize = 1024;
@@ -131,6 +133,17 @@ RecordDemuxer::RecordDemuxer(Session *session)
         ULOGE("RecordDemuxer: mutex creation failed (%d)", ret);
     }
 
+    /* The pacing timed wait uses the monotonic clock */
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    ret = pthread_cond_init(&mDemuxerCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+    if (ret != 0)
+    {
+        ULOGE("RecordDemuxer: cond creation failed (%d)", ret);
+    }
+
     struct h264_ctx_cbs h264_cbs;
     memset(&h264_cbs, 0, sizeof(h264_cbs));
     h264_cbs.userdata = this;
@@ -145,7 +158,10 @@ RecordDemuxer::RecordDemuxer(Session *session)
 
 RecordDemuxer::~RecordDemuxer()
 {
+    pthread_mutex_lock(&mDemuxerMutex);
     mThreadShouldStop = true;
+    pthread_cond_signal(&mDemuxerCond);
+    pthread_mutex_unlock(&mDemuxerMutex);
 
     if (mDemuxerThreadLaunched)
     {
@@ -155,9 +171,17 @@ RecordDemuxer::~RecordDemuxer()
     }
 
     pthread_mutex_destroy(&mDemuxerMutex);
+    pthread_cond_destroy(&mDemuxerCond);
 
-    if (mCurrentBuffer)
-        mCurrentBuffer->unref();
+    std::vector<record_demuxer_track_t>::iterator t;
+    for (t = mTracks.begin(); t != mTracks.end(); t++)
+    {
+        if (t->currentBuffer)
+            t->currentBuffer->unref();
+        free(t->metadataMimeType);
+    }
+
+    delete mIndex;
 
     if (mDemux)
         mp4_demux_close(mDemux);
@@ -165,15 +189,14 @@ RecordDemuxer::~RecordDemuxer()
         h264_reader_destroy(mH264Reader);
 
     free(mMetadataBuffer);
-    free(mMetadataMimeType);
 }
 
 
-int RecordDemuxer::fetchVideoDimensions()
+int RecordDemuxer::fetchVideoDimensions(record_demuxer_track_t *track)
 {
     uint8_t *spsBuffer = NULL, *ppsBuffer = NULL;
     unsigned int spsSize = 0, ppsSize = 0;
-    int ret = mp4_demux_get_track_avc_decoder_config(mDemux, mVideoTrackId,
+    int ret = mp4_demux_get_track_avc_decoder_config(mDemux, track->trackId,
         &spsBuffer, &spsSize, &ppsBuffer, &ppsSize);
     if (ret != 0)
     {
@@ -182,8 +205,8 @@ int RecordDemuxer::fetchVideoDimensions()
     else
     {
         int _ret = pdraw_videoDimensionsFromH264Sps(spsBuffer, spsSize,
-            &mWidth, &mHeight, &mCropLeft, &mCropRight,
-            &mCropTop, &mCropBottom, &mSarWidth, &mSarHeight);
+            &track->width, &track->height, &track->cropLeft, &track->cropRight,
+            &track->cropTop, &track->cropBottom, &track->sarWidth, &track->sarHeight);
         if (_ret != 0)
         {
             ULOGW("RecordDemuxer: pdraw_videoDimensionsFromH264Sps() failed (%d)", _ret);
@@ -402,11 +425,14 @@ int RecordDemuxer::configure(const std::string &url)
             ret = -1;
         }
 
-        int i, tkCount = 0, found = 0;
+        int i, tkCount = 0;
         struct mp4_media_info info;
         struct mp4_track_info tk;
 
-        ret = mp4_demux_get_media_info(mDemux, &info);
+        if (ret == 0)
+        {
+            ret = mp4_demux_get_media_info(mDemux, &info);
+        }
         if (ret == 0)
         {
             mDuration = info.duration;
@@ -420,38 +446,74 @@ int RecordDemuxer::configure(const std::string &url)
         for (i = 0; i < tkCount; i++)
         {
             ret = mp4_demux_get_track_info(mDemux, i, &tk);
-            if ((ret == 0) && (tk.type == MP4_TRACK_TYPE_VIDEO))
+            if (ret != 0)
             {
-                mVideoTrackId = tk.id;
-                mVideoTrackCount++;
-                if (tk.has_metadata)
-                {
-                    mMetadataMimeType = strdup(tk.metadata_mime_format);
-                }
-                found = 1;
-                break;
+                ULOGW("RecordDemuxer: mp4_demux_get_track_info() failed for track #%d (%d)", i, ret);
+                continue;
             }
+            if (tk.type != MP4_TRACK_TYPE_VIDEO)
+            {
+                continue;
+            }
+
+            record_demuxer_track_t track;
+            memset(&track, 0, sizeof(track));
+            track.trackId = tk.id;
+            track.firstFrame = true;
+            track.exactSeekTs = -1;
+
+            /* Only AVC tracks are supported: the other video tracks are
+             * skipped, the file is still usable if one track is left */
+            if (fetchVideoDimensions(&track) != 0)
+            {
+                ULOGW("RecordDemuxer: skipping unsupported video track ID: %d", tk.id);
+                continue;
+            }
+
+            if (tk.has_metadata)
+            {
+                track.metadataMimeType = strdup(tk.metadata_mime_format);
+            }
+            mTracks.push_back(track);
+            ULOGI("RecordDemuxer: video track #%zu ID: %d", mTracks.size() - 1, tk.id);
         }
 
-        if (found)
+        if (mTracks.size() > 0)
         {
-            ULOGI("RecordDemuxer: video track ID: %d", mVideoTrackId);
+            ret = 0;
         }
-        else
+        else if (mDemux)
         {
-            ULOGE("RecordDemuxer: failed to find a video track");
+            ULOGE("RecordDemuxer: failed to find a supported video track");
             ret = -1;
         }
     }
 
-    if (ret == 0)
+    if ((ret == 0) && (mSession))
     {
-        ret = fetchVideoDimensions();
+        ret = fetchSessionMetadata();
     }
 
-    if ((ret == 0) && (mSession))
+    if ((ret == 0) && (mSession) && (mSession->getSettings()))
     {
-        ret = fetchSessionMetadata();
+        bool indexEnabled = false, indexPersistent = false;
+        mSession->getSettings()->getRecordIndexSettings(&indexEnabled, &indexPersistent);
+        if (indexEnabled)
+        {
+            /* The index is optional: failures only disable it; it is
+             * built on the first video track, which drives the seeks */
+            mIndex = new RecordIndex(mFileName, mTracks[0].trackId, mTracks[0].metadataMimeType, indexPersistent);
+            if (mIndex == NULL)
+            {
+                ULOGE("RecordDemuxer: index allocation failed");
+            }
+            else if (mIndex->start() != 0)
+            {
+                ULOGE("RecordDemuxer: failed to start the index");
+                delete mIndex;
+                mIndex = NULL;
+            }
+        }
     }
 
     if (ret == 0)
@@ -485,8 +547,7 @@ int RecordDemuxer::getElementaryStreamCount()
         return -1;
     }
 
-    //TODO: handle multiple streams
-    return mVideoTrackCount;
+    return mTracks.size();
 }
 
 
@@ -497,13 +558,12 @@ elementary_stream_type_t RecordDemuxer::getElementaryStreamType(int esIndex)
         ULOGE("RecordDemuxer: demuxer is not configured");
         return (elementary_stream_type_t)-1;
     }
-    if ((esIndex < 0) || (esIndex >= mVideoTrackCount))
+    if ((esIndex < 0) || (esIndex >= (int)mTracks.size()))
     {
         ULOGE("RecordDemuxer: invalid ES index");
         return (elementary_stream_type_t)-1;
     }
 
-    //TODO: handle multiple streams
     return ELEMENTARY_STREAM_TYPE_VIDEO_AVC;
 }
 
@@ -519,29 +579,29 @@ int RecordDemuxer::getElementaryStreamVideoDimensions(int esIndex,
         ULOGE("RecordDemuxer: demuxer is not configured");
         return -1;
     }
-    if ((esIndex < 0) || (esIndex >= mVideoTrackCount))
+    if ((esIndex < 0) || (esIndex >= (int)mTracks.size()))
     {
         ULOGE("RecordDemuxer: invalid ES index");
         return -1;
     }
 
-    //TODO: handle multiple streams
+    record_demuxer_track_t *track = &mTracks[esIndex];
     if (width)
-        *width = mWidth;
+        *width = track->width;
     if (height)
-        *height = mHeight;
+        *height = track->height;
     if (cropLeft)
-        *cropLeft = mCropLeft;
+        *cropLeft = track->cropLeft;
     if (cropRight)
-        *cropRight = mCropRight;
+        *cropRight = track->cropRight;
     if (cropTop)
-        *cropTop = mCropTop;
+        *cropTop = track->cropTop;
     if (cropBottom)
-        *cropBottom = mCropBottom;
+        *cropBottom = track->cropBottom;
     if (sarWidth)
-        *sarWidth = mSarWidth;
+        *sarWidth = track->sarWidth;
     if (sarHeight)
-        *sarHeight = mSarHeight;
+        *sarHeight = track->sarHeight;
 
     return 0;
 }
@@ -554,13 +614,13 @@ int RecordDemuxer::getElementaryStreamVideoFov(int esIndex, float *hfov, float *
         ULOGE("RecordDemuxer: demuxer is not configured");
         return -1;
     }
-    if ((esIndex < 0) || (esIndex >= mVideoTrackCount))
+    if ((esIndex < 0) || (esIndex >= (int)mTracks.size()))
     {
         ULOGE("RecordDemuxer: invalid ES index");
         return -1;
     }
 
-    //TODO: handle multiple streams
+    /* The field of view is a recording-level metadata */
     if (hfov)
         *hfov = mHfov;
     if (vfov)
@@ -582,14 +642,20 @@ int RecordDemuxer::setElementaryStreamDecoder(int esIndex, Decoder *decoder)
         ULOGE("RecordDemuxer: invalid decoder");
         return -1;
     }
-    if ((esIndex < 0) || (esIndex >= mVideoTrackCount))
+    if ((esIndex < 0) || (esIndex >= (int)mTracks.size()))
     {
         ULOGE("RecordDemuxer: invalid ES index");
         return -1;
     }
 
-    //TODO: handle multiple streams
-    mDecoder = (AvcDecoder*)decoder;
+    pthread_mutex_lock(&mDemuxerMutex);
+    if (!mTracks[esIndex].decoder)
+    {
+        mDecoderCount++;
+    }
+    mTracks[esIndex].decoder = (AvcDecoder*)decoder;
+    pthread_cond_signal(&mDemuxerCond);
+    pthread_mutex_unlock(&mDemuxerMutex);
 
     return 0;
 }
@@ -603,7 +669,10 @@ int RecordDemuxer::start()
         return -1;
     }
 
+    pthread_mutex_lock(&mDemuxerMutex);
     mRunning = true;
+    pthread_cond_signal(&mDemuxerCond);
+    pthread_mutex_unlock(&mDemuxerMutex);
 
     return 0;
 }
@@ -617,7 +686,10 @@ int RecordDemuxer::pause()
         return -1;
     }
 
+    pthread_mutex_lock(&mDemuxerMutex);
     mRunning = false;
+    pthread_cond_signal(&mDemuxerCond);
+    pthread_mutex_unlock(&mDemuxerMutex);
 
     return 0;
 }
@@ -631,13 +703,16 @@ int RecordDemuxer::stop()
         return -1;
     }
 
+    pthread_mutex_lock(&mDemuxerMutex);
     mThreadShouldStop = true;
+    pthread_cond_signal(&mDemuxerCond);
+    pthread_mutex_unlock(&mDemuxerMutex);
 
     return 0;
 }
 
 
-int RecordDemuxer::seekTo(uint64_t timestamp)
+int RecordDemuxer::seekTo(uint64_t timestamp, bool exact)
 {
     pthread_mutex_lock(&mDemuxerMutex);
 
@@ -650,6 +725,8 @@ int RecordDemuxer::seekTo(uint64_t timestamp)
 
     if (timestamp > mDuration) timestamp = mDuration;
     mPendingSeekTs = (int64_t)timestamp;
+    mPendingSeekExact = exact;
+    pthread_cond_signal(&mDemuxerCond);
 
     pthread_mutex_unlock(&mDemuxerMutex);
 
@@ -657,7 +734,7 @@ int RecordDemuxer::seekTo(uint64_t timestamp)
 }
 
 
-int RecordDemuxer::seekForward(uint64_t delta)
+int RecordDemuxer::seekForward(uint64_t delta, bool exact)
 {
     pthread_mutex_lock(&mDemuxerMutex);
 
@@ -672,6 +749,8 @@ int RecordDemuxer::seekForward(uint64_t delta)
     if (ts < 0) ts = 0;
     if (ts > (int64_t)mDuration) ts = mDuration;
     mPendingSeekTs = ts;
+    mPendingSeekExact = exact;
+    pthread_cond_signal(&mDemuxerCond);
 
     pthread_mutex_unlock(&mDemuxerMutex);
 
@@ -679,7 +758,7 @@ int RecordDemuxer::seekForward(uint64_t delta)
 }
 
 
-int RecordDemuxer::seekBack(uint64_t delta)
+int RecordDemuxer::seekBack(uint64_t delta, bool exact)
 {
     pthread_mutex_lock(&mDemuxerMutex);
 
@@ -694,6 +773,99 @@ int RecordDemuxer::seekBack(uint64_t delta)
     if (ts < 0) ts = 0;
     if (ts > (int64_t)mDuration) ts = mDuration;
     mPendingSeekTs = ts;
+    mPendingSeekExact = exact;
+    pthread_cond_signal(&mDemuxerCond);
+
+    pthread_mutex_unlock(&mDemuxerMutex);
+
+    return 0;
+}
+
+
+int RecordDemuxer::setSpeed(float speed)
+{
+    float absSpeed = (speed < 0.f) ? -speed : speed;
+    if ((speed != PDRAW_PLAYBACK_SPEED_UNTHROTTLED) &&
+        ((absSpeed < PDRAW_PLAYBACK_SPEED_MIN) || (absSpeed > PDRAW_PLAYBACK_SPEED_MAX)))
+    {
+        ULOGE("RecordDemuxer: invalid speed %.2f", speed);
+        return -1;
+    }
+
+    pthread_mutex_lock(&mDemuxerMutex);
+
+    if ((speed < 0.f) && (!isFrameCacheSupported()))
+    {
+        pthread_mutex_unlock(&mDemuxerMutex);
+        ULOGE("RecordDemuxer: reverse playback is not supported by the decoder");
+        return -1;
+    }
+
+    /* Interrupt the current frame wait; the demuxer thread restarts
+     * the frame pacing at the new speed; the end of file (or beginning
+     * of file in reverse) no longer applies when changing direction */
+    if ((speed < 0.f) != (mSpeed < 0.f))
+    {
+        mEndOfFile = false;
+    }
+    mSpeed = speed;
+    pthread_cond_signal(&mDemuxerCond);
+
+    pthread_mutex_unlock(&mDemuxerMutex);
+
+    return 0;
+}
+
+
+int RecordDemuxer::stepForward()
+{
+    pthread_mutex_lock(&mDemuxerMutex);
+
+    if (!mConfigured)
+    {
+        pthread_mutex_unlock(&mDemuxerMutex);
+        ULOGE("RecordDemuxer: demuxer is not configured");
+        return -1;
+    }
+    if (!isFrameCacheSupported())
+    {
+        pthread_mutex_unlock(&mDemuxerMutex);
+        ULOGE("RecordDemuxer: frame stepping is not supported by the decoder");
+        return -1;
+    }
+
+    /* Stepping pauses the playback */
+    mRunning = false;
+    mPendingStep = 1;
+    pthread_cond_signal(&mDemuxerCond);
+
+    pthread_mutex_unlock(&mDemuxerMutex);
+
+    return 0;
+}
+
+
+int RecordDemuxer::stepBack()
+{
+    pthread_mutex_lock(&mDemuxerMutex);
+
+    if (!mConfigured)
+    {
+        pthread_mutex_unlock(&mDemuxerMutex);
+        ULOGE("RecordDemuxer: demuxer is not configured");
+        return -1;
+    }
+    if (!isFrameCacheSupported())
+    {
+        pthread_mutex_unlock(&mDemuxerMutex);
+        ULOGE("RecordDemuxer: frame stepping is not supported by the decoder");
+        return -1;
+    }
+
+    /* Stepping pauses the playback */
+    mRunning = false;
+    mPendingStep = -1;
+    pthread_cond_signal(&mDemuxerCond);
 
     pthread_mutex_unlock(&mDemuxerMutex);
 
@@ -701,6 +873,23 @@ int RecordDemuxer::seekBack(uint64_t delta)
 }
 
 
+int RecordDemuxer::getKeyframeList(pdraw_keyframe_t *keyframes, unsigned int maxCount)
+{
+    if (!mConfigured)
+    {
+        ULOGE("RecordDemuxer: demuxer is not configured");
+        return -1;
+    }
+    if (!mIndex)
+    {
+        ULOGE("RecordDemuxer: the index is not enabled");
+        return -1;
+    }
+
+    return mIndex->getKeyframeList(keyframes, maxCount);
+}
+
+
 void RecordDemuxer::h264UserDataSeiCb(struct h264_ctx *ctx, const uint8_t *buf, size_t len,
                                       const struct h264_sei_user_data_unregistered *sei, void *userdata)
 {
@@ -711,7 +900,7 @@ void RecordDemuxer::h264UserDataSeiCb(struct h264_ctx *ctx, const uint8_t *buf,
         return;
     if ((!buf) || (len == 0))
         return;
-    if (!demuxer->mCurrentBuffer)
+    if (!demuxer->mSeiBuffer)
         return;
 
     /* ignore "Parrot Streaming" v1 and v2 user data SEI */
@@ -721,203 +910,873 @@ void RecordDemuxer::h264UserDataSeiCb(struct h264_ctx *ctx, const uint8_t *buf,
         return;
     }
 
-    ret = demuxer->mCurrentBuffer->setUserDataCapacity(len);
+    ret = demuxer->mSeiBuffer->setUserDataCapacity(len);
     if (ret < (signed)len)
     {
         ULOGE("RecordDemuxer: failed to realloc user data buffer");
         return;
     }
 
-    void *dstBuf = demuxer->mCurrentBuffer->getUserDataPtr();
+    void *dstBuf = demuxer->mSeiBuffer->getUserDataPtr();
     memcpy(dstBuf, buf, len);
-    demuxer->mCurrentBuffer->setUserDataSize(len);
+    demuxer->mSeiBuffer->setUserDataSize(len);
+}
+
+
+int RecordDemuxer::readSample(record_demuxer_track_t *track)
+{
+    uint8_t *spsBuffer = NULL, *ppsBuffer = NULL;
+    unsigned int spsSize = 0, ppsSize = 0;
+    struct mp4_track_sample sample;
+    int ret;
+
+    if (track->firstFrame)
+    {
+        ret = mp4_demux_get_track_avc_decoder_config(mDemux, track->trackId,
+                                                      &spsBuffer, &spsSize, &ppsBuffer, &ppsSize);
+        if (ret != 0)
+        {
+            ULOGE("RecordDemuxer: failed to get decoder configuration (%d)", ret);
+        }
+        else
+        {
+            ret = h264_reader_parse_nalu(mH264Reader, 0, spsBuffer, spsSize);
+            if (ret < 0)
+            {
+                ULOGW("RecordDemuxer: h264_reader_parse_nalu() failed (%d)", ret);
+            }
+            ret = h264_reader_parse_nalu(mH264Reader, 0, ppsBuffer, ppsSize);
+            if (ret < 0)
+            {
+                ULOGW("RecordDemuxer: h264_reader_parse_nalu() failed (%d)", ret);
+            }
+            ret = track->decoder->configure(spsBuffer, (unsigned int)spsSize, ppsBuffer, (unsigned int)ppsSize);
+            if (ret != 0)
+            {
+                ULOGE("RecordDemuxer: decoder configuration failed (%d)", ret);
+            }
+        }
+    }
+
+    if ((track->decoder->isConfigured()) && (track->currentBuffer == NULL))
+    {
+        ret = track->decoder->getInputBuffer(&track->currentBuffer, true);
+        if (ret != 0)
+        {
+            ULOGW("RecordDemuxer: failed to get an output buffer (%d)", ret);
+        }
+    }
+
+    if (!track->currentBuffer)
+    {
+        return -1;
+    }
+
+    uint8_t *buf = (uint8_t*)track->currentBuffer->getPtr();
+    unsigned int bufSize = track->currentBuffer->getCapacity();
+
+    if (track->firstFrame)
+    {
+        /* The parameter sets prefix the first sample and are kept in the
+         * buffer until it is queued */
+        track->headerSize = 0;
+        if ((spsBuffer) && (spsSize + 4 <= bufSize))
+        {
+            *((uint32_t*)buf) = htonl(0x00000001);
+            memcpy(buf + 4, spsBuffer, spsSize);
+            track->headerSize += spsSize + 4;
+        }
+        if ((ppsBuffer) && (track->headerSize + ppsSize + 4 <= bufSize))
+        {
+            *((uint32_t*)(buf + track->headerSize)) = htonl(0x00000001);
+            memcpy(buf + track->headerSize + 4, ppsBuffer, ppsSize);
+            track->headerSize += ppsSize + 4;
+        }
+        track->firstFrame = false;
+    }
+    buf += track->headerSize;
+    bufSize -= track->headerSize;
+
+    memset(&sample, 0, sizeof(sample));
+    ret = mp4_demux_get_track_next_sample(mDemux, track->trackId,
+                                          buf, bufSize, mMetadataBuffer, mMetadataBufferSize, &sample);
+    while (ret == -ENOBUFS)
+    {
+        /* Oversized sample: grow the buffer and retry */
+        unsigned int capacity = track->currentBuffer->getCapacity() * 2;
+        if (track->headerSize + sample.sample_size > capacity)
+        {
+            capacity = track->headerSize + sample.sample_size;
+        }
+        if (track->decoder->growInputBuffer(track->currentBuffer, capacity) != 0)
+        {
+            ULOGE("RecordDemuxer: failed to grow the input buffer to %d bytes", capacity);
+            break;
+        }
+        buf = (uint8_t*)track->currentBuffer->getPtr() + track->headerSize;
+        bufSize = track->currentBuffer->getCapacity() - track->headerSize;
+        memset(&sample, 0, sizeof(sample));
+        ret = mp4_demux_get_track_next_sample(mDemux, track->trackId,
+                                              buf, bufSize, mMetadataBuffer, mMetadataBufferSize, &sample);
+    }
+    if ((ret != 0) || (sample.sample_size == 0))
+    {
+        ULOGI("RecordDemuxer: end of file (track ID: %d)", track->trackId);
+        track->endOfFile = true;
+        return 0;
+    }
+
+    track->currentBuffer->setSize(track->headerSize + sample.sample_size);
+    track->currentBuffer->setUserDataSize(0);
+
+    /* Fix the H.264 bitstream: replace NALU size by byte stream start codes */
+    uint32_t offset = 0, naluSize, naluCount = 0;
+    uint8_t *_buf = buf;
+    uint8_t *seiNalu = NULL;
+    int seiNaluSize = 0;
+    bool isRef = false;
+    while (offset < sample.sample_size)
+    {
+        naluSize = ntohl(*((uint32_t*)_buf));
+        *((uint32_t*)_buf) = htonl(0x00000001);
+        if (*(_buf + 4) == 0x06)
+        {
+            seiNalu = _buf + 4;
+            seiNaluSize = naluSize;
+        }
+        else if ((((*(_buf + 4) & 0x1F) == 0x01) || ((*(_buf + 4) & 0x1F) == 0x05))
+                 && (*(_buf + 4) & 0x60))
+        {
+            /* Slice with nal_ref_idc != 0 */
+            isRef = true;
+        }
+        _buf += 4 + naluSize;
+        offset += 4 + naluSize;
+        naluCount++;
+    }
+
+    if ((seiNalu) && (seiNaluSize))
+    {
+        mSeiBuffer = track->currentBuffer;
+        ret = h264_reader_parse_nalu(mH264Reader, 0, seiNalu, seiNaluSize);
+        if (ret < 0)
+        {
+            ULOGW("RecordDemuxer: h264_reader_parse_nalu() failed (%d)", ret);
+        }
+        mSeiBuffer = NULL;
+    }
+
+    avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)track->currentBuffer->getMetadataPtr();
+    track->currentBuffer->setMetadataSize(sizeof(avc_decoder_input_buffer_t));
+    data->isComplete = true; //TODO?
+    data->hasErrors = false; //TODO?
+    data->isRef = isRef;
+    data->isCached = false;
+    data->isCacheOutput = false;
+    data->isEndOfStream = false;
+    data->isDiscontinuity = track->discontinuity;
+    track->discontinuity = false;
+    data->isRealTime = (mSpeed != PDRAW_PLAYBACK_SPEED_UNTHROTTLED);
+    data->isSilent = ((track->exactSeekTs >= 0) && ((int64_t)sample.sample_dts < track->exactSeekTs));
+    if (!data->isSilent)
+    {
+        track->exactSeekTs = -1;
+    }
+    data->auNtpTimestamp = sample.sample_dts;
+    data->auNtpTimestampRaw = sample.sample_dts;
+    //TODO: auSyncType
+
+    /* Metadata */
+    data->hasMetadata = VideoFrameMetadata::decodeMetadata(mMetadataBuffer, sample.metadata_size,
+        FRAME_METADATA_SOURCE_RECORDING, track->metadataMimeType, &data->metadata);
+
+    track->pending = true;
+    track->pendingDts = sample.sample_dts;
+
+    return 0;
+}
+
+
+uint64_t RecordDemuxer::waitOutputTime(uint64_t timestamp, bool silent, float speed)
+{
+    struct timespec t1;
+    uint64_t curTime, outputTime;
+
+    /* Frame pacing: none when unthrottled (back-pressure only
+     * comes from the decoder input buffers), restarted on
+     * speed change; backward the timestamps decrease */
+    bool pacing = ((speed != PDRAW_PLAYBACK_SPEED_UNTHROTTLED) && (speed == mPacingSpeed) &&
+                   (!silent) && (mLastFrameOutputTime) && (mLastFrameTimestamp));
+    uint64_t tsDelta = (timestamp > mLastFrameTimestamp) ?
+                        timestamp - mLastFrameTimestamp : mLastFrameTimestamp - timestamp;
+    int64_t frameDuration = (pacing) ? (int64_t)((double)tsDelta / ((speed < 0.f) ? -speed : speed)) : 0;
+    mPacingSpeed = speed;
+
+    if (pacing)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        curTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+        int32_t sleepTime = (int32_t)(frameDuration - (int64_t)(curTime - mLastFrameOutputTime)) + mOutputTimeError;
+        if (sleepTime >= 1000)
+        {
+            /* Wait for the frame output time; pause, stop,
+             * seek, step or speed change requests interrupt the wait */
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_sec += sleepTime / 1000000;
+            ts.tv_nsec += (sleepTime % 1000000) * 1000;
+            if (ts.tv_nsec >= 1000000000)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+            pthread_mutex_lock(&mDemuxerMutex);
+            if ((!mThreadShouldStop) && (mRunning) && (mPendingSeekTs < 0) &&
+                (mPendingStep == 0) && (mSpeed == speed))
+            {
+                pthread_cond_timedwait(&mDemuxerCond, &mDemuxerMutex, &ts);
+            }
+            pthread_mutex_unlock(&mDemuxerMutex);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    outputTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+    mOutputTimeError = (pacing) ?
+                        (int32_t)(frameDuration - (int64_t)(outputTime - mLastFrameOutputTime)) : 0;
+
+    return outputTime;
+}
+
+
+bool RecordDemuxer::isFrameCacheSupported()
+{
+    std::vector<record_demuxer_track_t>::iterator t;
+    for (t = mTracks.begin(); t != mTracks.end(); t++)
+    {
+        if ((t->decoder) && (!t->decoder->isFrameCacheSupported()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+unsigned int RecordDemuxer::getFrameCacheMaxCount()
+{
+    /* The decoders tell how many frames their cache can hold (the coded
+     * dimensions are an upper bound of the decoded frame dimensions) */
+    unsigned int maxCount = 0;
+    bool found = false;
+    std::vector<record_demuxer_track_t>::iterator t;
+    for (t = mTracks.begin(); t != mTracks.end(); t++)
+    {
+        if (!t->decoder)
+            continue;
+        unsigned int count = t->decoder->getFrameCacheMaxCount(t->width, t->height);
+        if ((!found) || (count < maxCount))
+            maxCount = count;
+        found = true;
+    }
+
+    return (maxCount > 0) ? maxCount : 1;
+}
+
+
+int RecordDemuxer::findNextSampleTime(uint64_t timestamp, uint64_t *nextTimestamp)
+{
+    struct mp4_track_sample sample;
+    unsigned int trackId = mTracks[0].trackId;
+
+    /* Only the sample times are read, not the sample data */
+    int ret = mp4_demux_seek(mDemux, timestamp, 1);
+    if (ret != 0)
+    {
+        ULOGW("RecordDemuxer: mp4_demux_seek() failed (%d)", ret);
+        return -1;
+    }
+
+    while ((mp4_demux_get_track_next_sample(mDemux, trackId, NULL, 0, NULL, 0, &sample) == 0) &&
+           (sample.sample_size))
+    {
+        if (sample.sample_dts > timestamp)
+        {
+            *nextTimestamp = sample.sample_dts;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+int RecordDemuxer::fillFrameCache(uint64_t end, unsigned int maxCount, uint64_t *start)
+{
+    std::vector<record_demuxer_track_t>::iterator t;
+    struct mp4_track_sample sample;
+    uint64_t cutoff = 0;
+    bool found = false;
+    struct timespec t1;
+    int ret;
+
+    if (end == 0)
+    {
+        return -1;
+    }
+
+    /* First pass: get the times of the samples from the previous sync
+     * sample up to the window end (the sample data is not read) */
+    ret = mp4_demux_seek(mDemux, end - 1, 1);
+    if (ret != 0)
+    {
+        ULOGW("RecordDemuxer: mp4_demux_seek() failed (%d)", ret);
+        return -1;
+    }
+    for (t = mTracks.begin(); t != mTracks.end(); t++)
+    {
+        std::vector<uint64_t> dts;
+        if (!t->decoder)
+            continue;
+        while ((mp4_demux_get_track_next_sample(mDemux, t->trackId, NULL, 0, NULL, 0, &sample) == 0) &&
+               (sample.sample_size) && (sample.sample_dts < end))
+        {
+            dts.push_back(sample.sample_dts);
+        }
+        if (dts.size() > 0)
+        {
+            /* Only the last frames fit in the cache; the cutoff is common
+             * to all tracks so that the next window starts where this
+             * one ends */
+            uint64_t first = dts[(dts.size() > maxCount) ? dts.size() - maxCount : 0];
+            if ((!found) || (first > cutoff))
+                cutoff = first;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        return -1;
+    }
+
+    /* Second pass: decode from the sync sample; the frames before the
+     * cutoff are only decoded as references, the next ones are cached */
+    ret = mp4_demux_seek(mDemux, end - 1, 1);
+    if (ret != 0)
+    {
+        ULOGW("RecordDemuxer: mp4_demux_seek() failed (%d)", ret);
+        return -1;
+    }
+    for (t = mTracks.begin(); t != mTracks.end(); t++)
+    {
+        t->pending = false;
+        t->endOfFile = false;
+        t->exactSeekTs = -1;
+    }
+    mCachedFrames.clear();
+    mStepFrames.clear();
+
+    while (!mThreadShouldStop)
+    {
+        record_demuxer_track_t *next = NULL;
+        for (t = mTracks.begin(); t != mTracks.end(); t++)
+        {
+            if (!t->decoder)
+                continue;
+            if ((!t->pending) && (!t->endOfFile))
+            {
+                if (readSample(&(*t)) != 0)
+                {
+                    t->endOfFile = true;
+                }
+            }
+            /* End of the window for this track: the next sample stays
+             * pending, forward steps resume from it */
+            if ((t->pending) && (t->pendingDts < end) &&
+                ((!next) || (t->pendingDts < next->pendingDts)))
+            {
+                next = &(*t);
+            }
+        }
+        if (!next)
+        {
+            break;
+        }
+
+        avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)next->currentBuffer->getMetadataPtr();
+        data->isCached = (next->pendingDts >= cutoff);
+        data->isSilent = !data->isCached;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        data->demuxOutputTimestamp = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+        data->auNtpTimestampLocal = data->demuxOutputTimestamp;
+
+        ret = next->decoder->queueInputBuffer(next->currentBuffer);
+        if (ret != 0)
+        {
+            ULOGW("RecordDemuxer: failed to release the output buffer (%d)", ret);
+        }
+        else
+        {
+            if (data->isCached)
+            {
+                record_demuxer_cached_frame_t cached;
+                cached.trackIndex = next - &mTracks[0];
+                cached.dts = next->pendingDts;
+                mCachedFrames.push_back(cached);
+            }
+            next->currentBuffer->unref();
+            next->currentBuffer = NULL;
+            next->headerSize = 0;
+        }
+        next->pending = false;
+    }
+
+    *start = cutoff;
+
+    return 0;
+}
+
+
+int RecordDemuxer::outputCachedFrame(float speed)
+{
+    if (mCachedFrames.empty())
+    {
+        return -1;
+    }
+
+    /* The cached frames are output from the last one */
+    record_demuxer_cached_frame_t cached = mCachedFrames.back();
+    mCachedFrames.pop_back();
+
+    return outputCachedFrame(&cached, speed);
+}
+
+
+int RecordDemuxer::outputCachedFrame(const record_demuxer_cached_frame_t *cached, float speed)
+{
+    record_demuxer_track_t *track = &mTracks[cached->trackIndex];
+
+    Buffer *buffer = NULL;
+    int ret = track->decoder->getInputBuffer(&buffer, true);
+    if ((ret != 0) || (!buffer))
+    {
+        ULOGW("RecordDemuxer: failed to get an output buffer (%d)", ret);
+        return -1;
+    }
+
+    buffer->setSize(0);
+    buffer->setUserDataSize(0);
+    buffer->setMetadataSize(sizeof(avc_decoder_input_buffer_t));
+    avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)buffer->getMetadataPtr();
+    memset(data, 0, sizeof(avc_decoder_input_buffer_t));
+    data->isCacheOutput = true;
+    data->auNtpTimestamp = cached->dts;
+    data->auNtpTimestampRaw = cached->dts;
+
+    uint64_t outputTime = waitOutputTime(cached->dts, false, speed);
+    data->demuxOutputTimestamp = outputTime;
+    data->auNtpTimestampLocal = outputTime;
+
+    ret = track->decoder->queueInputBuffer(buffer);
+    if (ret != 0)
+    {
+        ULOGW("RecordDemuxer: failed to release the output buffer (%d)", ret);
+    }
+    else
+    {
+        mLastFrameOutputTime = outputTime;
+        mLastFrameTimestamp = cached->dts;
+        mCurrentTime = cached->dts;
+    }
+    buffer->unref();
+
+    return ret;
+}
+
+
+int RecordDemuxer::queueNextCachedSample()
+{
+    std::vector<record_demuxer_track_t>::iterator t;
+    record_demuxer_track_t *next = NULL;
+    struct timespec t1;
+
+    for (t = mTracks.begin(); t != mTracks.end(); t++)
+    {
+        if (!t->decoder)
+            continue;
+        if ((!t->pending) && (!t->endOfFile))
+        {
+            if (readSample(&(*t)) != 0)
+            {
+                t->endOfFile = true;
+            }
+        }
+        if ((t->pending) && ((!next) || (t->pendingDts < next->pendingDts)))
+        {
+            next = &(*t);
+        }
+    }
+    if (!next)
+    {
+        return -1;
+    }
+
+    avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)next->currentBuffer->getMetadataPtr();
+    data->isCached = true;
+    data->isSilent = false;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    data->demuxOutputTimestamp = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+    data->auNtpTimestampLocal = data->demuxOutputTimestamp;
+
+    int ret = next->decoder->queueInputBuffer(next->currentBuffer);
+    if (ret != 0)
+    {
+        ULOGW("RecordDemuxer: failed to release the output buffer (%d)", ret);
+    }
+    else
+    {
+        record_demuxer_cached_frame_t cached;
+        cached.trackIndex = next - &mTracks[0];
+        cached.dts = next->pendingDts;
+        mStepFrames.push_back(cached);
+        next->currentBuffer->unref();
+        next->currentBuffer = NULL;
+        next->headerSize = 0;
+    }
+    next->pending = false;
+
+    return ret;
+}
+
+
+int RecordDemuxer::decodeNextStepFrame()
+{
+    int ret;
+
+    if (mStepFrames.empty())
+    {
+        /* No previous step: decode from the previous sync sample up to
+         * the next frame */
+        uint64_t end, start;
+        ret = findNextSampleTime(mCurrentTime, &end);
+        if (ret == 0)
+        {
+            ret = fillFrameCache(end + 1, 1, &start);
+        }
+        if (ret != 0)
+        {
+            return -1;
+        }
+        mStepFrames.swap(mCachedFrames);
+        if (mStepFrames.empty())
+        {
+            return -1;
+        }
+    }
+
+    /* The next steps only decode the next AU: the decoders keep their
+     * state as long as they are not drained, so enough AUs are queued
+     * after the output frame for it to leave the decoder (reordering and
+     * frame threading delays); the frames of all the tracks with the
+     * same timestamp are output */
+    uint64_t dts = mStepFrames.front().dts;
+    while ((!mStepFrames.empty()) && (mStepFrames.front().dts == dts))
+    {
+        record_demuxer_cached_frame_t cached = mStepFrames.front();
+        unsigned int delay = mTracks[cached.trackIndex].decoder->getOutputDelay();
+        while (true)
+        {
+            unsigned int count = 0;
+            std::vector<record_demuxer_cached_frame_t>::iterator f;
+            for (f = mStepFrames.begin() + 1; f != mStepFrames.end(); f++)
+            {
+                if (f->trackIndex == cached.trackIndex)
+                    count++;
+            }
+            if ((count >= delay) || (queueNextCachedSample() != 0))
+            {
+                break;
+            }
+        }
+        mStepFrames.erase(mStepFrames.begin());
+        ret = outputCachedFrame(&cached, PDRAW_PLAYBACK_SPEED_UNTHROTTLED);
+        if (ret != 0)
+        {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+
+int RecordDemuxer::queueEndOfStream(record_demuxer_track_t *track)
+{
+    Buffer *buffer = NULL;
+    int ret = track->decoder->getInputBuffer(&buffer, true);
+    if ((ret != 0) || (!buffer))
+    {
+        ULOGW("RecordDemuxer: failed to get an output buffer (%d)", ret);
+        return -1;
+    }
+
+    buffer->setSize(0);
+    buffer->setUserDataSize(0);
+    buffer->setMetadataSize(sizeof(avc_decoder_input_buffer_t));
+    avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)buffer->getMetadataPtr();
+    memset(data, 0, sizeof(avc_decoder_input_buffer_t));
+    data->isEndOfStream = true;
+
+    ret = track->decoder->queueInputBuffer(buffer);
+    if (ret != 0)
+    {
+        ULOGW("RecordDemuxer: failed to release the output buffer (%d)", ret);
+    }
+    buffer->unref();
+
+    return ret;
 }
 
 
 void* RecordDemuxer::runDemuxerThread(void *ptr)
 {
     RecordDemuxer *demuxer = (RecordDemuxer*)ptr;
-    struct timespec t1;
-    uint64_t curTime;
-    int32_t outputTimeError = 0;
+    bool frameCacheMode = false;
+    uint64_t reverseEnd = 0;
 
     while (!demuxer->mThreadShouldStop)
     {
-        if ((demuxer->mDecoder) && (demuxer->mRunning))
+        /* Wait until there is something to demux: a decoder is set and
+         * either a frame step is requested or the demuxer is running and
+         * either not at the end of file or seeking */
+        pthread_mutex_lock(&demuxer->mDemuxerMutex);
+        while ((!demuxer->mThreadShouldStop) &&
+               ((demuxer->mDecoderCount == 0) ||
+                ((demuxer->mPendingStep == 0) &&
+                 ((!demuxer->mRunning) || ((demuxer->mEndOfFile) && (demuxer->mPendingSeekTs < 0))))))
         {
-            uint8_t *spsBuffer = NULL, *ppsBuffer = NULL;
-            unsigned int spsSize = 0, ppsSize = 0;
-            struct mp4_track_sample sample;
+            pthread_cond_wait(&demuxer->mDemuxerCond, &demuxer->mDemuxerMutex);
+        }
+        int64_t seekTs = demuxer->mPendingSeekTs;
+        bool seekExact = demuxer->mPendingSeekExact;
+        float speed = demuxer->mSpeed;
+        int step = demuxer->mPendingStep;
+        demuxer->mPendingSeekTs = -1;
+        demuxer->mPendingStep = 0;
+        pthread_mutex_unlock(&demuxer->mDemuxerMutex);
+
+        if ((demuxer->mDecoderCount == 0) || (demuxer->mThreadShouldStop))
+        {
+            continue;
+        }
+
+        if ((step != 0) || ((speed < 0.f) && (demuxer->mRunning)))
+        {
+            /* Frame stepping and reverse playback: GOPs (or the part of a
+             * GOP that fits in the memory budget) are decoded into the
+             * decoder frame cache and the frames are output backward */
+            uint64_t start, end;
             int ret;
 
-            if (demuxer->mFirstFrame)
+            if (seekTs >= 0)
             {
-                ret = mp4_demux_get_track_avc_decoder_config(demuxer->mDemux, demuxer->mVideoTrackId,
-                                                              &spsBuffer, &spsSize, &ppsBuffer, &ppsSize);
-                if (ret != 0)
+                demuxer->mCurrentTime = (uint64_t)seekTs;
+                demuxer->mCachedFrames.clear();
+                demuxer->mStepFrames.clear();
+                frameCacheMode = false;
+                reverseEnd = (uint64_t)seekTs + 1;
+            }
+            else if (!frameCacheMode)
+            {
+                reverseEnd = demuxer->mCurrentTime;
+            }
+            if (!frameCacheMode)
+            {
+                demuxer->mLastFrameTimestamp = 0;
+                demuxer->mOutputTimeError = 0;
+                frameCacheMode = true;
+            }
+
+            if (step != 0)
+            {
+                demuxer->mCachedFrames.clear();
+                if (step > 0)
                 {
-                    ULOGE("RecordDemuxer: failed to get decoder configuration (%d)", ret);
+                    ret = demuxer->decodeNextStepFrame();
                 }
                 else
                 {
-                    ret = h264_reader_parse_nalu(demuxer->mH264Reader, 0, spsBuffer, spsSize);
-                    if (ret < 0)
-                    {
-                        ULOGW("RecordDemuxer: h264_reader_parse_nalu() failed (%d)", ret);
-                    }
-                    ret = h264_reader_parse_nalu(demuxer->mH264Reader, 0, ppsBuffer, ppsSize);
-                    if (ret < 0)
-                    {
-                        ULOGW("RecordDemuxer: h264_reader_parse_nalu() failed (%d)", ret);
-                    }
-                    ret = demuxer->mDecoder->configure(spsBuffer, (unsigned int)spsSize, ppsBuffer, (unsigned int)ppsSize);
-                    if (ret != 0)
-                    {
-                        ULOGE("RecordDemuxer: decoder configuration failed (%d)", ret);
-                    }
+                    end = demuxer->mCurrentTime;
+                    ret = demuxer->fillFrameCache(end, 1, &start);
                 }
+                if (ret != 0)
+                {
+                    ULOGI("RecordDemuxer: no frame to step to");
+                }
+                while (!demuxer->mCachedFrames.empty())
+                {
+                    demuxer->outputCachedFrame(PDRAW_PLAYBACK_SPEED_UNTHROTTLED);
+                }
+                reverseEnd = demuxer->mCurrentTime;
+                continue;
             }
 
-            if ((demuxer->mDecoder->isConfigured()) && (demuxer->mCurrentBuffer == NULL))
+            if (demuxer->mCachedFrames.empty())
             {
-                ret = demuxer->mDecoder->getInputBuffer(&demuxer->mCurrentBuffer, true);
+                ret = demuxer->fillFrameCache(reverseEnd, demuxer->getFrameCacheMaxCount(), &start);
                 if (ret != 0)
                 {
-                    ULOGW("RecordDemuxer: failed to get an output buffer (%d)", ret);
+                    /* Beginning of file: wait for a seek request */
+                    ULOGI("RecordDemuxer: beginning of file");
+                    pthread_mutex_lock(&demuxer->mDemuxerMutex);
+                    demuxer->mEndOfFile = true;
+                    pthread_mutex_unlock(&demuxer->mDemuxerMutex);
+                    continue;
                 }
+                reverseEnd = start;
             }
+            demuxer->outputCachedFrame(speed);
+            continue;
+        }
 
-            if (demuxer->mCurrentBuffer)
+        if (frameCacheMode)
+        {
+            /* Back to forward playback: resume after the current frame */
+            frameCacheMode = false;
+            demuxer->mCachedFrames.clear();
+            demuxer->mStepFrames.clear();
+            if (seekTs < 0)
             {
-                uint8_t *buf = (uint8_t*)demuxer->mCurrentBuffer->getPtr();
-                unsigned int bufSize = demuxer->mCurrentBuffer->getCapacity();
+                seekTs = (int64_t)demuxer->mCurrentTime + 1;
+                seekExact = true;
+            }
+        }
 
-                if (demuxer->mFirstFrame)
+        if ((demuxer->mDecoderCount > 0) && (demuxer->mRunning))
+        {
+            std::vector<record_demuxer_track_t>::iterator t;
+            record_demuxer_track_t *next = NULL;
+            bool endOfFile = true;
+            int ret;
+
+            if (seekTs >= 0)
+            {
+                /* Seek directly to the previous keyframe when the index
+                 * is available: its timestamp is the one of a sync sample,
+                 * no sync sample search is needed; all the tracks are
+                 * seeked together */
+                uint64_t keyframeTs;
+                if ((demuxer->mIndex) && (demuxer->mIndex->findKeyframe((uint64_t)seekTs, &keyframeTs) == 0))
                 {
-                    if ((spsBuffer) && (spsSize + 4 <= bufSize))
-                    {
-                        *((uint32_t*)buf) = htonl(0x00000001);
-                        memcpy(buf + 4, spsBuffer, spsSize);
-                        buf += (spsSize + 4);
-                        bufSize -= (spsSize + 4);
-                    }
-                    if ((ppsBuffer) && (ppsSize + 4 <= bufSize))
-                    {
-                        *((uint32_t*)buf) = htonl(0x00000001);
-                        memcpy(buf + 4, ppsBuffer, ppsSize);
-                        buf += (ppsSize + 4);
-                        bufSize -= (ppsSize + 4);
-                    }
-                    demuxer->mFirstFrame = false;
+                    ret = mp4_demux_seek(demuxer->mDemux, keyframeTs, 0);
                 }
-
-                pthread_mutex_lock(&demuxer->mDemuxerMutex);
-                int64_t seekTs = demuxer->mPendingSeekTs;
-                demuxer->mPendingSeekTs = -1;
-                pthread_mutex_unlock(&demuxer->mDemuxerMutex);
-
-                if (seekTs >= 0)
+                else
                 {
                     ret = mp4_demux_seek(demuxer->mDemux, (uint64_t)seekTs, 1);
-                    if (ret != 0)
-                    {
-                        ULOGW("RecordDemuxer: mp4_demux_seek() failed (%d)", ret);
-                    }
-                    else
-                    {
-                        demuxer->mLastFrameTimestamp = 0;
-                        outputTimeError = 0;
-                    }
                 }
-
-                ret = mp4_demux_get_track_next_sample(demuxer->mDemux, demuxer->mVideoTrackId,
-                                                      buf, bufSize, demuxer->mMetadataBuffer, demuxer->mMetadataBufferSize, &sample);
-                if ((ret == 0) && (sample.sample_size))
+                if (ret != 0)
                 {
-                    demuxer->mCurrentBuffer->setSize(sample.sample_size);
-                    demuxer->mCurrentBuffer->setUserDataSize(0);
-
-                    /* Fix the H.264 bitstream: replace NALU size by byte stream start codes */
-                    uint32_t offset = 0, naluSize, naluCount = 0;
-                    uint8_t *_buf = buf;
-                    uint8_t *seiNalu = NULL;
-                    int seiNaluSize = 0;
-                    while (offset < sample.sample_size)
-                    {
-                        naluSize = ntohl(*((uint32_t*)_buf));
-                        *((uint32_t*)_buf) = htonl(0x00000001);
-                        if (*(_buf + 4) == 0x06)
-                        {
-                            seiNalu = _buf + 4;
-                            seiNaluSize = naluSize;
-                        }
-                        _buf += 4 + naluSize;
-                        offset += 4 + naluSize;
-                        naluCount++;
-                    }
-
-                    if ((seiNalu) && (seiNaluSize))
+                    ULOGW("RecordDemuxer: mp4_demux_seek() failed (%d)", ret);
+                }
+                else
+                {
+                    pthread_mutex_lock(&demuxer->mDemuxerMutex);
+                    demuxer->mEndOfFile = false;
+                    pthread_mutex_unlock(&demuxer->mDemuxerMutex);
+                    demuxer->mLastFrameTimestamp = 0;
+                    demuxer->mOutputTimeError = 0;
+
+                    /* Pending samples are dropped (the buffers and their
+                     * parameter sets prefix are reused); exact seek: the
+                     * frames from the previous sync sample up to the
+                     * requested time are decoded (as references) but not
+                     * output */
+                    for (t = demuxer->mTracks.begin(); t != demuxer->mTracks.end(); t++)
                     {
-                        ret = h264_reader_parse_nalu(demuxer->mH264Reader, 0, seiNalu, seiNaluSize);
-                        if (ret < 0)
-                        {
-                            ULOGW("RecordDemuxer: h264_reader_parse_nalu() failed (%d)", ret);
-                        }
+                        t->pending = false;
+                        t->endOfFile = false;
+                        t->exactSeekTs = (seekExact) ? seekTs : -1;
+                        t->discontinuity = true;
                     }
+                }
+            }
 
-                    avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)demuxer->mCurrentBuffer->getMetadataPtr();
-                    demuxer->mCurrentBuffer->setMetadataSize(sizeof(avc_decoder_input_buffer_t));
-                    data->isComplete = true; //TODO?
-                    data->hasErrors = false; //TODO?
-                    data->isRef = true; //TODO?
-                    data->auNtpTimestamp = sample.sample_dts;
-                    data->auNtpTimestampRaw = sample.sample_dts;
-                    //TODO: auSyncType
-
-                    /* Metadata */
-                    data->hasMetadata = VideoFrameMetadata::decodeMetadata(demuxer->mMetadataBuffer, sample.metadata_size,
-                        FRAME_METADATA_SOURCE_RECORDING, demuxer->mMetadataMimeType, &data->metadata);
+            /* Read the next sample of each track and output the one with
+             * the smallest DTS so that the tracks stay interleaved */
+            for (t = demuxer->mTracks.begin(); t != demuxer->mTracks.end(); t++)
+            {
+                if (!t->decoder)
+                    continue;
+                if ((!t->pending) && (!t->endOfFile))
+                {
+                    demuxer->readSample(&(*t));
+                }
+                if (!t->endOfFile)
+                {
+                    endOfFile = false;
+                }
+                if ((t->pending) && ((!next) || (t->pendingDts < next->pendingDts)))
+                {
+                    next = &(*t);
+                }
+            }
 
-                    if ((demuxer->mLastFrameOutputTime) && (demuxer->mLastFrameTimestamp))
+            if (!next)
+            {
+                pthread_mutex_lock(&demuxer->mDemuxerMutex);
+                if (endOfFile)
+                {
+                    /* End of file on all tracks: the last pictures held by
+                     * the decoders are output, then wait for a seek request */
+                    if (!demuxer->mEndOfFile)
                     {
-                        clock_gettime(CLOCK_MONOTONIC, &t1);
-                        curTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
-                        int32_t sleepTime = (int32_t)((int64_t)(sample.sample_dts - demuxer->mLastFrameTimestamp) - (int64_t)(curTime - demuxer->mLastFrameOutputTime)) + outputTimeError;
-                        if (sleepTime >= 1000)
+                        pthread_mutex_unlock(&demuxer->mDemuxerMutex);
+                        for (t = demuxer->mTracks.begin(); t != demuxer->mTracks.end(); t++)
                         {
-                            usleep(sleepTime);
+                            if ((t->decoder) && (t->decoder->isEndOfStreamSupported()))
+                            {
+                                demuxer->queueEndOfStream(&(*t));
+                            }
                         }
+                        pthread_mutex_lock(&demuxer->mDemuxerMutex);
                     }
+                    demuxer->mEndOfFile = true;
+                }
+                else if (!demuxer->mThreadShouldStop)
+                {
+                    /* The decoder configuration failed, wait for the next event */
+                    pthread_cond_wait(&demuxer->mDemuxerCond, &demuxer->mDemuxerMutex);
+                }
+                pthread_mutex_unlock(&demuxer->mDemuxerMutex);
+                continue;
+            }
 
-                    clock_gettime(CLOCK_MONOTONIC, &t1);
-                    data->demuxOutputTimestamp = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
-                    data->auNtpTimestampLocal = data->demuxOutputTimestamp;
-                    outputTimeError = ((demuxer->mLastFrameOutputTime) && (demuxer->mLastFrameTimestamp)) ?
-                                        (int32_t)((int64_t)(sample.sample_dts - demuxer->mLastFrameTimestamp) - (int64_t)(data->demuxOutputTimestamp - demuxer->mLastFrameOutputTime)) : 0;
+            avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)next->currentBuffer->getMetadataPtr();
+            data->demuxOutputTimestamp = demuxer->waitOutputTime(next->pendingDts, data->isSilent, speed);
+            data->auNtpTimestampLocal = data->demuxOutputTimestamp;
 
-                    ret = demuxer->mDecoder->queueInputBuffer(demuxer->mCurrentBuffer);
-                    if (ret != 0)
-                    {
-                        ULOGW("RecordDemuxer: failed to release the output buffer (%d)", ret);
-                    }
-                    else
-                    {
-                        demuxer->mLastFrameOutputTime = data->demuxOutputTimestamp;
-                        demuxer->mLastFrameTimestamp = sample.sample_dts;
-                        demuxer->mCurrentTime = sample.sample_dts;
-                        demuxer->mCurrentBuffer->unref();
-                        demuxer->mCurrentBuffer = NULL;
-                    }
-                }
+            ret = next->decoder->queueInputBuffer(next->currentBuffer);
+            if (ret != 0)
+            {
+                ULOGW("RecordDemuxer: failed to release the output buffer (%d)", ret);
             }
             else
             {
-                usleep(5000); //TODO
+                /* Silent frames are not paced: the pacing restarts
+                 * from the first output frame */
+                if (!data->isSilent)
+                {
+                    demuxer->mLastFrameOutputTime = data->demuxOutputTimestamp;
+                    demuxer->mLastFrameTimestamp = next->pendingDts;
+                    demuxer->mCurrentTime = next->pendingDts;
+                }
+                next->currentBuffer->unref();
+                next->currentBuffer = NULL;
+                next->headerSize = 0;
             }
-        }
-        else
-        {
-            usleep(5000); //TODO
+            /* On failure the sample is dropped and the buffer reused */
+            next->pending = false;
         }
     }
 
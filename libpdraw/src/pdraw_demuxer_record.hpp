@@ -40,18 +40,53 @@
 #define _PDRAW_DEMUXER_RECORD_HPP_
 
 #include <pthread.h>
+#include <vector>
 
 #include <libmp4.h>
 #include <h264/h264.h>
 
 #include "pdraw_demuxer.hpp"
 #include "pdraw_avcdecoder.hpp"
+#include "pdraw_demuxer_record_index.hpp"
 
 
 namespace Pdraw
 {
 
 
+typedef struct
+{
+    unsigned int trackId;
+    char *metadataMimeType;
+    AvcDecoder *decoder;
+    Buffer *currentBuffer;
+    unsigned int headerSize;
+    bool firstFrame;
+    bool pending;
+    uint64_t pendingDts;
+    bool endOfFile;
+    int64_t exactSeekTs;
+    bool discontinuity;
+    unsigned int width;
+    unsigned int height;
+    unsigned int cropLeft;
+    unsigned int cropRight;
+    unsigned int cropTop;
+    unsigned int cropBottom;
+    unsigned int sarWidth;
+    unsigned int sarHeight;
+
+} record_demuxer_track_t;
+
+
+typedef struct
+{
+    unsigned int trackIndex;
+    uint64_t dts;
+
+} record_demuxer_cached_frame_t;
+
+
 class RecordDemuxer : public Demuxer
 {
 public:
@@ -87,59 +122,90 @@ public:
     int stop();
 
     int seekTo
-            (uint64_t timestamp);
+            (uint64_t timestamp, bool exact);
 
     int seekForward
-            (uint64_t delta);
+            (uint64_t delta, bool exact);
 
     int seekBack
-            (uint64_t delta);
+            (uint64_t delta, bool exact);
 
     uint64_t getDuration() { return mDuration; };
 
     uint64_t getCurrentTime() { return mCurrentTime; };
 
+    int setSpeed(float speed);
+
+    float getSpeed() { return mSpeed; };
+
+    int stepForward();
+
+    int stepBack();
+
+    int getKeyframeList(pdraw_keyframe_t *keyframes, unsigned int maxCount);
+
     Session *getSession() { return mSession; };
 
 private:
 
-    int fetchVideoDimensions();
+    int fetchVideoDimensions(record_demuxer_track_t *track);
 
     int fetchSessionMetadata();
 
     static void h264UserDataSeiCb(struct h264_ctx *ctx, const uint8_t *buf, size_t len,
                                   const struct h264_sei_user_data_unregistered *sei, void *userdata);
 
+    int readSample(record_demuxer_track_t *track);
+
+    uint64_t waitOutputTime(uint64_t timestamp, bool silent, float speed);
+
+    bool isFrameCacheSupported();
+
+    unsigned int getFrameCacheMaxCount();
+
+    int findNextSampleTime(uint64_t timestamp, uint64_t *nextTimestamp);
+
+    int fillFrameCache(uint64_t end, unsigned int maxCount, uint64_t *start);
+
+    int outputCachedFrame(float speed);
+
+    int outputCachedFrame(const record_demuxer_cached_frame_t *cached, float speed);
+
+    int queueNextCachedSample();
+
+    int decodeNextStepFrame();
+
+    int queueEndOfStream(record_demuxer_track_t *track);
+
     static void* runDemuxerThread(void *ptr);
 
     std::string mFileName;
-    AvcDecoder *mDecoder;
+    std::vector<record_demuxer_track_t> mTracks;
+    unsigned int mDecoderCount;
     pthread_t mDemuxerThread;
     bool mDemuxerThreadLaunched;
     pthread_mutex_t mDemuxerMutex;
+    pthread_cond_t mDemuxerCond;
     int mRunning;
     int mThreadShouldStop;
+    int mEndOfFile;
     struct mp4_demux *mDemux;
+    RecordIndex *mIndex;
     uint64_t mDuration;
     uint64_t mCurrentTime;
-    int mVideoTrackCount;
-    unsigned int mVideoTrackId;
-    char *mMetadataMimeType;
-    int mFirstFrame;
     unsigned int mMetadataBufferSize;
     uint8_t *mMetadataBuffer;
     uint64_t mLastFrameOutputTime;
     uint64_t mLastFrameTimestamp;
     int64_t mPendingSeekTs;
-    Buffer *mCurrentBuffer;
-    unsigned int mWidth;
-    unsigned int mHeight;
-    unsigned int mCropLeft;
-    unsigned int mCropRight;
-    unsigned int mCropTop;
-    unsigned int mCropBottom;
-    unsigned int mSarWidth;
-    unsigned int mSarHeight;
+    bool mPendingSeekExact;
+    float mSpeed;
+    float mPacingSpeed;
+    int32_t mOutputTimeError;
+    int mPendingStep;
+    std::vector<record_demuxer_cached_frame_t> mCachedFrames;
+    std::vector<record_demuxer_cached_frame_t> mStepFrames;
+    Buffer *mSeiBuffer;
     float mHfov;
     float mVfov;
     struct h264_reader *mH264Reader;
@@ -0,0 +1,504 @@
+/**
+ * @file pdraw_demuxer_record_index.cpp
+ * @brief Parrot Drones Awesome Video Viewer Library - recording keyframe index
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_demuxer_record_index.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <libmp4.h>
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+#define RECORD_INDEX_METADATA_BUFFER_SIZE (1024)
+#define RECORD_INDEX_SIDECAR_MAGIC (0x58494450) /* "PDIX" */
+#define RECORD_INDEX_SIDECAR_VERSION (1)
+
+
+namespace Pdraw
+{
+
+
+/* Sidecar file header; the file is a local cache, it is written in native
+ * byte order and is discarded if the recording or the format changes */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t metadataSize;
+    uint32_t videoTrackId;
+    uint64_t fileSize;
+    uint64_t fileMtime;
+    uint32_t frameCount;
+    uint32_t keyframeCount;
+
+} record_index_sidecar_header_t;
+
+
+RecordIndex::RecordIndex(const std::string &fileName, unsigned int videoTrackId,
+                         const char *metadataMimeType, bool persistent)
+{
+    mFileName = fileName;
+    mSidecarFileName = fileName + RECORD_INDEX_SIDECAR_EXTENSION;
+    mVideoTrackId = videoTrackId;
+    mMetadataMimeType = (metadataMimeType) ? metadataMimeType : "";
+    mPersistent = persistent;
+    mFileSize = 0;
+    mFileMtime = 0;
+    mScanThreadLaunched = false;
+    mThreadShouldStop = false;
+    mReady = false;
+
+    struct stat st;
+    if (stat(mFileName.c_str(), &st) == 0)
+    {
+        mFileSize = (uint64_t)st.st_size;
+        mFileMtime = (uint64_t)st.st_mtime;
+    }
+
+    int ret = pthread_mutex_init(&mMutex, NULL);
+    if (ret != 0)
+    {
+        ULOGE("RecordIndex: mutex creation failed (%d)", ret);
+    }
+}
+
+
+RecordIndex::~RecordIndex()
+{
+    mThreadShouldStop = true;
+
+    if (mScanThreadLaunched)
+    {
+        int thErr = pthread_join(mScanThread, NULL);
+        if (thErr != 0)
+            ULOGE("RecordIndex: pthread_join() failed (%d)", thErr);
+    }
+
+    pthread_mutex_destroy(&mMutex);
+}
+
+
+int RecordIndex::start()
+{
+    if (mScanThreadLaunched)
+    {
+        ULOGE("RecordIndex: index is already started");
+        return -1;
+    }
+
+    int thErr = pthread_create(&mScanThread, NULL, runScanThread, (void*)this);
+    if (thErr != 0)
+    {
+        ULOGE("RecordIndex: scan thread creation failed (%d)", thErr);
+        return -1;
+    }
+
+    mScanThreadLaunched = true;
+
+    return 0;
+}
+
+
+bool RecordIndex::isReady()
+{
+    pthread_mutex_lock(&mMutex);
+    bool ready = mReady;
+    pthread_mutex_unlock(&mMutex);
+
+    return ready;
+}
+
+
+int RecordIndex::findKeyframe(uint64_t timestamp, uint64_t *keyframeTimestamp)
+{
+    if (!keyframeTimestamp)
+    {
+        ULOGE("RecordIndex: invalid pointer");
+        return -1;
+    }
+    if ((!isReady()) || (mKeyframes.size() == 0))
+    {
+        return -1;
+    }
+
+    /* Binary search of the last keyframe at or before the timestamp;
+     * the index is not modified once ready */
+    unsigned int first = 0, count = mKeyframes.size();
+    while (count > 0)
+    {
+        unsigned int step = count / 2;
+        unsigned int i = first + step;
+        if (mFrames[mKeyframes[i].frameIndex].dts <= timestamp)
+        {
+            first = i + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    *keyframeTimestamp = mFrames[mKeyframes[(first > 0) ? first - 1 : 0].frameIndex].dts;
+
+    return 0;
+}
+
+
+int RecordIndex::getKeyframeList(pdraw_keyframe_t *keyframes, unsigned int maxCount)
+{
+    if (!isReady())
+    {
+        return -1;
+    }
+
+    unsigned int i;
+    for (i = 0; (keyframes) && (i < maxCount) && (i < mKeyframes.size()); i++)
+    {
+        keyframes[i].timestamp = mFrames[mKeyframes[i].frameIndex].dts;
+        keyframes[i].frameIndex = mKeyframes[i].frameIndex;
+        keyframes[i].hasMetadata = (mKeyframes[i].hasMetadata) ? 1 : 0;
+        memcpy(&keyframes[i].metadata, &mKeyframes[i].metadata, sizeof(video_frame_metadata_t));
+    }
+
+    return (int)mKeyframes.size();
+}
+
+
+int RecordIndex::getFrameCount()
+{
+    if (!isReady())
+    {
+        return -1;
+    }
+
+    return (int)mFrames.size();
+}
+
+
+int RecordIndex::scan()
+{
+    std::vector<record_index_frame_t> frames;
+    std::vector<record_index_keyframe_t> keyframes;
+    struct mp4_track_sample sample;
+    int ret = 0;
+
+    /* The index uses its own demuxer instance in order not to disturb the
+     * playback position */
+    struct mp4_demux *demux = mp4_demux_open(mFileName.c_str());
+    if (demux == NULL)
+    {
+        ULOGE("RecordIndex: mp4_demux_open() failed");
+        return -1;
+    }
+
+    unsigned int metadataBufferSize = RECORD_INDEX_METADATA_BUFFER_SIZE;
+    uint8_t *metadataBuffer = (uint8_t*)malloc(metadataBufferSize);
+    if (metadataBuffer == NULL)
+    {
+        ULOGE("RecordIndex: allocation failed");
+        ret = -1;
+    }
+
+    /* First pass: timestamps and sizes of all the samples; without
+     * buffers only the sample tables are used, no payload is read */
+    while ((ret == 0) && (!mThreadShouldStop))
+    {
+        memset(&sample, 0, sizeof(sample));
+        ret = mp4_demux_get_track_next_sample(demux, mVideoTrackId,
+                                              NULL, 0, NULL, 0, &sample);
+        if (ret != 0)
+        {
+            ULOGE("RecordIndex: mp4_demux_get_track_next_sample() failed (%d)", ret);
+            break;
+        }
+        if (sample.sample_size == 0)
+        {
+            /* End of file */
+            break;
+        }
+
+        record_index_frame_t frame;
+        frame.dts = sample.sample_dts;
+        frame.size = sample.sample_size;
+        frame.isSync = false;
+        frames.push_back(frame);
+    }
+
+    /* Second pass: the sync samples are taken from the file's sync sample
+     * table by sync seeks, from the last sample backwards; only their
+     * metadata is read */
+    unsigned int i = (frames.size() > 0) ? frames.size() - 1 : 0;
+    while ((ret == 0) && (!mThreadShouldStop) && (frames.size() > 0))
+    {
+        ret = mp4_demux_seek(demux, frames[i].dts, 1);
+        if (ret != 0)
+        {
+            ULOGE("RecordIndex: mp4_demux_seek() failed (%d)", ret);
+            break;
+        }
+        memset(&sample, 0, sizeof(sample));
+        ret = mp4_demux_get_track_next_sample(demux, mVideoTrackId, NULL, 0,
+                                              metadataBuffer, metadataBufferSize, &sample);
+        if ((ret == -ENOBUFS) && (sample.metadata_size > metadataBufferSize))
+        {
+            /* Oversized metadata: grow the buffer and retry */
+            uint8_t *b = (uint8_t*)realloc(metadataBuffer, sample.metadata_size);
+            if (b == NULL)
+            {
+                ULOGE("RecordIndex: allocation failed");
+                break;
+            }
+            metadataBuffer = b;
+            metadataBufferSize = sample.metadata_size;
+            ret = mp4_demux_seek(demux, frames[i].dts, 1);
+            if (ret == 0)
+            {
+                memset(&sample, 0, sizeof(sample));
+                ret = mp4_demux_get_track_next_sample(demux, mVideoTrackId, NULL, 0,
+                                                      metadataBuffer, metadataBufferSize, &sample);
+            }
+        }
+        if (ret != 0)
+        {
+            ULOGE("RecordIndex: mp4_demux_get_track_next_sample() failed (%d)", ret);
+            break;
+        }
+
+        while ((i > 0) && (frames[i].dts > sample.sample_dts))
+        {
+            i--;
+        }
+        if ((frames[i].dts != sample.sample_dts) || (frames[i].isSync))
+        {
+            /* No sync sample before the first indexed one */
+            break;
+        }
+        frames[i].isSync = true;
+
+        record_index_keyframe_t keyframe;
+        memset(&keyframe, 0, sizeof(keyframe));
+        keyframe.frameIndex = i;
+        keyframe.hasMetadata = VideoFrameMetadata::decodeMetadata(metadataBuffer, sample.metadata_size,
+            FRAME_METADATA_SOURCE_RECORDING, mMetadataMimeType.c_str(), &keyframe.metadata);
+        keyframes.push_back(keyframe);
+
+        if (i == 0)
+        {
+            break;
+        }
+        i--;
+    }
+    std::reverse(keyframes.begin(), keyframes.end());
+
+    free(metadataBuffer);
+    mp4_demux_close(demux);
+
+    /* An incomplete index is neither published nor saved: a seek past
+     * the failing sample would land on a wrong keyframe */
+    if ((ret != 0) || (mThreadShouldStop))
+    {
+        return -1;
+    }
+
+    ULOGI("RecordIndex: %zu frames, %zu keyframes", frames.size(), keyframes.size());
+
+    pthread_mutex_lock(&mMutex);
+    mFrames.swap(frames);
+    mKeyframes.swap(keyframes);
+    mReady = true;
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+int RecordIndex::load()
+{
+    record_index_sidecar_header_t header;
+    std::vector<record_index_frame_t> frames;
+    std::vector<record_index_keyframe_t> keyframes;
+    int ret = 0;
+
+    FILE *f = fopen(mSidecarFileName.c_str(), "rb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, f) != 1)
+    {
+        ret = -1;
+    }
+
+    if ((ret == 0) &&
+        ((header.magic != RECORD_INDEX_SIDECAR_MAGIC) ||
+         (header.version != RECORD_INDEX_SIDECAR_VERSION) ||
+         (header.metadataSize != sizeof(video_frame_metadata_t)) ||
+         (header.videoTrackId != mVideoTrackId) ||
+         (header.fileSize != mFileSize) ||
+         (header.fileMtime != mFileMtime) ||
+         (header.keyframeCount > header.frameCount)))
+    {
+        ULOGI("RecordIndex: outdated sidecar file '%s'", mSidecarFileName.c_str());
+        ret = -1;
+    }
+
+    if (ret == 0)
+    {
+        frames.resize(header.frameCount);
+        keyframes.resize(header.keyframeCount);
+        if (((header.frameCount) &&
+             (fread(&frames[0], sizeof(record_index_frame_t), header.frameCount, f) != header.frameCount)) ||
+            ((header.keyframeCount) &&
+             (fread(&keyframes[0], sizeof(record_index_keyframe_t), header.keyframeCount, f) != header.keyframeCount)))
+        {
+            ULOGE("RecordIndex: failed to read sidecar file '%s'", mSidecarFileName.c_str());
+            ret = -1;
+        }
+    }
+
+    fclose(f);
+
+    unsigned int i;
+    for (i = 0; (ret == 0) && (i < keyframes.size()); i++)
+    {
+        if (keyframes[i].frameIndex >= frames.size())
+        {
+            ULOGE("RecordIndex: invalid sidecar file '%s'", mSidecarFileName.c_str());
+            ret = -1;
+        }
+    }
+
+    if (ret == 0)
+    {
+        ULOGI("RecordIndex: loaded %zu frames, %zu keyframes from '%s'",
+              frames.size(), keyframes.size(), mSidecarFileName.c_str());
+
+        pthread_mutex_lock(&mMutex);
+        mFrames.swap(frames);
+        mKeyframes.swap(keyframes);
+        mReady = true;
+        pthread_mutex_unlock(&mMutex);
+    }
+
+    return ret;
+}
+
+
+int RecordIndex::save()
+{
+    record_index_sidecar_header_t header;
+    int ret = 0;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = RECORD_INDEX_SIDECAR_MAGIC;
+    header.version = RECORD_INDEX_SIDECAR_VERSION;
+    header.metadataSize = sizeof(video_frame_metadata_t);
+    header.videoTrackId = mVideoTrackId;
+    header.fileSize = mFileSize;
+    header.fileMtime = mFileMtime;
+    header.frameCount = mFrames.size();
+    header.keyframeCount = mKeyframes.size();
+
+    /* Write to a temporary file first so that an interrupted write never
+     * leaves a truncated index behind */
+    std::string tmpFileName = mSidecarFileName + ".tmp";
+    FILE *f = fopen(tmpFileName.c_str(), "wb");
+    if (f == NULL)
+    {
+        ULOGW("RecordIndex: failed to create sidecar file '%s'", tmpFileName.c_str());
+        return -1;
+    }
+
+    if ((fwrite(&header, sizeof(header), 1, f) != 1) ||
+        ((header.frameCount) &&
+         (fwrite(&mFrames[0], sizeof(record_index_frame_t), header.frameCount, f) != header.frameCount)) ||
+        ((header.keyframeCount) &&
+         (fwrite(&mKeyframes[0], sizeof(record_index_keyframe_t), header.keyframeCount, f) != header.keyframeCount)))
+    {
+        ULOGW("RecordIndex: failed to write sidecar file '%s'", tmpFileName.c_str());
+        ret = -1;
+    }
+
+    if (fclose(f) != 0)
+    {
+        ret = -1;
+    }
+
+    if ((ret == 0) && (rename(tmpFileName.c_str(), mSidecarFileName.c_str()) != 0))
+    {
+        ULOGW("RecordIndex: failed to rename sidecar file '%s'", tmpFileName.c_str());
+        ret = -1;
+    }
+
+    if (ret != 0)
+    {
+        remove(tmpFileName.c_str());
+    }
+
+    return ret;
+}
+
+
+void* RecordIndex::runScanThread(void *ptr)
+{
+    RecordIndex *index = (RecordIndex*)ptr;
+    int ret;
+
+    if ((index->mPersistent) && (index->load() == 0))
+    {
+        return NULL;
+    }
+
+    ret = index->scan();
+    if ((ret == 0) && (index->mPersistent))
+    {
+        index->save();
+    }
+
+    return NULL;
+}
+
+}
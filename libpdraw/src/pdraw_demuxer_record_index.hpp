@@ -0,0 +1,125 @@
+/**
+ * @file pdraw_demuxer_record_index.hpp
+ * @brief Parrot Drones Awesome Video Viewer Library - recording keyframe index
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_DEMUXER_RECORD_INDEX_HPP_
+#define _PDRAW_DEMUXER_RECORD_INDEX_HPP_
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <pdraw/pdraw_defs.h>
+
+#include "pdraw_metadata_videoframe.hpp"
+
+
+#define RECORD_INDEX_SIDECAR_EXTENSION ".pdrawidx"
+
+
+namespace Pdraw
+{
+
+
+typedef struct
+{
+    uint64_t dts;
+    uint32_t size;
+    uint32_t isSync;
+
+} record_index_frame_t;
+
+
+typedef struct
+{
+    uint32_t frameIndex;
+    uint32_t hasMetadata;
+    video_frame_metadata_t metadata;
+
+} record_index_keyframe_t;
+
+
+class RecordIndex
+{
+public:
+
+    RecordIndex(const std::string &fileName, unsigned int videoTrackId,
+                const char *metadataMimeType, bool persistent);
+
+    ~RecordIndex();
+
+    int start();
+
+    bool isReady();
+
+    int findKeyframe(uint64_t timestamp, uint64_t *keyframeTimestamp);
+
+    int getKeyframeList(pdraw_keyframe_t *keyframes, unsigned int maxCount);
+
+    int getFrameCount();
+
+private:
+
+    static void* runScanThread(void *ptr);
+
+    int scan();
+
+    int load();
+
+    int save();
+
+    std::string mFileName;
+    std::string mSidecarFileName;
+    unsigned int mVideoTrackId;
+    std::string mMetadataMimeType;
+    bool mPersistent;
+    uint64_t mFileSize;
+    uint64_t mFileMtime;
+    pthread_t mScanThread;
+    bool mScanThreadLaunched;
+    std::atomic<bool> mThreadShouldStop;
+    pthread_mutex_t mMutex;
+    bool mReady;
+    std::vector<record_index_frame_t> mFrames;
+    std::vector<record_index_keyframe_t> mKeyframes;
+};
+
+}
+
+#endif /* !_PDRAW_DEMUXER_RECORD_INDEX_HPP_ */
@@ -790,7 +790,8 @@ int StreamDemuxer::getElementaryStreamCount()
         return -1;
     }
 
-    //TODO: handle multiple streams
+    /* The ARStream2 receiver handles a single RTP video stream; multiple
+     * streams need one session (one receiver) per stream */
     return 1;
 }
 
@@ -988,7 +989,7 @@ int StreamDemuxer::stop()
 }
 
 
-int StreamDemuxer::seekTo(uint64_t timestamp)
+int StreamDemuxer::seekTo(uint64_t timestamp, bool exact)
 {
     if (!mConfigured)
     {
@@ -1000,7 +1001,7 @@ int StreamDemuxer::seekTo(uint64_t timestamp)
 }
 
 
-int StreamDemuxer::seekForward(uint64_t delta)
+int StreamDemuxer::seekForward(uint64_t delta, bool exact)
 {
     if (!mConfigured)
     {
@@ -1012,7 +1013,7 @@ int StreamDemuxer::seekForward(uint64_t delta)
 }
 
 
-int StreamDemuxer::seekBack(uint64_t delta)
+int StreamDemuxer::seekBack(uint64_t delta, bool exact)
 {
     if (!mConfigured)
     {
@@ -1270,11 +1271,29 @@ eARSTREAM2_ERROR StreamDemuxer::h264FilterAuReadyCallback(uint8_t *auBuffer, int
         avc_decoder_input_buffer_t *data = (avc_decoder_input_buffer_t*)buffer->getMetadataPtr();
         struct timespec t1;
 
+        if ((unsigned int)auSize >= buffer->getCapacity())
+        {
+            /* The access unit has filled the buffer and was probably
+             * truncated; grow the buffers for the next access units */
+            ULOGW("StreamDemuxer: access unit size reached the buffer capacity (%d bytes)", auSize);
+            err = demuxer->mDecoder->growInputBuffer(buffer, buffer->getCapacity() * 2);
+            if (err != 0)
+            {
+                ULOGW("StreamDemuxer: failed to grow the input buffer (%d)", err);
+            }
+        }
+
         buffer->setSize(auSize);
         buffer->setMetadataSize(sizeof(avc_decoder_input_buffer_t));
         data->isComplete = (auMetadata->isComplete) ? true : false;
         data->hasErrors = (auMetadata->hasErrors) ? true : false;
         data->isRef = (auMetadata->isRef) ? true : false;
+        data->isSilent = false;
+        data->isCached = false;
+        data->isCacheOutput = false;
+        data->isDiscontinuity = false;
+        data->isEndOfStream = false;
+        data->isRealTime = true;
         data->auNtpTimestamp = auTimestamps->auNtpTimestamp;
         data->auNtpTimestampRaw = auTimestamps->auNtpTimestampRaw;
         data->auNtpTimestampLocal = auTimestamps->auNtpTimestampLocal;
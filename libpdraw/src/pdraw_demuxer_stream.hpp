@@ -100,13 +100,13 @@ public:
     int stop();
 
     int seekTo
-            (uint64_t timestamp);
+            (uint64_t timestamp, bool exact);
 
     int seekForward
-            (uint64_t delta);
+            (uint64_t delta, bool exact);
 
     int seekBack
-            (uint64_t delta);
+            (uint64_t delta, bool exact);
 
     int startRecorder(const std::string &fileName);
 
@@ -122,6 +122,10 @@ public:
 
     uint64_t getCurrentTime();
 
+    int setSpeed(float speed) { return -1; };
+
+    float getSpeed() { return 1.f; };
+
     Session *getSession() { return mSession; };
 
 private:
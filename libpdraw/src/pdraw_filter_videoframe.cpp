@@ -37,10 +37,13 @@
  */
 
 #include "pdraw_filter_videoframe.hpp"
+#include "pdraw_convert.hpp"
+#include "pdraw_scale.hpp"
 
 #include <sys/time.h>
 #include <unistd.h>
 #include <time.h>
+#include <errno.h>
 
 #define ULOG_TAG libpdraw
 #include <ulog.h>
@@ -58,7 +61,20 @@ VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder) : Vid
 }
 
 
-VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw_video_frame_filter_callback_t cb, void *userPtr)
+VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                   unsigned int cbThreadCount, bool cbOrdered) : VideoFrameFilter(media, decoder, cb, userPtr, 0, PDRAW_FRAME_RING_OVERFLOW_DROP_OLDEST, cbThreadCount, cbOrdered)
+{
+}
+
+
+VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy) : VideoFrameFilter(media, decoder, NULL, NULL, ringSize, ringPolicy, 1, true)
+{
+}
+
+
+VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                   unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy,
+                                   unsigned int cbThreadCount, bool cbOrdered)
 {
     int ret = 0;
     mMedia = (Media*)media;
@@ -75,11 +91,47 @@ VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw
     mUserDataBuferSize[0] = 0;
     mUserDataBuferSize[1] = 0;
     mBufferIndex = 0;
+    mLastBuffer = NULL;
+    memset(&mLastFrame, 0, sizeof(mLastFrame));
     mColorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
     mWidth = 0;
     mHeight = 0;
     mFrameAvailable = false;
     mCondition = PTHREAD_COND_INITIALIZER;
+    mOutputFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+    mColorMatrix = PDRAW_COLOR_MATRIX_AUTO;
+    memset(&mCbBuffers, 0, sizeof(mCbBuffers));
+    mScaleWidth = 0;
+    mScaleHeight = 0;
+    memset(&mRoi, 0, sizeof(mRoi));
+    mScaleBuffer = NULL;
+    mScaleBufferSize = 0;
+    mProcessCount = 0;
+    mProcessTimeTotal = 0;
+    mProcessTimeMax = 0;
+    mCbThreadCount = (cbThreadCount) ? cbThreadCount : 1;
+    mCbOrdered = cbOrdered;
+    mCbCondition = PTHREAD_COND_INITIALIZER;
+    mCbNextSeq = 0;
+    mCbStartSeq = 0;
+    mCbQueueMaxDepth = 0;
+    mCbDropCount = 0;
+    mCbCount = 0;
+    mCbTimeTotal = 0;
+    mCbTimeMax = 0;
+    mFrameCount = 0;
+    mRingSize = ringSize;
+    mRingPolicy = ringPolicy;
+    mRingCondition = PTHREAD_COND_INITIALIZER;
+    mRingBuffer = NULL;
+    mRingRetiredBuffer = NULL;
+    mRingSlotSize = 0;
+    mRingInUseSlot = -1;
+    mRingColorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+    mRingWidth = 0;
+    mRingHeight = 0;
+    mRingMaxDepth = 0;
+    mRingOverflowCount = 0;
 
     if (!media)
     {
@@ -87,11 +139,26 @@ VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw
         ret = -1;
     }
 
+    if ((ret == 0) && (mRingSize > VIDEO_FRAME_FILTER_RING_MAX_SIZE))
+    {
+        ULOGE("VideoFrameFilter: invalid ring size (%d)", mRingSize);
+        ret = -1;
+    }
+
+    if ((ret == 0) && (mCbThreadCount > VIDEO_FRAME_FILTER_CB_MAX_THREADS))
+    {
+        ULOGE("VideoFrameFilter: invalid callback thread count (%d)", mCbThreadCount);
+        ret = -1;
+    }
+
     if (ret == 0)
     {
         if (decoder)
         {
-            mDecoderOutputBufferQueue = decoder->addOutputQueue();
+            /* A blocking ring stalls the decoder output through its queue */
+            buffer_queue_overflow_policy_t policy = ((mRingSize > 0) && (mRingPolicy == PDRAW_FRAME_RING_OVERFLOW_BLOCK)) ?
+                BUFFER_QUEUE_OVERFLOW_BLOCK : BUFFER_QUEUE_OVERFLOW_DROP_OLDEST;
+            mDecoderOutputBufferQueue = decoder->addOutputQueue(VIDEO_FRAME_FILTER_QUEUE_MAX_DEPTH, policy);
             if (mDecoderOutputBufferQueue == NULL)
             {
                 ULOGE("VideoFrameFilter: failed to add output queue to decoder");
@@ -117,6 +184,26 @@ VideoFrameFilter::VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw
         }
     }
 
+    if ((ret == 0) && (mCb) && (mCbThreadCount > 1))
+    {
+        unsigned int i;
+        video_frame_filter_cb_worker_t worker;
+        memset(&worker, 0, sizeof(worker));
+        worker.filter = this;
+        mCbWorkers.resize(mCbThreadCount, worker);
+        for (i = 0; i < mCbThreadCount; i++)
+        {
+            int err = pthread_create(&mCbWorkers[i].thread, NULL, runCallbackThread, (void*)&mCbWorkers[i]);
+            if (err != 0)
+            {
+                ULOGE("VideoFrameFilter: callback thread creation failed (%d)", err);
+                ret = -1;
+                break;
+            }
+            mCbWorkers[i].threadLaunched = true;
+        }
+    }
+
     if (ret == 0)
     {
         int ret = pthread_create(&mThread, NULL, runThread, (void*)this);
@@ -137,6 +224,10 @@ VideoFrameFilter::~VideoFrameFilter()
 {
     mThreadShouldStop = true;
     if (mDecoderOutputBufferQueue) mDecoderOutputBufferQueue->signal();
+    pthread_mutex_lock(&mMutex);
+    pthread_cond_broadcast(&mRingCondition);
+    pthread_cond_broadcast(&mCbCondition);
+    pthread_mutex_unlock(&mMutex);
 
     if (mThreadLaunched)
     {
@@ -147,6 +238,22 @@ VideoFrameFilter::~VideoFrameFilter()
         }
     }
 
+    std::vector<video_frame_filter_cb_worker_t>::iterator w;
+    for (w = mCbWorkers.begin(); w != mCbWorkers.end(); w++)
+    {
+        if (w->threadLaunched)
+        {
+            int thErr = pthread_join(w->thread, NULL);
+            if (thErr != 0)
+            {
+                ULOGE("VideoFrameFilter: pthread_join() failed (%d)", thErr);
+            }
+        }
+        free(w->buffers.convertBuffer);
+        free(w->buffers.scaleBuffer);
+    }
+    mCbWorkers.clear();
+
     /*
      * this won't be sufficiant if another thread get last frame with
      * wait condition ; let's assume the client won't stop while
@@ -155,6 +262,38 @@ VideoFrameFilter::~VideoFrameFilter()
     pthread_mutex_lock(&mMutex);
     mFrameAvailable = false;
     pthread_cond_broadcast(&mCondition);
+    if (mDecoder)
+    {
+        /* Frames still borrowed are not valid anymore */
+        if (mBorrowedFrames.size() > 0)
+        {
+            ULOGW("VideoFrameFilter: %zu borrowed frame(s) not released", mBorrowedFrames.size());
+        }
+        std::vector<video_frame_filter_borrowed_frame_t>::iterator f = mBorrowedFrames.begin();
+        while (f != mBorrowedFrames.end())
+        {
+            mDecoder->releaseOutputBuffer(f->buffer);
+            f++;
+        }
+        mBorrowedFrames.clear();
+        if (mLastBuffer)
+        {
+            mDecoder->releaseOutputBuffer(mLastBuffer);
+            mLastBuffer = NULL;
+        }
+    }
+    if (mRingSize > 0)
+    {
+        ULOGI("VideoFrameFilter: ring frames=%d overflows=%d maxDepth=%d/%d",
+              mFrameCount, mRingOverflowCount, mRingMaxDepth, mRingSize);
+    }
+    while ((mDecoder) && (mCbJobs.size() > 0))
+    {
+        mDecoder->releaseOutputBuffer(mCbJobs.front().buffer);
+        mCbJobs.pop_front();
+    }
+    mRingInUseSlot = -1;
+    freeRing();
     pthread_mutex_unlock(&mMutex);
 
     if (mDecoder)
@@ -173,6 +312,9 @@ VideoFrameFilter::~VideoFrameFilter()
     free(mBuffer[1]);
     free(mUserData[0]);
     free(mUserData[1]);
+    free(mCbBuffers.convertBuffer);
+    free(mCbBuffers.scaleBuffer);
+    free(mScaleBuffer);
 
     pthread_mutex_destroy(&mMutex);
 }
@@ -190,6 +332,29 @@ static void getTimeWithUsDelay(struct timespec* ts, long waitUs)
 }
 
 
+int VideoFrameFilter::waitFrame(long waitUs)
+{
+    /* Called with the mutex held */
+    if (waitUs && !mFrameAvailable) {
+        if (waitUs == -1) {
+            pthread_cond_wait(&mCondition, &mMutex);
+        } else {
+            struct timespec ts;
+            getTimeWithUsDelay(&ts, waitUs);
+            pthread_cond_timedwait(&mCondition, &mMutex, &ts);
+        }
+    }
+
+    if ((!mFrameAvailable) || (!mLastBuffer))
+    {
+        ULOGI("VideoFrameFilter: no frame available");
+        return -2;
+    }
+
+    return 0;
+}
+
+
 int VideoFrameFilter::getLastFrame(pdraw_video_frame_t *frame, long waitUs)
 {
     if (!frame)
@@ -202,36 +367,777 @@ int VideoFrameFilter::getLastFrame(pdraw_video_frame_t *frame, long waitUs)
         ULOGE("VideoFrameFilter: unsupported in callback mode");
         return -1;
     }
+    if (mRingSize > 0)
+    {
+        ULOGE("VideoFrameFilter: unsupported in ring mode");
+        return -1;
+    }
+
+    if (isFrameProcessed())
+    {
+        /* Converted or scaled frames cannot be borrowed */
+        return getDetachedFrame(frame, waitUs);
+    }
 
     pthread_mutex_lock(&mMutex);
 
-    if (waitUs && !mFrameAvailable) {
-        if (waitUs == -1) {
-            pthread_cond_wait(&mCondition, &mMutex);
-        } else {
+    int ret = waitFrame(waitUs);
+    if (ret != 0)
+    {
+        pthread_mutex_unlock(&mMutex);
+        return ret;
+    }
+
+    /* Release the oldest frame if the caller does not release them */
+    if (mBorrowedFrames.size() >= VIDEO_FRAME_FILTER_MAX_BORROWED_FRAMES)
+    {
+        mDecoder->releaseOutputBuffer(mBorrowedFrames.front().buffer);
+        mBorrowedFrames.erase(mBorrowedFrames.begin());
+    }
+
+    video_frame_filter_borrowed_frame_t borrowed;
+    borrowed.buffer = mLastBuffer;
+    borrowed.plane = mLastFrame.plane[0];
+    borrowed.auNtpTimestamp = mLastFrame.auNtpTimestamp;
+    borrowed.auNtpTimestampLocal = mLastFrame.auNtpTimestampLocal;
+    mLastBuffer->ref();
+    mBorrowedFrames.push_back(borrowed);
+    memcpy(frame, &mLastFrame, sizeof(*frame));
+
+    mFrameAvailable = false;
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+int VideoFrameFilter::releaseFrame(const pdraw_video_frame_t *frame)
+{
+    if (!frame)
+    {
+        ULOGE("VideoFrameFilter: invalid frame structure pointer");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+
+    if ((mRingInUseSlot >= 0) && (mRingSlots[mRingInUseSlot].plane[0] == frame->plane[0]) &&
+        (mRingSlots[mRingInUseSlot].auNtpTimestamp == frame->auNtpTimestamp) &&
+        (mRingSlots[mRingInUseSlot].auNtpTimestampLocal == frame->auNtpTimestampLocal))
+    {
+        releaseRingSlot();
+        pthread_mutex_unlock(&mMutex);
+        return 0;
+    }
+
+    std::vector<video_frame_filter_borrowed_frame_t>::iterator f = mBorrowedFrames.begin();
+    while (f != mBorrowedFrames.end())
+    {
+        if ((f->plane == frame->plane[0]) && (f->auNtpTimestamp == frame->auNtpTimestamp) &&
+            (f->auNtpTimestampLocal == frame->auNtpTimestampLocal))
+        {
+            mDecoder->releaseOutputBuffer(f->buffer);
+            mBorrowedFrames.erase(f);
+            pthread_mutex_unlock(&mMutex);
+            return 0;
+        }
+        f++;
+    }
+
+    if ((frame->plane[0] != NULL) && ((frame->plane[0] == mBuffer[0]) || (frame->plane[0] == mBuffer[1])))
+    {
+        /* Detached (converted) frame: nothing to release */
+        pthread_mutex_unlock(&mMutex);
+        return 0;
+    }
+
+    pthread_mutex_unlock(&mMutex);
+
+    ULOGW("VideoFrameFilter: frame is not borrowed (already released?)");
+    return -1;
+}
+
+
+int VideoFrameFilter::getDetachedFrame(pdraw_video_frame_t *frame, long waitUs)
+{
+    if (!frame)
+    {
+        ULOGE("VideoFrameFilter: invalid frame structure pointer");
+        return -1;
+    }
+    if (mCb)
+    {
+        ULOGE("VideoFrameFilter: unsupported in callback mode");
+        return -1;
+    }
+    if (mRingSize > 0)
+    {
+        ULOGE("VideoFrameFilter: unsupported in ring mode");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+
+    int ret = waitFrame(waitUs);
+    if (ret == 0)
+    {
+        ret = copyFrame(&mLastFrame, mBufferIndex ^ 1);
+    }
+    if (ret != 0)
+    {
+        pthread_mutex_unlock(&mMutex);
+        return ret;
+    }
+
+    mBufferIndex ^= 1;
+    memcpy(frame, &mBufferData[mBufferIndex], sizeof(*frame));
+
+    mFrameAvailable = false;
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+int VideoFrameFilter::copyFrame(const pdraw_video_frame_t *frame, unsigned int index)
+{
+    /* Called with the mutex held */
+    if ((frame->width != mWidth) || (frame->height != mHeight)
+            || (frame->colorFormat != mColorFormat) || (mBuffer[0] == NULL))
+    {
+        unsigned int size = getOutputFrameSize(frame);
+        free(mBuffer[0]);
+        free(mBuffer[1]);
+        mBuffer[0] = (uint8_t*)malloc(size);
+        mBuffer[1] = (uint8_t*)malloc(size);
+        if ((mBuffer[0] == NULL) || (mBuffer[1] == NULL))
+        {
+            ULOGE("VideoFrameFilter: frame allocation failed (size %d)", size);
+            free(mBuffer[0]);
+            free(mBuffer[1]);
+            mBuffer[0] = NULL;
+            mBuffer[1] = NULL;
+            mWidth = 0;
+            mHeight = 0;
+            mColorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+            return -1;
+        }
+        mWidth = frame->width;
+        mHeight = frame->height;
+        mColorFormat = frame->colorFormat;
+    }
+
+    pdraw_video_frame_t *dst = &mBufferData[index];
+    int ret = convertFrame(frame, dst, mBuffer[index]);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    /* user data */
+    dst->userData = NULL;
+    dst->userDataSize = 0;
+    if ((frame->userData) && (frame->userDataSize))
+    {
+        if (frame->userDataSize > mUserDataBuferSize[index])
+        {
+            unsigned int size = (frame->userDataSize + VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1) & (~(VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1));
+            uint8_t *tmp = (uint8_t *)realloc(mUserData[index], size);
+            if (tmp)
+            {
+                mUserData[index] = tmp;
+                mUserDataBuferSize[index] = size;
+            }
+        }
+        if (frame->userDataSize <= mUserDataBuferSize[index])
+        {
+            memcpy(mUserData[index], frame->userData, frame->userDataSize);
+            dst->userData = mUserData[index];
+            dst->userDataSize = frame->userDataSize;
+        }
+    }
+
+    return 0;
+}
+
+
+void VideoFrameFilter::getProcessParams(video_frame_filter_process_params_t *params)
+{
+    /* Called with the mutex held */
+    params->outputFormat = mOutputFormat;
+    params->colorMatrix = mColorMatrix;
+    params->scaleWidth = mScaleWidth;
+    params->scaleHeight = mScaleHeight;
+    params->roi = mRoi;
+}
+
+
+unsigned int VideoFrameFilter::getOutputFrameSize(const pdraw_video_frame_t *frame)
+{
+    video_frame_filter_process_params_t params;
+    getProcessParams(&params);
+    return getOutputFrameSize(frame, &params);
+}
+
+
+unsigned int VideoFrameFilter::getOutputFrameSize(const pdraw_video_frame_t *frame,
+                                                  const video_frame_filter_process_params_t *params)
+{
+    pdraw_color_format_t format = (params->outputFormat != PDRAW_COLOR_FORMAT_UNKNOWN) ? params->outputFormat : frame->colorFormat;
+    unsigned int width = frame->width, height = frame->height;
+    if ((params->scaleWidth) || (params->scaleHeight) || (params->roi.width))
+    {
+        pdraw_scaleGetDimensions(frame, &params->roi, params->scaleWidth, params->scaleHeight, &width, &height);
+    }
+    return pdraw_convertGetFrameSize(format, width, height);
+}
+
+
+int VideoFrameFilter::convertFrame(const pdraw_video_frame_t *frame, pdraw_video_frame_t *dst, uint8_t *buf)
+{
+    /* Called with the mutex held */
+    video_frame_filter_process_params_t params;
+    struct timespec t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    getProcessParams(&params);
+    int ret = processFrame(frame, dst, buf, &params, &mScaleBuffer, &mScaleBufferSize);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    addProcessTime((unsigned int)(((uint64_t)t2.tv_sec * 1000000 + (uint64_t)t2.tv_nsec / 1000)
+        - ((uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000)));
+
+    return 0;
+}
+
+
+int VideoFrameFilter::processFrame(const pdraw_video_frame_t *frame, pdraw_video_frame_t *dst, uint8_t *buf,
+                                   const video_frame_filter_process_params_t *params,
+                                   uint8_t **scaleBuffer, unsigned int *scaleBufferSize)
+{
+    /* The scale buffer belongs to the caller */
+    int ret;
+
+    if ((params->scaleWidth) || (params->scaleHeight) || (params->roi.width))
+    {
+        if (params->outputFormat == PDRAW_COLOR_FORMAT_UNKNOWN)
+        {
+            ret = pdraw_scaleFrame(frame, &params->roi, params->scaleWidth, params->scaleHeight, dst, buf);
+        }
+        else
+        {
+            /* Scale first, only the scaled frame is converted */
+            pdraw_video_frame_t scaled;
+            unsigned int width, height;
+            pdraw_scaleGetDimensions(frame, &params->roi, params->scaleWidth, params->scaleHeight, &width, &height);
+            unsigned int size = pdraw_convertGetFrameSize(frame->colorFormat, width, height);
+            if (size > *scaleBufferSize)
+            {
+                free(*scaleBuffer);
+                *scaleBuffer = (uint8_t*)malloc(size);
+                *scaleBufferSize = (*scaleBuffer) ? size : 0;
+            }
+            ret = (*scaleBuffer) ? pdraw_scaleFrame(frame, &params->roi, params->scaleWidth, params->scaleHeight, &scaled, *scaleBuffer) : -1;
+            if (ret == 0)
+            {
+                ret = pdraw_convertFrame(&scaled, dst, buf, params->outputFormat, params->colorMatrix);
+            }
+        }
+    }
+    else
+    {
+        ret = pdraw_convertFrame(frame, dst, buf, params->outputFormat, params->colorMatrix);
+    }
+    if (ret != 0)
+    {
+        ULOGE("VideoFrameFilter: frame conversion failed");
+    }
+
+    return ret;
+}
+
+
+void VideoFrameFilter::addProcessTime(unsigned int processTime)
+{
+    /* Called with the mutex held */
+    mProcessCount++;
+    mProcessTimeTotal += processTime;
+    if (processTime > mProcessTimeMax)
+    {
+        mProcessTimeMax = processTime;
+    }
+}
+
+
+int VideoFrameFilter::setOutputFormat(pdraw_color_format_t format, pdraw_color_matrix_t matrix)
+{
+    if ((format != PDRAW_COLOR_FORMAT_UNKNOWN) && (pdraw_convertGetFrameSize(format, 2, 2) == 0))
+    {
+        ULOGE("VideoFrameFilter: unsupported output format (%d)", format);
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    if ((format != mOutputFormat) || (matrix != mColorMatrix))
+    {
+        mOutputFormat = format;
+        mColorMatrix = matrix;
+        /* Force the reallocation of the detached frames and ring */
+        mWidth = 0;
+        mHeight = 0;
+        mRingWidth = 0;
+        mRingHeight = 0;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+int VideoFrameFilter::allocRing(const pdraw_video_frame_t *frame)
+{
+    /* Called with the mutex held; queued frames are dropped */
+    if (mRingQueue.size() > 0)
+    {
+        ULOGI("VideoFrameFilter: format change, %zu ring frame(s) dropped", mRingQueue.size());
+        mRingOverflowCount += mRingQueue.size();
+    }
+    freeRing();
+
+    unsigned int frameSize = (getOutputFrameSize(frame) + 63) & ~63;
+    unsigned int slotCount = mRingSize + 1;
+    mRingSlotSize = frameSize + VIDEO_FRAME_FILTER_RING_USER_DATA_SIZE;
+    mRingBuffer = (uint8_t*)malloc(mRingSlotSize * slotCount);
+    if (mRingBuffer == NULL)
+    {
+        ULOGE("VideoFrameFilter: ring allocation failed (size %d)", mRingSlotSize * slotCount);
+        mRingSlotSize = 0;
+        return -1;
+    }
+
+    mRingSlots.resize(slotCount);
+    unsigned int i;
+    for (i = 0; i < slotCount; i++)
+    {
+        /* The slot held by the consumer is freed on release */
+        if ((int)i != mRingInUseSlot)
+        {
+            memset(&mRingSlots[i], 0, sizeof(mRingSlots[i]));
+            mRingFreeSlots.push_back(i);
+        }
+    }
+    mRingWidth = frame->width;
+    mRingHeight = frame->height;
+    mRingColorFormat = frame->colorFormat;
+
+    ULOGI("VideoFrameFilter: ring allocated (%dx%d, %d slots, %d bytes)",
+          mRingWidth, mRingHeight, slotCount, mRingSlotSize * slotCount);
+
+    return 0;
+}
+
+
+void VideoFrameFilter::freeRing()
+{
+    /* Called with the mutex held; the buffer is kept until the frame
+     * held by the consumer is released */
+    if ((mRingInUseSlot >= 0) && (mRingRetiredBuffer == NULL))
+    {
+        mRingRetiredBuffer = mRingBuffer;
+    }
+    else if (mRingInUseSlot >= 0)
+    {
+        /* The slot held by the consumer is already in the retired buffer */
+        free(mRingBuffer);
+    }
+    else
+    {
+        free(mRingRetiredBuffer);
+        mRingRetiredBuffer = NULL;
+        free(mRingBuffer);
+    }
+    mRingBuffer = NULL;
+    mRingSlotSize = 0;
+    mRingFreeSlots.clear();
+    mRingQueue.clear();
+    mRingWidth = 0;
+    mRingHeight = 0;
+    mRingColorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+}
+
+
+int VideoFrameFilter::pushRingFrame(const pdraw_video_frame_t *frame)
+{
+    pthread_mutex_lock(&mMutex);
+
+    if ((frame->width != mRingWidth) || (frame->height != mRingHeight)
+            || (frame->colorFormat != mRingColorFormat) || (mRingBuffer == NULL))
+    {
+        int ret = allocRing(frame);
+        if (ret != 0)
+        {
+            pthread_mutex_unlock(&mMutex);
+            return ret;
+        }
+    }
+
+    while ((mRingFreeSlots.size() == 0) && (mRingPolicy == PDRAW_FRAME_RING_OVERFLOW_BLOCK)
+            && (!mThreadShouldStop))
+    {
+        pthread_cond_wait(&mRingCondition, &mMutex);
+    }
+    if (mThreadShouldStop)
+    {
+        pthread_mutex_unlock(&mMutex);
+        return -1;
+    }
+
+    if (mRingFreeSlots.size() == 0)
+    {
+        /* Overwrite the oldest frame */
+        mRingFreeSlots.push_back(mRingQueue.front());
+        mRingQueue.pop_front();
+        mRingOverflowCount++;
+    }
+
+    unsigned int slot = mRingFreeSlots.back();
+    mRingFreeSlots.pop_back();
+    uint8_t *buf = mRingBuffer + slot * mRingSlotSize;
+    pdraw_video_frame_t *dst = &mRingSlots[slot];
+    int ret = convertFrame(frame, dst, buf);
+    if (ret != 0)
+    {
+        mRingFreeSlots.push_back(slot);
+        pthread_mutex_unlock(&mMutex);
+        return ret;
+    }
+
+    /* user data */
+    dst->userData = NULL;
+    dst->userDataSize = 0;
+    if ((frame->userData) && (frame->userDataSize))
+    {
+        if (frame->userDataSize <= VIDEO_FRAME_FILTER_RING_USER_DATA_SIZE)
+        {
+            dst->userData = buf + mRingSlotSize - VIDEO_FRAME_FILTER_RING_USER_DATA_SIZE;
+            dst->userDataSize = frame->userDataSize;
+            memcpy(dst->userData, frame->userData, frame->userDataSize);
+        }
+        else
+        {
+            ULOGW("VideoFrameFilter: user data too large for the ring (%d)", frame->userDataSize);
+        }
+    }
+
+    mRingQueue.push_back(slot);
+    if (mRingQueue.size() > mRingMaxDepth)
+    {
+        mRingMaxDepth = mRingQueue.size();
+    }
+
+    pthread_mutex_unlock(&mMutex);
+    pthread_cond_signal(&mCondition);
+
+    return 0;
+}
+
+
+void VideoFrameFilter::releaseRingSlot()
+{
+    /* Called with the mutex held */
+    if (mRingInUseSlot < 0)
+    {
+        return;
+    }
+
+    if (mRingRetiredBuffer)
+    {
+        /* The slot belongs to the previous stream format */
+        free(mRingRetiredBuffer);
+        mRingRetiredBuffer = NULL;
+        if (mRingBuffer)
+        {
+            mRingFreeSlots.push_back(mRingInUseSlot);
+        }
+    }
+    else
+    {
+        mRingFreeSlots.push_back(mRingInUseSlot);
+    }
+    mRingInUseSlot = -1;
+    pthread_cond_signal(&mRingCondition);
+}
+
+
+int VideoFrameFilter::getNextFrame(pdraw_video_frame_t *frame, long waitUs)
+{
+    if (!frame)
+    {
+        ULOGE("VideoFrameFilter: invalid frame structure pointer");
+        return -1;
+    }
+    if (mRingSize == 0)
+    {
+        ULOGE("VideoFrameFilter: unsupported outside of ring mode");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+
+    /* The previous frame is released */
+    releaseRingSlot();
+
+    if ((waitUs) && (mRingQueue.size() == 0))
+    {
+        if (waitUs == -1)
+        {
+            while ((mRingQueue.size() == 0) && (!mThreadShouldStop))
+            {
+                pthread_cond_wait(&mCondition, &mMutex);
+            }
+        }
+        else
+        {
             struct timespec ts;
             getTimeWithUsDelay(&ts, waitUs);
-            pthread_cond_timedwait(&mCondition, &mMutex, &ts);
+            int ret = 0;
+            while ((mRingQueue.size() == 0) && (!mThreadShouldStop) && (ret != ETIMEDOUT))
+            {
+                ret = pthread_cond_timedwait(&mCondition, &mMutex, &ts);
+            }
         }
     }
 
-    if (!mFrameAvailable)
+    if (mRingQueue.size() == 0)
     {
         pthread_mutex_unlock(&mMutex);
         ULOGI("VideoFrameFilter: no frame available");
         return -2;
     }
 
-    mBufferIndex ^= 1;
-    memcpy(frame, &mBufferData[mBufferIndex], sizeof(*frame));
+    mRingInUseSlot = mRingQueue.front();
+    mRingQueue.pop_front();
+    memcpy(frame, &mRingSlots[mRingInUseSlot], sizeof(*frame));
 
-    mFrameAvailable = false;
     pthread_mutex_unlock(&mMutex);
 
     return 0;
 }
 
 
+int VideoFrameFilter::setScaling(unsigned int width, unsigned int height, const pdraw_rect_t *roi)
+{
+    if ((roi) && ((roi->width == 0) != (roi->height == 0)))
+    {
+        ULOGE("VideoFrameFilter: invalid region of interest");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    mScaleWidth = width;
+    mScaleHeight = height;
+    if (roi)
+    {
+        memcpy(&mRoi, roi, sizeof(mRoi));
+    }
+    else
+    {
+        memset(&mRoi, 0, sizeof(mRoi));
+    }
+    /* Force the reallocation of the detached frames and ring */
+    mWidth = 0;
+    mHeight = 0;
+    mRingWidth = 0;
+    mRingHeight = 0;
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+int VideoFrameFilter::getStats(pdraw_video_frame_producer_stats_t *stats)
+{
+    if (!stats)
+    {
+        ULOGE("VideoFrameFilter: invalid stats structure pointer");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    stats->frameCount = mFrameCount;
+    stats->ringSize = mRingSize;
+    stats->ringDepth = mRingQueue.size();
+    stats->ringMaxDepth = mRingMaxDepth;
+    stats->ringOverflowCount = mRingOverflowCount;
+    stats->queueDropCount = (mDecoderOutputBufferQueue) ? mDecoderOutputBufferQueue->getDropCount() : 0;
+    stats->processCount = mProcessCount;
+    stats->processTimeAvgUs = (mProcessCount) ? (unsigned int)(mProcessTimeTotal / mProcessCount) : 0;
+    stats->processTimeMaxUs = mProcessTimeMax;
+    stats->callbackThreadCount = (mCb) ? mCbThreadCount : 0;
+    stats->callbackCount = mCbCount;
+    stats->callbackQueueDepth = mCbJobs.size();
+    stats->callbackQueueMaxDepth = mCbQueueMaxDepth;
+    stats->callbackDropCount = mCbDropCount;
+    stats->callbackTimeAvgUs = (mCbCount) ? (unsigned int)(mCbTimeTotal / mCbCount) : 0;
+    stats->callbackTimeMaxUs = mCbTimeMax;
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+int VideoFrameFilter::convertCallbackFrame(const pdraw_video_frame_t *frame, pdraw_video_frame_t *dst,
+                                           video_frame_filter_cb_buffers_t *buffers)
+{
+    /* The buffers belong to the calling thread, the frame is processed
+     * without the mutex so that the workers run concurrently; the user
+     * data are not copied */
+    video_frame_filter_process_params_t params;
+    struct timespec t1, t2;
+
+    pthread_mutex_lock(&mMutex);
+    getProcessParams(&params);
+    pthread_mutex_unlock(&mMutex);
+
+    unsigned int size = getOutputFrameSize(frame, &params);
+    if (size > buffers->convertBufferSize)
+    {
+        free(buffers->convertBuffer);
+        buffers->convertBuffer = (uint8_t*)malloc(size);
+        if (buffers->convertBuffer == NULL)
+        {
+            ULOGE("VideoFrameFilter: frame allocation failed (size %d)", size);
+            buffers->convertBufferSize = 0;
+            return -1;
+        }
+        buffers->convertBufferSize = size;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    int ret = processFrame(frame, dst, buffers->convertBuffer, &params,
+                           &buffers->scaleBuffer, &buffers->scaleBufferSize);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    pthread_mutex_lock(&mMutex);
+    addProcessTime((unsigned int)(((uint64_t)t2.tv_sec * 1000000 + (uint64_t)t2.tv_nsec / 1000)
+        - ((uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000)));
+    pthread_mutex_unlock(&mMutex);
+
+    return 0;
+}
+
+
+void VideoFrameFilter::deliverCallbackFrame(const pdraw_video_frame_t *frame, video_frame_filter_cb_buffers_t *buffers)
+{
+    pdraw_video_frame_t converted;
+    struct timespec t1, t2;
+
+    if (isFrameProcessed())
+    {
+        int ret = convertCallbackFrame(frame, &converted, buffers);
+        if (ret != 0)
+        {
+            return;
+        }
+        frame = &converted;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    mCb(this, frame, mUserPtr);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    unsigned int cbTime = (unsigned int)(((uint64_t)t2.tv_sec * 1000000 + (uint64_t)t2.tv_nsec / 1000)
+        - ((uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000));
+    pthread_mutex_lock(&mMutex);
+    mCbCount++;
+    mCbTimeTotal += cbTime;
+    if (cbTime > mCbTimeMax)
+    {
+        mCbTimeMax = cbTime;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+
+int VideoFrameFilter::pushCallbackJob(Buffer *buffer, const pdraw_video_frame_t *frame)
+{
+    video_frame_filter_cb_job_t job;
+    job.buffer = buffer;
+    memcpy(&job.frame, frame, sizeof(job.frame));
+
+    pthread_mutex_lock(&mMutex);
+    if (mCbJobs.size() >= mCbThreadCount)
+    {
+        /* All workers are busy: only the latest frames are kept */
+        mDecoder->releaseOutputBuffer(mCbJobs.front().buffer);
+        mCbJobs.pop_front();
+        mCbDropCount++;
+    }
+    mCbJobs.push_back(job);
+    if (mCbJobs.size() > mCbQueueMaxDepth)
+    {
+        mCbQueueMaxDepth = mCbJobs.size();
+    }
+    pthread_mutex_unlock(&mMutex);
+    pthread_cond_broadcast(&mCbCondition);
+
+    return 0;
+}
+
+
+void* VideoFrameFilter::runCallbackThread(void *ptr)
+{
+    video_frame_filter_cb_worker_t *worker = (video_frame_filter_cb_worker_t*)ptr;
+    VideoFrameFilter *filter = worker->filter;
+
+    pthread_mutex_lock(&filter->mMutex);
+    while (!filter->mThreadShouldStop)
+    {
+        if (filter->mCbJobs.size() == 0)
+        {
+            pthread_cond_wait(&filter->mCbCondition, &filter->mMutex);
+            continue;
+        }
+
+        /* Sequence numbers follow the decoding order of the queued frames */
+        video_frame_filter_cb_job_t job = filter->mCbJobs.front();
+        filter->mCbJobs.pop_front();
+        uint64_t seq = filter->mCbNextSeq++;
+
+        if (filter->mCbOrdered)
+        {
+            /* Reorder stage: the callbacks are started in sequence */
+            while ((filter->mCbStartSeq != seq) && (!filter->mThreadShouldStop))
+            {
+                pthread_cond_wait(&filter->mCbCondition, &filter->mMutex);
+            }
+        }
+        filter->mCbStartSeq++;
+        pthread_cond_broadcast(&filter->mCbCondition);
+        pthread_mutex_unlock(&filter->mMutex);
+
+        if (!filter->mThreadShouldStop)
+        {
+            filter->deliverCallbackFrame(&job.frame, &worker->buffers);
+        }
+        filter->mDecoder->releaseOutputBuffer(job.buffer);
+
+        pthread_mutex_lock(&filter->mMutex);
+    }
+    pthread_mutex_unlock(&filter->mMutex);
+
+    return NULL;
+}
+
+
 void* VideoFrameFilter::runThread(void *ptr)
 {
     VideoFrameFilter *filter = (VideoFrameFilter*)ptr;
@@ -239,7 +1145,12 @@ void* VideoFrameFilter::runThread(void *ptr)
 
     while (!filter->mThreadShouldStop)
     {
-        if ((filter->mDecoder) && (filter->mDecoder->isConfigured()))
+        if (!filter->mDecoder->isConfigured())
+        {
+            /* Wait for the first frame; the decoder output starts once configured */
+            filter->mDecoderOutputBufferQueue->peekBuffer(true);
+        }
+        else
         {
             Buffer *buffer;
 
@@ -283,147 +1194,49 @@ void* VideoFrameFilter::runThread(void *ptr)
                 frame.userData = (uint8_t *)buffer->getUserDataPtr();
                 frame.userDataSize = buffer->getUserDataSize();
 
-                if (filter->mCb)
+                pthread_mutex_lock(&filter->mMutex);
+                filter->mFrameCount++;
+                pthread_mutex_unlock(&filter->mMutex);
+
+                if ((filter->mCb) && (filter->mCbThreadCount > 1))
+                {
+                    /* The worker releases the decoder buffer */
+                    filter->pushCallbackJob(buffer, &frame);
+                    buffer = NULL;
+                }
+                else if (filter->mCb)
                 {
-                    filter->mCb(filter, &frame, filter->mUserPtr);
+                    filter->deliverCallbackFrame(&frame, &filter->mCbBuffers);
+                }
+                else if (filter->mRingSize > 0)
+                {
+                    /* The frame is copied; the decoder buffer is released */
+                    filter->pushRingFrame(&frame);
                 }
                 else
                 {
-                    if ((filter->mWidth == 0) || (filter->mHeight == 0)
-                            || (filter->mColorFormat == PDRAW_COLOR_FORMAT_UNKNOWN))
-                    {
-                        unsigned int size = frame.width * frame.height * 3 / 2;
-                        filter->mBuffer[0] = (uint8_t*)malloc(size);
-                        if (filter->mBuffer[0] == NULL)
-                        {
-                            ULOGE("VideoFrameFilter: frame allocation failed (size %d)", size);
-                        }
-                        filter->mBuffer[1] = (uint8_t*)malloc(size);
-                        if (filter->mBuffer[1] == NULL)
-                        {
-                            ULOGE("VideoFrameFilter: frame allocation failed (size %d)", size);
-                        }
-                        if ((filter->mBuffer[0] != NULL) && (filter->mBuffer[1]))
-                        {
-                            filter->mWidth = frame.width;
-                            filter->mHeight = frame.height;
-                            filter->mColorFormat = frame.colorFormat;
-                        }
-                    }
-
-                    if ((frame.width != filter->mWidth) || (frame.height != filter->mHeight)
-                            || (frame.colorFormat != filter->mColorFormat))
-                    {
-                        ULOGW("VideoFrameFilter: unsupported change of frame format");
-                    }
-                    else
-                    {
-                        pthread_mutex_lock(&filter->mMutex);
-
-                        switch(frame.colorFormat)
-                        {
-                            default:
-                            case PDRAW_COLOR_FORMAT_UNKNOWN:
-                                break;
-                            case PDRAW_COLOR_FORMAT_YUV420PLANAR:
-                            {
-                                uint8_t *pSrcY = data->plane[0];
-                                uint8_t *pSrcU = data->plane[1];
-                                uint8_t *pSrcV = data->plane[2];
-                                uint8_t *pDstY = frame.plane[0] = filter->mBuffer[filter->mBufferIndex ^ 1];
-                                uint8_t *pDstU = frame.plane[1] = filter->mBuffer[filter->mBufferIndex ^ 1] + filter->mWidth * filter->mHeight;
-                                uint8_t *pDstV = frame.plane[2] = filter->mBuffer[filter->mBufferIndex ^ 1] + filter->mWidth * filter->mHeight * 5 / 4;
-                                frame.stride[0] = filter->mWidth;
-                                frame.stride[1] = filter->mWidth / 2;
-                                frame.stride[2] = filter->mWidth / 2;
-                                unsigned int y;
-                                for (y = 0; y < filter->mHeight; y++)
-                                {
-                                    memcpy(pDstY, pSrcY, filter->mWidth);
-                                    pSrcY += data->stride[0];
-                                    pDstY += filter->mWidth;
-                                }
-                                for (y = 0; y < filter->mHeight / 2; y++)
-                                {
-                                    memcpy(pDstU, pSrcU, filter->mWidth / 2);
-                                    memcpy(pDstV, pSrcV, filter->mWidth / 2);
-                                    pSrcU += data->stride[1];
-                                    pSrcV += data->stride[2];
-                                    pDstU += filter->mWidth / 2;
-                                    pDstV += filter->mWidth / 2;
-                                }
-                                break;
-                            }
-                            case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
-                            {
-                                uint8_t *pSrcY = data->plane[0];
-                                uint8_t *pSrcUV = data->plane[1];
-                                uint8_t *pDstY = frame.plane[0] = filter->mBuffer[filter->mBufferIndex ^ 1];
-                                uint8_t *pDstUV = frame.plane[1] = filter->mBuffer[filter->mBufferIndex ^ 1] + filter->mWidth * filter->mHeight;
-                                frame.stride[0] = filter->mWidth;
-                                frame.stride[1] = filter->mWidth;
-                                unsigned int y;
-                                for (y = 0; y < filter->mHeight; y++)
-                                {
-                                    memcpy(pDstY, pSrcY, filter->mWidth);
-                                    pSrcY += data->stride[0];
-                                    pDstY += filter->mWidth;
-                                }
-                                for (y = 0; y < filter->mHeight / 2; y++)
-                                {
-                                    memcpy(pDstUV, pSrcUV, filter->mWidth);
-                                    pSrcUV += data->stride[1];
-                                    pDstUV += filter->mWidth;
-                                }
-                                break;
-                            }
-                        }
-
-                        memcpy(&filter->mBufferData[filter->mBufferIndex ^ 1], &frame, sizeof(frame));
-
-                        /* user data */
-                        if ((frame.userData) && (frame.userDataSize))
-                        {
-                            if (frame.userDataSize > filter->mUserDataBuferSize[filter->mBufferIndex ^ 1])
-                            {
-                                unsigned int size = (frame.userDataSize + VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1) & (~(VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1));
-                                uint8_t *tmp = (uint8_t *)realloc(filter->mUserData[filter->mBufferIndex ^ 1], size);
-                                if (tmp)
-                                {
-                                    filter->mUserData[filter->mBufferIndex ^ 1] = tmp;
-                                    filter->mUserDataBuferSize[filter->mBufferIndex ^ 1] = size;
-                                }
-                            }
-                            if (frame.userDataSize <= filter->mUserDataBuferSize[filter->mBufferIndex ^ 1])
-                            {
-                                memcpy(filter->mUserData[filter->mBufferIndex ^ 1], frame.userData, frame.userDataSize);
-                                filter->mBufferData[filter->mBufferIndex ^ 1].userData = filter->mUserData[filter->mBufferIndex ^ 1];
-                                filter->mBufferData[filter->mBufferIndex ^ 1].userDataSize = frame.userDataSize;
-                            }
-                            else
-                            {
-                                filter->mBufferData[filter->mBufferIndex ^ 1].userData = NULL;
-                                filter->mBufferData[filter->mBufferIndex ^ 1].userDataSize = 0;
-                            }
-                        }
-
-                        filter->mFrameAvailable = true;
-                        pthread_mutex_unlock(&filter->mMutex);
-                        pthread_cond_signal(&filter->mCondition);
-                    }
+                    /* Keep a reference on the latest frame; it is only
+                     * copied if a detached frame is requested */
+                    pthread_mutex_lock(&filter->mMutex);
+                    Buffer *previous = filter->mLastBuffer;
+                    filter->mLastBuffer = buffer;
+                    memcpy(&filter->mLastFrame, &frame, sizeof(frame));
+                    filter->mFrameAvailable = true;
+                    pthread_mutex_unlock(&filter->mMutex);
+                    pthread_cond_signal(&filter->mCondition);
+                    buffer = previous;
                 }
 
-                ret = filter->mDecoder->releaseOutputBuffer(buffer);
-                if (ret != 0)
+                if (buffer)
                 {
-                    ULOGE("VideoFrameFilter: failed to release buffer (%d)", ret);
+                    ret = filter->mDecoder->releaseOutputBuffer(buffer);
+                    if (ret != 0)
+                    {
+                        ULOGE("VideoFrameFilter: failed to release buffer (%d)", ret);
+                    }
                 }
             }
         }
-        else
-        {
-            usleep(5000); //TODO
-        }
     }
 
     return NULL;
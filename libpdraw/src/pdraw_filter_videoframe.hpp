@@ -40,12 +40,32 @@
 #define _PDRAW_FILTER_VIDEOFRAME_HPP_
 
 #include <pthread.h>
+#include <vector>
+#include <deque>
 
 #include <pdraw/pdraw_defs.h>
 
 #include "pdraw_avcdecoder.hpp"
 
 
+/* Only the latest frames are kept for a slow callback */
+#define VIDEO_FRAME_FILTER_QUEUE_MAX_DEPTH 2
+
+/* Borrowed frames that are not released are released automatically
+ * after this number of getLastFrame() calls */
+#define VIDEO_FRAME_FILTER_MAX_BORROWED_FRAMES 2
+
+/* Maximum frame ring size; the ring allocates one more slot for the
+ * frame currently held by the consumer */
+#define VIDEO_FRAME_FILTER_RING_MAX_SIZE 64
+
+/* User data larger than this are not copied to the ring slots */
+#define VIDEO_FRAME_FILTER_RING_USER_DATA_SIZE 1024
+
+/* Maximum callback worker thread count */
+#define VIDEO_FRAME_FILTER_CB_MAX_THREADS 16
+
+
 namespace Pdraw
 {
 
@@ -54,17 +74,97 @@ class Media;
 class VideoMedia;
 
 
+/* The decoder buffers are reused: a borrowed frame is identified by its
+ * plane and its timestamps, so that a late release of a previous frame
+ * in the same buffer is rejected */
+typedef struct
+{
+    Buffer *buffer;
+    uint8_t *plane;
+    uint64_t auNtpTimestamp;
+    uint64_t auNtpTimestampLocal;
+
+} video_frame_filter_borrowed_frame_t;
+
+
+class VideoFrameFilter;
+
+
+typedef struct
+{
+    Buffer *buffer;
+    pdraw_video_frame_t frame;
+
+} video_frame_filter_cb_job_t;
+
+
+/* Output format and scaling, copied under the mutex so that the frames
+ * can be processed without holding it */
+typedef struct
+{
+    pdraw_color_format_t outputFormat;
+    pdraw_color_matrix_t colorMatrix;
+    unsigned int scaleWidth;
+    unsigned int scaleHeight;
+    pdraw_rect_t roi;
+
+} video_frame_filter_process_params_t;
+
+
+/* Buffers owned by one callback thread */
+typedef struct
+{
+    uint8_t *convertBuffer;
+    unsigned int convertBufferSize;
+    uint8_t *scaleBuffer;
+    unsigned int scaleBufferSize;
+
+} video_frame_filter_cb_buffers_t;
+
+
+typedef struct
+{
+    VideoFrameFilter *filter;
+    pthread_t thread;
+    bool threadLaunched;
+    video_frame_filter_cb_buffers_t buffers;
+
+} video_frame_filter_cb_worker_t;
+
+
 class VideoFrameFilter
 {
 public:
 
     VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder);
 
-    VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw_video_frame_filter_callback_t cb, void *userPtr);
+    /*
+     * Callback mode: with cbThreadCount > 1 the callbacks are dispatched
+     * to a pool of worker threads (each frame keeps a reference on the
+     * decoder buffer until its callback returns) and can run
+     * concurrently; if cbOrdered, the callbacks are started in the
+     * decoding order, otherwise in any order. At most cbThreadCount
+     * frames are queued, older frames are dropped.
+     */
+    VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                     unsigned int cbThreadCount = 1, bool cbOrdered = true);
+
+    /*
+     * Ring mode: every decoded frame is copied into one of ringSize
+     * preallocated slots and returned in order by getNextFrame().
+     * When the ring is full, the oldest frame is overwritten
+     * (PDRAW_FRAME_RING_OVERFLOW_DROP_OLDEST) or the decoder output
+     * is stalled until a slot is free (PDRAW_FRAME_RING_OVERFLOW_BLOCK).
+     */
+    VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy);
 
     ~VideoFrameFilter();
 
     /*
+     * Get the last frame without copy: the frame points to the decoder
+     * output buffer, which is referenced until releaseFrame() is called
+     * (or after VIDEO_FRAME_FILTER_MAX_BORROWED_FRAMES more calls).
+     *
      * waitUs : wait a frame, time in microseconds.
      *  0: don't wait
      * -1: wait forever
@@ -72,14 +172,87 @@ public:
      */
     int getLastFrame(pdraw_video_frame_t *frame, long waitUs = 0);
 
+    int releaseFrame(const pdraw_video_frame_t *frame);
+
+    /*
+     * Get a copy of the last frame, valid until the second next call;
+     * no release is needed.
+     */
+    int getDetachedFrame(pdraw_video_frame_t *frame, long waitUs = 0);
+
+    /*
+     * Get the next frame from the ring (ring mode only); the frame is
+     * valid until the next call or until releaseFrame() is called.
+     */
+    int getNextFrame(pdraw_video_frame_t *frame, long waitUs = 0);
+
+    int getStats(pdraw_video_frame_producer_stats_t *stats);
+
+    /*
+     * Set the output format (PDRAW_COLOR_FORMAT_UNKNOWN: decoder format).
+     * Ring and callback frames are converted on the filter thread;
+     * last frames are converted when they are requested, and are then
+     * returned as detached frames (this also applies to scaling).
+     */
+    int setOutputFormat(pdraw_color_format_t format, pdraw_color_matrix_t matrix);
+
+    /*
+     * Set the output dimensions (0: region of interest dimensions) and
+     * region of interest (NULL: full frame); the frames are cropped and
+     * scaled while they are copied or converted.
+     */
+    int setScaling(unsigned int width, unsigned int height, const pdraw_rect_t *roi);
+
     Media *getMedia() { return mMedia; };
 
     VideoMedia *getVideoMedia() { return (VideoMedia*)mMedia; };
 
 private:
 
+    VideoFrameFilter(VideoMedia *media, AvcDecoder *decoder, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                     unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy,
+                     unsigned int cbThreadCount, bool cbOrdered);
+
     static void* runThread(void *ptr);
 
+    static void* runCallbackThread(void *ptr);
+
+    int waitFrame(long waitUs);
+
+    int copyFrame(const pdraw_video_frame_t *frame, unsigned int index);
+
+    void getProcessParams(video_frame_filter_process_params_t *params);
+
+    unsigned int getOutputFrameSize(const pdraw_video_frame_t *frame);
+
+    static unsigned int getOutputFrameSize(const pdraw_video_frame_t *frame,
+                                           const video_frame_filter_process_params_t *params);
+
+    int convertFrame(const pdraw_video_frame_t *frame, pdraw_video_frame_t *dst, uint8_t *buf);
+
+    static int processFrame(const pdraw_video_frame_t *frame, pdraw_video_frame_t *dst, uint8_t *buf,
+                            const video_frame_filter_process_params_t *params,
+                            uint8_t **scaleBuffer, unsigned int *scaleBufferSize);
+
+    void addProcessTime(unsigned int processTime);
+
+    int allocRing(const pdraw_video_frame_t *frame);
+
+    void freeRing();
+
+    int pushRingFrame(const pdraw_video_frame_t *frame);
+
+    void releaseRingSlot();
+
+    bool isFrameProcessed() { return ((mOutputFormat != PDRAW_COLOR_FORMAT_UNKNOWN) || (mScaleWidth) || (mScaleHeight) || (mRoi.width)); };
+
+    int convertCallbackFrame(const pdraw_video_frame_t *frame, pdraw_video_frame_t *dst,
+                             video_frame_filter_cb_buffers_t *buffers);
+
+    void deliverCallbackFrame(const pdraw_video_frame_t *frame, video_frame_filter_cb_buffers_t *buffers);
+
+    int pushCallbackJob(Buffer *buffer, const pdraw_video_frame_t *frame);
+
     Media *mMedia;
     AvcDecoder *mDecoder;
     BufferQueue *mDecoderOutputBufferQueue;
@@ -95,10 +268,52 @@ private:
     unsigned int mUserDataBuferSize[2];
     pdraw_video_frame_t mBufferData[2];
     unsigned int mBufferIndex;
+    Buffer *mLastBuffer;
+    pdraw_video_frame_t mLastFrame;
+    std::vector<video_frame_filter_borrowed_frame_t> mBorrowedFrames;
     pdraw_color_format_t mColorFormat;
     unsigned int mWidth;
     unsigned int mHeight;
     bool mFrameAvailable;
+    pdraw_color_format_t mOutputFormat;
+    pdraw_color_matrix_t mColorMatrix;
+    video_frame_filter_cb_buffers_t mCbBuffers;
+    unsigned int mScaleWidth;
+    unsigned int mScaleHeight;
+    pdraw_rect_t mRoi;
+    uint8_t *mScaleBuffer;
+    unsigned int mScaleBufferSize;
+    unsigned int mProcessCount;
+    uint64_t mProcessTimeTotal;
+    unsigned int mProcessTimeMax;
+    unsigned int mCbThreadCount;
+    bool mCbOrdered;
+    std::vector<video_frame_filter_cb_worker_t> mCbWorkers;
+    std::deque<video_frame_filter_cb_job_t> mCbJobs;
+    pthread_cond_t mCbCondition;
+    uint64_t mCbNextSeq;
+    uint64_t mCbStartSeq;
+    unsigned int mCbQueueMaxDepth;
+    unsigned int mCbDropCount;
+    unsigned int mCbCount;
+    uint64_t mCbTimeTotal;
+    unsigned int mCbTimeMax;
+    unsigned int mFrameCount;
+    unsigned int mRingSize;
+    pdraw_frame_ring_overflow_policy_t mRingPolicy;
+    pthread_cond_t mRingCondition;
+    uint8_t *mRingBuffer;
+    uint8_t *mRingRetiredBuffer;
+    unsigned int mRingSlotSize;
+    std::vector<pdraw_video_frame_t> mRingSlots;
+    std::vector<unsigned int> mRingFreeSlots;
+    std::deque<unsigned int> mRingQueue;
+    int mRingInUseSlot;
+    pdraw_color_format_t mRingColorFormat;
+    unsigned int mRingWidth;
+    unsigned int mRingHeight;
+    unsigned int mRingMaxDepth;
+    unsigned int mRingOverflowCount;
 };
 
 }
@@ -41,6 +41,7 @@
 #include "pdraw_demuxer_record.hpp"
 #include "pdraw_decoder.hpp"
 #include "pdraw_avcdecoder.hpp"
+#include "pdraw_decoder_pool.hpp"
 #include "pdraw_renderer.hpp"
 #include "pdraw_media_video.hpp"
 #include "pdraw_filter_videoframe.hpp"
@@ -63,6 +64,18 @@ IPdraw *createPdraw()
 }
 
 
+int setDecoderPoolWorkerCount(unsigned int count)
+{
+    return DecoderPool::getInstance()->setWorkerCount(count);
+}
+
+
+int setAvcDecoderPriority(const std::string &name, int priority)
+{
+    return AvcDecoderRegistry::getInstance()->setPriority(name, priority);
+}
+
+
 PdrawImpl::PdrawImpl() : mSession(&mSettings)
 {
     mPaused = false;
@@ -192,11 +205,11 @@ int PdrawImpl::stop()
 }
 
 
-int PdrawImpl::seekTo(uint64_t timestamp)
+int PdrawImpl::seekTo(uint64_t timestamp, bool exact)
 {
     if (mSession.getDemuxer())
     {
-        int ret = mSession.getDemuxer()->seekTo(timestamp);
+        int ret = mSession.getDemuxer()->seekTo(timestamp, exact);
         if (ret != 0)
         {
             ULOGE("Failed to seek with demuxer");
@@ -213,11 +226,11 @@ int PdrawImpl::seekTo(uint64_t timestamp)
 }
 
 
-int PdrawImpl::seekForward(uint64_t delta)
+int PdrawImpl::seekForward(uint64_t delta, bool exact)
 {
     if (mSession.getDemuxer())
     {
-        int ret = mSession.getDemuxer()->seekForward(delta);
+        int ret = mSession.getDemuxer()->seekForward(delta, exact);
         if (ret != 0)
         {
             ULOGE("Failed to seek with demuxer");
@@ -234,11 +247,11 @@ int PdrawImpl::seekForward(uint64_t delta)
 }
 
 
-int PdrawImpl::seekBack(uint64_t delta)
+int PdrawImpl::seekBack(uint64_t delta, bool exact)
 {
     if (mSession.getDemuxer())
     {
-        int ret = mSession.getDemuxer()->seekBack(delta);
+        int ret = mSession.getDemuxer()->seekBack(delta, exact);
         if (ret != 0)
         {
             ULOGE("Failed to seek with demuxer");
@@ -267,6 +280,82 @@ uint64_t PdrawImpl::getCurrentTime()
 }
 
 
+int PdrawImpl::setPlaybackSpeed(float speed)
+{
+    if (mSession.getDemuxer())
+    {
+        int ret = mSession.getDemuxer()->setSpeed(speed);
+        if (ret != 0)
+        {
+            ULOGE("Failed to set the demuxer speed");
+            return -1;
+        }
+    }
+    else
+    {
+        ULOGE("Invalid demuxer");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+float PdrawImpl::getPlaybackSpeed()
+{
+    if (mSession.getDemuxer())
+    {
+        return mSession.getDemuxer()->getSpeed();
+    }
+    else
+    {
+        return 1.f;
+    }
+}
+
+
+int PdrawImpl::stepForward()
+{
+    if ((mSession.getDemuxer()) && (mSession.getDemuxer()->getType() == DEMUXER_TYPE_RECORD))
+    {
+        return ((RecordDemuxer*)mSession.getDemuxer())->stepForward();
+    }
+    else
+    {
+        ULOGE("Invalid demuxer");
+        return -1;
+    }
+}
+
+
+int PdrawImpl::stepBack()
+{
+    if ((mSession.getDemuxer()) && (mSession.getDemuxer()->getType() == DEMUXER_TYPE_RECORD))
+    {
+        return ((RecordDemuxer*)mSession.getDemuxer())->stepBack();
+    }
+    else
+    {
+        ULOGE("Invalid demuxer");
+        return -1;
+    }
+}
+
+
+int PdrawImpl::getKeyframeList(pdraw_keyframe_t *keyframes, unsigned int maxCount)
+{
+    if ((mSession.getDemuxer()) && (mSession.getDemuxer()->getType() == DEMUXER_TYPE_RECORD))
+    {
+        return ((RecordDemuxer*)mSession.getDemuxer())->getKeyframeList(keyframes, maxCount);
+    }
+    else
+    {
+        ULOGE("Invalid demuxer");
+        return -1;
+    }
+}
+
+
 int PdrawImpl::startRecorder(const std::string &fileName)
 {
     if ((mSession.getDemuxer()) && (mSession.getDemuxer()->getType() == DEMUXER_TYPE_STREAM))
@@ -748,7 +837,41 @@ int PdrawImpl::getMediaInfo(unsigned int index, pdraw_media_info_t *info)
 }
 
 
-void *PdrawImpl::addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_frame_filter_callback_t cb, void *userPtr)
+int PdrawImpl::getDecoderStats(unsigned int mediaId, pdraw_decoder_stats_t *stats)
+{
+    if (!stats)
+    {
+        ULOGE("Invalid stats struct");
+        return -1;
+    }
+
+    Media *media = mSession.getMediaById(mediaId);
+
+    if (!media)
+    {
+        ULOGE("Invalid media id");
+        return -1;
+    }
+
+    if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO)
+    {
+        ULOGE("Invalid media type");
+        return -1;
+    }
+
+    AvcDecoder *decoder = (AvcDecoder*)((VideoMedia*)media)->getDecoder();
+    if (!decoder)
+    {
+        ULOGE("No decoder for this media");
+        return -1;
+    }
+
+    return decoder->getStats(stats);
+}
+
+
+void *PdrawImpl::addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                             unsigned int threadCount, bool ordered)
 {
     Media *media = mSession.getMediaById(mediaId);
 
@@ -764,7 +887,7 @@ void *PdrawImpl::addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_f
         return NULL;
     }
 
-    VideoFrameFilter *filter = ((VideoMedia*)media)->addVideoFrameFilter(cb, userPtr);
+    VideoFrameFilter *filter = ((VideoMedia*)media)->addVideoFrameFilter(cb, userPtr, threadCount, ordered);
     if (!filter)
     {
         ULOGE("Failed to create video frame filter");
@@ -869,6 +992,137 @@ int PdrawImpl::getProducerLastFrame(void *producerCtx, pdraw_video_frame_t *fram
 }
 
 
+int PdrawImpl::releaseProducerFrame(void *producerCtx, const pdraw_video_frame_t *frame)
+{
+    if (!producerCtx)
+    {
+        ULOGE("Invalid context pointer");
+        return -1;
+    }
+    if (!frame)
+    {
+        ULOGE("Invalid frame structure pointer");
+        return -1;
+    }
+
+    VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+    return filter->releaseFrame(frame);
+}
+
+
+int PdrawImpl::getProducerDetachedFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs)
+{
+    if (!producerCtx)
+    {
+        ULOGE("Invalid context pointer");
+        return -1;
+    }
+    if (!frame)
+    {
+        ULOGE("Invalid frame structure pointer");
+        return -1;
+    }
+
+    VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+    return filter->getDetachedFrame(frame, waitUs);
+}
+
+
+void *PdrawImpl::addVideoFrameRingProducer(unsigned int mediaId, unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy)
+{
+    Media *media = mSession.getMediaById(mediaId);
+
+    if (!media)
+    {
+        ULOGE("Invalid media id");
+        return NULL;
+    }
+
+    if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO)
+    {
+        ULOGE("Invalid media type");
+        return NULL;
+    }
+
+    VideoFrameFilter *filter = ((VideoMedia*)media)->addVideoFrameFilter(ringSize, ringPolicy);
+    if (!filter)
+    {
+        ULOGE("Failed to create video frame filter");
+        return NULL;
+    }
+
+    return (void*)filter;
+}
+
+
+int PdrawImpl::getProducerNextFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs)
+{
+    if (!producerCtx)
+    {
+        ULOGE("Invalid context pointer");
+        return -1;
+    }
+    if (!frame)
+    {
+        ULOGE("Invalid frame structure pointer");
+        return -1;
+    }
+
+    VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+    return filter->getNextFrame(frame, waitUs);
+}
+
+
+int PdrawImpl::getProducerStats(void *producerCtx, pdraw_video_frame_producer_stats_t *stats)
+{
+    if (!producerCtx)
+    {
+        ULOGE("Invalid context pointer");
+        return -1;
+    }
+    if (!stats)
+    {
+        ULOGE("Invalid stats structure pointer");
+        return -1;
+    }
+
+    VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+    return filter->getStats(stats);
+}
+
+
+int PdrawImpl::setProducerOutputFormat(void *producerCtx, pdraw_color_format_t format, pdraw_color_matrix_t matrix)
+{
+    if (!producerCtx)
+    {
+        ULOGE("Invalid context pointer");
+        return -1;
+    }
+
+    VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+    return filter->setOutputFormat(format, matrix);
+}
+
+
+int PdrawImpl::setProducerScaling(void *producerCtx, unsigned int width, unsigned int height, const pdraw_rect_t *roi)
+{
+    if (!producerCtx)
+    {
+        ULOGE("Invalid context pointer");
+        return -1;
+    }
+
+    VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+    return filter->setScaling(width, height, roi);
+}
+
+
 float PdrawImpl::getControllerRadarAngleSetting(void)
 {
     return mSettings.getControllerRadarAngle();
@@ -904,4 +1158,100 @@ void PdrawImpl::setHmdDistorsionCorrectionSettings(pdraw_hmd_model_t hmdModel, f
     mSettings.setHmdDistorsionCorrectionSettings(hmdModel, ipd, scale, panH, panV);
 }
 
+
+void PdrawImpl::getDecoderThreadingSettings(unsigned int *threadCount, pdraw_decoder_thread_type_t *threadType)
+{
+    mSettings.getDecoderThreadingSettings(threadCount, threadType);
+}
+
+
+void PdrawImpl::setDecoderThreadingSettings(unsigned int threadCount, pdraw_decoder_thread_type_t threadType)
+{
+    mSettings.setDecoderThreadingSettings(threadCount, threadType);
+}
+
+
+void PdrawImpl::getRecordIndexSettings(bool *enabled, bool *persistent)
+{
+    mSettings.getRecordIndexSettings(enabled, persistent);
+}
+
+
+void PdrawImpl::setRecordIndexSettings(bool enabled, bool persistent)
+{
+    mSettings.setRecordIndexSettings(enabled, persistent);
+}
+
+
+void PdrawImpl::getReversePlaybackSettings(unsigned int *cacheMaxSize)
+{
+    mSettings.getReversePlaybackSettings(cacheMaxSize);
+}
+
+
+void PdrawImpl::setReversePlaybackSettings(unsigned int cacheMaxSize)
+{
+    mSettings.setReversePlaybackSettings(cacheMaxSize);
+}
+
+
+void PdrawImpl::getDecoderFramePoolSettings(unsigned int *maxSize)
+{
+    mSettings.getDecoderFramePoolSettings(maxSize);
+}
+
+
+void PdrawImpl::setDecoderFramePoolSettings(unsigned int maxSize)
+{
+    mSettings.setDecoderFramePoolSettings(maxSize);
+}
+
+
+void PdrawImpl::getDecoderOverloadSettings(bool *enabled, unsigned int *maxQueueDepth, unsigned int *maxAuAge)
+{
+    mSettings.getDecoderOverloadSettings(enabled, maxQueueDepth, maxAuAge);
+}
+
+
+void PdrawImpl::setDecoderOverloadSettings(bool enabled, unsigned int maxQueueDepth, unsigned int maxAuAge)
+{
+    mSettings.setDecoderOverloadSettings(enabled, maxQueueDepth, maxAuAge);
+}
+
+
+void PdrawImpl::getStreamProfileSettings(pdraw_stream_profile_t *profile)
+{
+    mSettings.getStreamProfileSettings(profile);
+}
+
+
+void PdrawImpl::setStreamProfileSettings(pdraw_stream_profile_t profile)
+{
+    mSettings.setStreamProfileSettings(profile);
+}
+
+
+void PdrawImpl::getDecoderPoolSettings(bool *shared)
+{
+    mSettings.getDecoderPoolSettings(shared);
+}
+
+
+void PdrawImpl::setDecoderPoolSettings(bool shared)
+{
+    mSettings.setDecoderPoolSettings(shared);
+}
+
+
+void PdrawImpl::getDecoderBackendSettings(std::string *name)
+{
+    mSettings.getDecoderBackendSettings(name);
+}
+
+
+void PdrawImpl::setDecoderBackendSettings(const std::string &name)
+{
+    mSettings.setDecoderBackendSettings(name);
+}
+
 }
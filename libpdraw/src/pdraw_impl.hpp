@@ -91,18 +91,34 @@ public:
     int stop(void);
 
     int seekTo
-            (uint64_t timestamp);
+            (uint64_t timestamp,
+             bool exact = false);
 
     int seekForward
-            (uint64_t delta);
+            (uint64_t delta,
+             bool exact = false);
 
     int seekBack
-            (uint64_t delta);
+            (uint64_t delta,
+             bool exact = false);
 
     uint64_t getDuration();
 
     uint64_t getCurrentTime();
 
+    int setPlaybackSpeed
+            (float speed);
+
+    float getPlaybackSpeed();
+
+    int stepForward();
+
+    int stepBack();
+
+    int getKeyframeList
+            (pdraw_keyframe_t *keyframes,
+             unsigned int maxCount);
+
     int startRecorder
             (const std::string &fileName);
 
@@ -235,7 +251,10 @@ public:
 
     int getMediaInfo(unsigned int index, pdraw_media_info_t *info);
 
-    void *addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_frame_filter_callback_t cb, void *userPtr);
+    int getDecoderStats(unsigned int mediaId, pdraw_decoder_stats_t *stats);
+
+    void *addVideoFrameFilterCallback(unsigned int mediaId, pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                      unsigned int threadCount = 1, bool ordered = true);
 
     int removeVideoFrameFilterCallback(unsigned int mediaId, void *filterCtx);
 
@@ -253,6 +272,20 @@ public:
      */
     int getProducerLastFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs = 0);
 
+    int releaseProducerFrame(void *producerCtx, const pdraw_video_frame_t *frame);
+
+    int getProducerDetachedFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs = 0);
+
+    void *addVideoFrameRingProducer(unsigned int mediaId, unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy);
+
+    int getProducerNextFrame(void *producerCtx, pdraw_video_frame_t *frame, long waitUs = 0);
+
+    int getProducerStats(void *producerCtx, pdraw_video_frame_producer_stats_t *stats);
+
+    int setProducerOutputFormat(void *producerCtx, pdraw_color_format_t format, pdraw_color_matrix_t matrix);
+
+    int setProducerScaling(void *producerCtx, unsigned int width, unsigned int height, const pdraw_rect_t *roi = NULL);
+
     float getControllerRadarAngleSetting(void);
     void setControllerRadarAngleSetting(float angle);
 
@@ -262,6 +295,30 @@ public:
     void getHmdDistorsionCorrectionSettings(pdraw_hmd_model_t *hmdModel, float *ipd, float *scale, float *panH, float *panV);
     void setHmdDistorsionCorrectionSettings(pdraw_hmd_model_t hmdModel, float ipd, float scale, float panH, float panV);
 
+    void getDecoderThreadingSettings(unsigned int *threadCount, pdraw_decoder_thread_type_t *threadType);
+    void setDecoderThreadingSettings(unsigned int threadCount, pdraw_decoder_thread_type_t threadType);
+
+    void getRecordIndexSettings(bool *enabled, bool *persistent);
+    void setRecordIndexSettings(bool enabled, bool persistent);
+
+    void getReversePlaybackSettings(unsigned int *cacheMaxSize);
+    void setReversePlaybackSettings(unsigned int cacheMaxSize);
+
+    void getDecoderFramePoolSettings(unsigned int *maxSize);
+    void setDecoderFramePoolSettings(unsigned int maxSize);
+
+    void getDecoderOverloadSettings(bool *enabled, unsigned int *maxQueueDepth, unsigned int *maxAuAge);
+    void setDecoderOverloadSettings(bool enabled, unsigned int maxQueueDepth, unsigned int maxAuAge);
+
+    void getStreamProfileSettings(pdraw_stream_profile_t *profile);
+    void setStreamProfileSettings(pdraw_stream_profile_t profile);
+
+    void getDecoderPoolSettings(bool *shared);
+    void setDecoderPoolSettings(bool shared);
+
+    void getDecoderBackendSettings(std::string *name);
+    void setDecoderBackendSettings(const std::string &name);
+
     inline static IPdraw *create(void)
     {
         return new PdrawImpl();
@@ -237,7 +237,8 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter()
 }
 
 
-VideoFrameFilter *VideoMedia::addVideoFrameFilter(pdraw_video_frame_filter_callback_t cb, void *userPtr)
+VideoFrameFilter *VideoMedia::addVideoFrameFilter(pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                                  unsigned int threadCount, bool ordered)
 {
     if (!mDecoder)
     {
@@ -250,7 +251,32 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter(pdraw_video_frame_filter_callb
         return NULL;
     }
 
-    VideoFrameFilter *p = new VideoFrameFilter(this, (AvcDecoder*)mDecoder, cb, userPtr);
+    VideoFrameFilter *p = new VideoFrameFilter(this, (AvcDecoder*)mDecoder, cb, userPtr, threadCount, ordered);
+    if (p == NULL)
+    {
+        ULOGE("VideoMedia: video frame filter allocation failed");
+        return NULL;
+    }
+
+    mVideoFrameFilters.push_back(p);
+    return p;
+}
+
+
+VideoFrameFilter *VideoMedia::addVideoFrameFilter(unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy)
+{
+    if (!mDecoder)
+    {
+        ULOGE("VideoMedia: decoder is not enabled");
+        return NULL;
+    }
+    if ((ringSize == 0) || (ringSize > VIDEO_FRAME_FILTER_RING_MAX_SIZE))
+    {
+        ULOGE("VideoMedia: invalid frame ring size");
+        return NULL;
+    }
+
+    VideoFrameFilter *p = new VideoFrameFilter(this, (AvcDecoder*)mDecoder, ringSize, ringPolicy);
     if (p == NULL)
     {
         ULOGE("VideoMedia: video frame filter allocation failed");
@@ -97,7 +97,9 @@ public:
     Decoder *getDecoder() { return mDecoder; };
 
     VideoFrameFilter *addVideoFrameFilter();
-    VideoFrameFilter *addVideoFrameFilter(pdraw_video_frame_filter_callback_t cb, void *userPtr);
+    VideoFrameFilter *addVideoFrameFilter(pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                          unsigned int threadCount = 1, bool ordered = true);
+    VideoFrameFilter *addVideoFrameFilter(unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy);
     int removeVideoFrameFilter(VideoFrameFilter *filter);
 
 private:
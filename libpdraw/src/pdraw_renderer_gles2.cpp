@@ -69,6 +69,7 @@ Gles2Renderer::Gles2Renderer(Session *session, bool initGles2)
     mDecoder = NULL;
     mDecoderOutputBufferQueue = NULL;
     mCurrentBuffer = NULL;
+    memset(&mLatencyStats, 0, sizeof(mLatencyStats));
     mGles2Video = NULL;
     mGles2Hud = NULL;
     mGles2HmdFirstTexUnit = 0;
@@ -274,7 +275,13 @@ int Gles2Renderer::addAvcDecoder(AvcDecoder *decoder)
         return -1;
     }
 
-    mDecoderOutputBufferQueue = decoder->addOutputQueue();
+    /* Live low latency: only the latest frame is kept */
+    unsigned int queueDepth = GLES2_RENDERER_QUEUE_MAX_DEPTH;
+    if ((mSession) && (mSession->isLiveLowLatency()))
+    {
+        queueDepth = 1;
+    }
+    mDecoderOutputBufferQueue = decoder->addOutputQueue(queueDepth, BUFFER_QUEUE_OVERFLOW_DROP_OLDEST);
     if (mDecoderOutputBufferQueue == NULL)
     {
         ULOGE("Gles2Renderer: failed to add output queue to decoder");
@@ -306,6 +313,16 @@ int Gles2Renderer::removeAvcDecoder(AvcDecoder *decoder)
         return -1;
     }
 
+    if (mCurrentBuffer)
+    {
+        int ret = decoder->releaseOutputBuffer(mCurrentBuffer);
+        if (ret != 0)
+        {
+            ULOGE("Gles2Renderer: failed to release buffer (%d)", ret);
+        }
+        mCurrentBuffer = NULL;
+    }
+
     if (mDecoderOutputBufferQueue)
     {
         int ret = decoder->removeOutputQueue(mDecoderOutputBufferQueue);
@@ -317,6 +334,7 @@ int Gles2Renderer::removeAvcDecoder(AvcDecoder *decoder)
 
     mDecoder = NULL;
     mDecoderOutputBufferQueue = NULL;
+    pdraw_latencyStatsLog(&mLatencyStats, "Gles2Renderer");
 
     return 0;
 }
@@ -413,6 +431,16 @@ int Gles2Renderer::render_nolock(uint64_t lastRenderTime)
     }
     else
     {
+        /* Keep a reference on the current frame: it is rendered again
+         * until a new frame is available */
+        if (mCurrentBuffer)
+        {
+            int releaseRet = mDecoder->releaseOutputBuffer(mCurrentBuffer);
+            if (releaseRet != 0)
+            {
+                ULOGE("Gles2Renderer: failed to release buffer (%d)", releaseRet);
+            }
+        }
         mCurrentBuffer = buffer;
     }
 
@@ -505,22 +533,22 @@ int Gles2Renderer::render_nolock(uint64_t lastRenderTime)
                       (float)(renderTimestamp1 - data->decoderOutputTimestamp) / 1000.,
                       (data->auNtpTimestampLocal != 0) ? (float)(renderTimestamp - data->auNtpTimestampLocal) / 1000. : 0.,
                       (renderTimestamp - lastRenderTime > 0) ? 1000000. / ((float)(renderTimestamp - lastRenderTime)) : 0.);
+
+                /* Only the first presentation of a frame is accounted */
+                if ((buffer) && (data->auNtpTimestampLocal != 0) && (renderTimestamp > data->auNtpTimestampLocal))
+                {
+                    pdraw_latencyStatsAdd(&mLatencyStats, renderTimestamp - data->auNtpTimestampLocal);
+                    if (mLatencyStats.count >= GLES2_RENDERER_LATENCY_LOG_INTERVAL)
+                    {
+                        pdraw_latencyStatsLog(&mLatencyStats, "Gles2Renderer");
+                    }
+                }
             }
 
             ret = 1;
         }
     }
 
-    if (buffer)
-    {
-        int releaseRet = mDecoder->releaseOutputBuffer(buffer);
-        if (releaseRet != 0)
-        {
-            ULOGE("Gles2Renderer: failed to release buffer (%d)", releaseRet);
-            ret = releaseRet;
-        }
-    }
-
     return ret;
 }
 
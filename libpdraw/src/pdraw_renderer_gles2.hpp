@@ -47,6 +47,12 @@
 #include "pdraw_gles2_video.hpp"
 #include "pdraw_gles2_hud.hpp"
 #include "pdraw_gles2_hmd.hpp"
+#include "pdraw_utils.hpp"
+
+
+/* The renderer only displays the latest frame */
+#define GLES2_RENDERER_QUEUE_MAX_DEPTH 2
+#define GLES2_RENDERER_LATENCY_LOG_INTERVAL 300 /* frames */
 
 
 namespace Pdraw
@@ -100,6 +106,7 @@ protected:
     AvcDecoder *mDecoder;
     BufferQueue *mDecoderOutputBufferQueue;
     Buffer *mCurrentBuffer;
+    pdraw_latency_stats_t mLatencyStats;
     int mWindowWidth;
     int mWindowHeight;
     int mRenderX;
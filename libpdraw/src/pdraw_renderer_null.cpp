@@ -37,8 +37,9 @@
  */
 
 #include "pdraw_renderer_null.hpp"
+#include "pdraw_session.hpp"
 
-#include <unistd.h>
+#include <string.h>
 #include <time.h>
 
 #define ULOG_TAG libpdraw
@@ -58,6 +59,22 @@ NullRenderer::NullRenderer(Session *session)
     mDecoderOutputBufferQueue = NULL;
     mRendererThreadLaunched = false;
     mThreadShouldStop = false;
+    memset(&mLatencyStats, 0, sizeof(mLatencyStats));
+
+    ret = pthread_mutex_init(&mMutex, NULL);
+    if (ret != 0)
+    {
+        ULOGE("NullRenderer: mutex creation failed (%d)", ret);
+    }
+
+    if (ret == 0)
+    {
+        ret = pthread_cond_init(&mCond, NULL);
+        if (ret != 0)
+        {
+            ULOGE("NullRenderer: cond creation failed (%d)", ret);
+        }
+    }
 
     if (ret == 0)
     {
@@ -76,7 +93,14 @@ NullRenderer::NullRenderer(Session *session)
 
 NullRenderer::~NullRenderer()
 {
+    pthread_mutex_lock(&mMutex);
     mThreadShouldStop = true;
+    pthread_cond_signal(&mCond);
+    if (mDecoderOutputBufferQueue)
+    {
+        mDecoderOutputBufferQueue->signal();
+    }
+    pthread_mutex_unlock(&mMutex);
 
     if (mRendererThreadLaunched)
     {
@@ -93,6 +117,9 @@ NullRenderer::~NullRenderer()
         if (ret != 0)
             ULOGE("NullRenderer: removeAvcDecoder() failed (%d)", ret);
     }
+
+    pthread_mutex_destroy(&mMutex);
+    pthread_cond_destroy(&mCond);
 }
 
 
@@ -109,15 +136,24 @@ int NullRenderer::addAvcDecoder(AvcDecoder *decoder)
         return -1;
     }
 
-    mDecoderOutputBufferQueue = decoder->addOutputQueue();
+    /* Live low latency: only the latest frame is kept */
+    unsigned int queueDepth = NULL_RENDERER_QUEUE_MAX_DEPTH;
+    if ((mSession) && (mSession->isLiveLowLatency()))
+    {
+        queueDepth = 1;
+    }
+    mDecoderOutputBufferQueue = decoder->addOutputQueue(queueDepth, BUFFER_QUEUE_OVERFLOW_DROP_OLDEST);
     if (mDecoderOutputBufferQueue == NULL)
     {
         ULOGE("NullRenderer: failed to add output queue to decoder");
         return -1;
     }
 
+    pthread_mutex_lock(&mMutex);
     mDecoder = decoder;
     mMedia = mDecoder->getMedia();
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
 
     return 0;
 }
@@ -146,8 +182,11 @@ int NullRenderer::removeAvcDecoder(AvcDecoder *decoder)
         }
     }
 
+    pthread_mutex_lock(&mMutex);
     mDecoder = NULL;
     mDecoderOutputBufferQueue = NULL;
+    pdraw_latencyStatsLog(&mLatencyStats, "NullRenderer");
+    pthread_mutex_unlock(&mMutex);
 
     return 0;
 }
@@ -177,7 +216,25 @@ void* NullRenderer::runRendererThread(void *ptr)
 
     while (!renderer->mThreadShouldStop)
     {
-        if ((renderer->mDecoder) && (renderer->mDecoder->isConfigured()))
+        /* Wait for a decoder */
+        pthread_mutex_lock(&renderer->mMutex);
+        while ((!renderer->mThreadShouldStop) && (!renderer->mDecoder))
+        {
+            pthread_cond_wait(&renderer->mCond, &renderer->mMutex);
+        }
+        pthread_mutex_unlock(&renderer->mMutex);
+
+        if (renderer->mThreadShouldStop)
+        {
+            break;
+        }
+
+        if (!renderer->mDecoder->isConfigured())
+        {
+            /* Wait for the first frame; the decoder output starts once configured */
+            renderer->mDecoderOutputBufferQueue->peekBuffer(true);
+        }
+        else
         {
             Buffer *buffer;
 
@@ -185,7 +242,6 @@ void* NullRenderer::runRendererThread(void *ptr)
             if (ret != 0)
             {
                 //ULOGE("NullRenderer: failed to get buffer from queue (%d)", ret);
-                usleep(5000); //TODO
             }
             else
             {
@@ -199,6 +255,17 @@ void* NullRenderer::runRendererThread(void *ptr)
                       (float)(renderTimestamp - data->decoderOutputTimestamp) / 1000.,
                       (data->auNtpTimestampLocal != 0) ? (float)(renderTimestamp - data->auNtpTimestampLocal) / 1000. : 0.);
 
+                if ((data->auNtpTimestampLocal != 0) && (renderTimestamp > data->auNtpTimestampLocal))
+                {
+                    pthread_mutex_lock(&renderer->mMutex);
+                    pdraw_latencyStatsAdd(&renderer->mLatencyStats, renderTimestamp - data->auNtpTimestampLocal);
+                    if (renderer->mLatencyStats.count >= NULL_RENDERER_LATENCY_LOG_INTERVAL)
+                    {
+                        pdraw_latencyStatsLog(&renderer->mLatencyStats, "NullRenderer");
+                    }
+                    pthread_mutex_unlock(&renderer->mMutex);
+                }
+
                 ret = renderer->mDecoder->releaseOutputBuffer(buffer);
                 if (ret != 0)
                 {
@@ -206,10 +273,6 @@ void* NullRenderer::runRendererThread(void *ptr)
                 }
             }
         }
-        else
-        {
-            usleep(5000); //TODO
-        }
     }
 
     return NULL;
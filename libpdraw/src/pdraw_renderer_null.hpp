@@ -42,6 +42,11 @@
 #include <pthread.h>
 
 #include "pdraw_renderer.hpp"
+#include "pdraw_utils.hpp"
+
+
+#define NULL_RENDERER_QUEUE_MAX_DEPTH 2
+#define NULL_RENDERER_LATENCY_LOG_INTERVAL 300 /* frames */
 
 
 namespace Pdraw
@@ -84,6 +89,9 @@ private:
     pthread_t mRendererThread;
     bool mRendererThreadLaunched;
     bool mThreadShouldStop;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+    pdraw_latency_stats_t mLatencyStats;
 };
 
 }
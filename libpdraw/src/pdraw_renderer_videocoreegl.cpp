@@ -118,7 +118,7 @@ int VideoCoreEglRenderer::setRendererParams
     mSurface = uiParams->surface;
     mContext = uiParams->context;
 
-    if (mDecoder) ((VideoCoreOmxAvcDecoder*)mDecoder)->setRenderer(this);
+    if (mDecoder) ((VideoCoreOmxAvcDecoder*)mDecoder->getBackend())->setRenderer(this);
 
     if (ret > 0)
         mRunning = true;
@@ -0,0 +1,448 @@
+/**
+ * @file pdraw_scale.cpp
+ * @brief Parrot Drones Awesome Video Viewer Library - frame scaling
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PDRAW_SCALE_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PDRAW_SCALE_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pdraw_scale.hpp"
+#include "pdraw_copy.hpp"
+
+#define ULOG_TAG libpdraw
+#include <ulog.h>
+
+
+/* Maximum number of 8-bit rows summed in the 16-bit accumulators */
+#define PDRAW_SCALE_ACC16_MAX_ROWS (65535 / 255)
+
+
+typedef struct
+{
+    void (*box2Row)(uint8_t *dst, const uint8_t *src0, const uint8_t *src1, unsigned int width);
+    void (*accumulateRow)(uint16_t *acc, const uint8_t *src, unsigned int len);
+
+} pdraw_scale_impl_t;
+
+
+static pthread_once_t pdraw_scaleOnce = PTHREAD_ONCE_INIT;
+static pdraw_scale_impl_t pdraw_scaleImpl;
+
+
+/* 2x2 box: rounded vertical average then rounded horizontal average;
+ * the SIMD kernels give the same results */
+static void pdraw_scaleBox2RowC(uint8_t *dst, const uint8_t *src0,
+    const uint8_t *src1, unsigned int width)
+{
+    unsigned int x;
+    for (x = 0; x < width; x++)
+    {
+        unsigned int a = (src0[2 * x] + src1[2 * x] + 1) >> 1;
+        unsigned int b = (src0[2 * x + 1] + src1[2 * x + 1] + 1) >> 1;
+        dst[x] = (a + b + 1) >> 1;
+    }
+}
+
+
+static void pdraw_scaleAccumulateRowC(uint16_t *acc, const uint8_t *src, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i < len; i++)
+    {
+        acc[i] += src[i];
+    }
+}
+
+
+static void pdraw_scaleAccumulateRow32C(uint32_t *acc, const uint8_t *src, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i < len; i++)
+    {
+        acc[i] += src[i];
+    }
+}
+
+
+#ifdef PDRAW_SCALE_X86
+
+__attribute__((target("sse2")))
+static void pdraw_scaleBox2RowSse2(uint8_t *dst, const uint8_t *src0,
+    const uint8_t *src1, unsigned int width)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i one = _mm_set1_epi16(1);
+    unsigned int x;
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i v0 = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(src0 + 2 * x)),
+                                  _mm_loadu_si128((const __m128i*)(src1 + 2 * x)));
+        __m128i v1 = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(src0 + 2 * x + 16)),
+                                  _mm_loadu_si128((const __m128i*)(src1 + 2 * x + 16)));
+        __m128i h0 = _mm_add_epi16(_mm_and_si128(v0, mask), _mm_srli_epi16(v0, 8));
+        __m128i h1 = _mm_add_epi16(_mm_and_si128(v1, mask), _mm_srli_epi16(v1, 8));
+        h0 = _mm_srli_epi16(_mm_add_epi16(h0, one), 1);
+        h1 = _mm_srli_epi16(_mm_add_epi16(h1, one), 1);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(h0, h1));
+    }
+    pdraw_scaleBox2RowC(dst + x, src0 + 2 * x, src1 + 2 * x, width - x);
+}
+
+
+__attribute__((target("sse2")))
+static void pdraw_scaleAccumulateRowSse2(uint16_t *acc, const uint8_t *src, unsigned int len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(acc + i + 8));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_add_epi16(a0, _mm_unpacklo_epi8(s, zero)));
+        _mm_storeu_si128((__m128i*)(acc + i + 8), _mm_add_epi16(a1, _mm_unpackhi_epi8(s, zero)));
+    }
+    pdraw_scaleAccumulateRowC(acc + i, src + i, len - i);
+}
+
+#endif /* PDRAW_SCALE_X86 */
+
+
+#ifdef PDRAW_SCALE_NEON
+
+static void pdraw_scaleBox2RowNeon(uint8_t *dst, const uint8_t *src0,
+    const uint8_t *src1, unsigned int width)
+{
+    unsigned int x;
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        uint8x16_t v0 = vrhaddq_u8(vld1q_u8(src0 + 2 * x), vld1q_u8(src1 + 2 * x));
+        uint8x16_t v1 = vrhaddq_u8(vld1q_u8(src0 + 2 * x + 16), vld1q_u8(src1 + 2 * x + 16));
+        vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(vpaddlq_u8(v0), 1),
+                                      vrshrn_n_u16(vpaddlq_u8(v1), 1)));
+    }
+    pdraw_scaleBox2RowC(dst + x, src0 + 2 * x, src1 + 2 * x, width - x);
+}
+
+
+static void pdraw_scaleAccumulateRowNeon(uint16_t *acc, const uint8_t *src, unsigned int len)
+{
+    unsigned int i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        uint8x16_t s = vld1q_u8(src + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(s)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(s)));
+    }
+    pdraw_scaleAccumulateRowC(acc + i, src + i, len - i);
+}
+
+#endif /* PDRAW_SCALE_NEON */
+
+
+static void pdraw_scaleInit(void)
+{
+    pdraw_scaleImpl.box2Row = pdraw_scaleBox2RowC;
+    pdraw_scaleImpl.accumulateRow = pdraw_scaleAccumulateRowC;
+
+#if defined(PDRAW_SCALE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        pdraw_scaleImpl.box2Row = pdraw_scaleBox2RowSse2;
+        pdraw_scaleImpl.accumulateRow = pdraw_scaleAccumulateRowSse2;
+    }
+#elif defined(PDRAW_SCALE_NEON)
+    pdraw_scaleImpl.box2Row = pdraw_scaleBox2RowNeon;
+    pdraw_scaleImpl.accumulateRow = pdraw_scaleAccumulateRowNeon;
+#endif
+}
+
+
+static void pdraw_scalePlaneBox(uint8_t *dst, unsigned int dstStride,
+    unsigned int dstWidth, unsigned int dstHeight,
+    const uint8_t *src, unsigned int srcStride,
+    unsigned int kx, unsigned int ky, unsigned int step)
+{
+    unsigned int y;
+
+    pthread_once(&pdraw_scaleOnce, pdraw_scaleInit);
+
+    if ((kx == 2) && (ky == 2) && (step == 1))
+    {
+        for (y = 0; y < dstHeight; y++)
+        {
+            pdraw_scaleImpl.box2Row(dst, src, src + srcStride, dstWidth);
+            src += 2 * srcStride;
+            dst += dstStride;
+        }
+        return;
+    }
+
+    /* The rows are summed first, then the columns; the 16-bit (SIMD)
+     * accumulators would overflow on taller boxes, 32-bit ones are used
+     * instead; the division is a 32-bit fixed point multiplication,
+     * which gives the rounded quotient for all the possible sums */
+    unsigned int n = kx * ky;
+    uint64_t recip = (((uint64_t)1 << 32) + n / 2) / n;
+    unsigned int len = dstWidth * kx * step;
+    bool acc32 = (ky > PDRAW_SCALE_ACC16_MAX_ROWS);
+    std::vector<uint16_t> acc((acc32) ? 0 : len);
+    std::vector<uint32_t> accWide((acc32) ? len : 0);
+    for (y = 0; y < dstHeight; y++)
+    {
+        const uint8_t *s = src + y * ky * srcStride;
+        uint8_t *d = dst + y * dstStride;
+        unsigned int x, c, i, j, o = 0;
+        if (acc32)
+        {
+            memset(&accWide[0], 0, len * sizeof(uint32_t));
+            for (j = 0; j < ky; j++)
+            {
+                pdraw_scaleAccumulateRow32C(&accWide[0], s + j * srcStride, len);
+            }
+        }
+        else
+        {
+            memset(&acc[0], 0, len * sizeof(uint16_t));
+            for (j = 0; j < ky; j++)
+            {
+                pdraw_scaleImpl.accumulateRow(&acc[0], s + j * srcStride, len);
+            }
+        }
+        for (x = 0; x < dstWidth; x++)
+        {
+            for (c = 0; c < step; c++)
+            {
+                uint64_t sum = 0;
+                for (i = 0; i < kx; i++)
+                {
+                    sum += (acc32) ? accWide[o + i * step + c] : acc[o + i * step + c];
+                }
+                *d++ = (sum * recip + ((uint64_t)1 << 31)) >> 32;
+            }
+            o += kx * step;
+        }
+    }
+}
+
+
+static void pdraw_scalePlaneBilinear(uint8_t *dst, unsigned int dstStride,
+    unsigned int dstWidth, unsigned int dstHeight,
+    const uint8_t *src, unsigned int srcStride,
+    unsigned int srcWidth, unsigned int srcHeight, unsigned int step)
+{
+    /* Source positions of the pixel centers, with 8-bit weights */
+    std::vector<unsigned int> x0(dstWidth), x1(dstWidth), fx(dstWidth);
+    unsigned int x, y, c;
+    for (x = 0; x < dstWidth; x++)
+    {
+        int64_t pos = (((int64_t)(2 * x + 1) * srcWidth) << 15) / dstWidth - 32768;
+        if (pos < 0)
+            pos = 0;
+        x0[x] = pos >> 16;
+        x1[x] = (x0[x] + 1 < srcWidth) ? x0[x] + 1 : x0[x];
+        fx[x] = (pos >> 8) & 0xFF;
+        x0[x] *= step;
+        x1[x] *= step;
+    }
+
+    for (y = 0; y < dstHeight; y++)
+    {
+        int64_t pos = (((int64_t)(2 * y + 1) * srcHeight) << 15) / dstHeight - 32768;
+        if (pos < 0)
+            pos = 0;
+        unsigned int y0 = pos >> 16;
+        unsigned int y1 = (y0 + 1 < srcHeight) ? y0 + 1 : y0;
+        unsigned int fy = (pos >> 8) & 0xFF;
+        const uint8_t *s0 = src + y0 * srcStride;
+        const uint8_t *s1 = src + y1 * srcStride;
+        uint8_t *d = dst + y * dstStride;
+        for (x = 0; x < dstWidth; x++)
+        {
+            for (c = 0; c < step; c++)
+            {
+                unsigned int top = s0[x0[x] + c] * (256 - fx[x]) + s0[x1[x] + c] * fx[x];
+                unsigned int bottom = s1[x0[x] + c] * (256 - fx[x]) + s1[x1[x] + c] * fx[x];
+                d[x * step + c] = (top * (256 - fy) + bottom * fy + 32768) >> 16;
+            }
+        }
+    }
+}
+
+
+static void pdraw_scalePlane(uint8_t *dst, unsigned int dstStride,
+    unsigned int dstWidth, unsigned int dstHeight,
+    const uint8_t *src, unsigned int srcStride,
+    unsigned int srcWidth, unsigned int srcHeight, unsigned int step)
+{
+    if ((srcWidth == dstWidth) && (srcHeight == dstHeight))
+    {
+        pdraw_copyPlane(dst, dstStride, src, srcStride, dstWidth * step, dstHeight);
+    }
+    else if ((srcWidth % dstWidth == 0) && (srcHeight % dstHeight == 0))
+    {
+        pdraw_scalePlaneBox(dst, dstStride, dstWidth, dstHeight, src, srcStride,
+                            srcWidth / dstWidth, srcHeight / dstHeight, step);
+    }
+    else
+    {
+        pdraw_scalePlaneBilinear(dst, dstStride, dstWidth, dstHeight, src, srcStride,
+                                 srcWidth, srcHeight, step);
+    }
+}
+
+
+static void pdraw_scaleGetRoi(const pdraw_video_frame_t *src, const pdraw_rect_t *roi,
+    pdraw_rect_t *rect)
+{
+    if ((roi) && (roi->width) && (roi->height))
+    {
+        rect->x = (roi->x < src->width) ? roi->x & ~1 : 0;
+        rect->y = (roi->y < src->height) ? roi->y & ~1 : 0;
+        rect->width = (rect->x + roi->width <= src->width) ? roi->width : src->width - rect->x;
+        rect->height = (rect->y + roi->height <= src->height) ? roi->height : src->height - rect->y;
+    }
+    else
+    {
+        rect->x = 0;
+        rect->y = 0;
+        rect->width = src->width;
+        rect->height = src->height;
+    }
+    rect->width &= ~1;
+    rect->height &= ~1;
+}
+
+
+void pdraw_scaleGetDimensions(const pdraw_video_frame_t *src, const pdraw_rect_t *roi,
+    unsigned int dstWidth, unsigned int dstHeight,
+    unsigned int *width, unsigned int *height)
+{
+    pdraw_rect_t rect;
+    pdraw_scaleGetRoi(src, roi, &rect);
+
+    *width = ((dstWidth) ? dstWidth : rect.width) & ~1;
+    *height = ((dstHeight) ? dstHeight : rect.height) & ~1;
+}
+
+
+int pdraw_scaleFrame(const pdraw_video_frame_t *src, const pdraw_rect_t *roi,
+    unsigned int dstWidth, unsigned int dstHeight,
+    pdraw_video_frame_t *dst, uint8_t *dstBuf)
+{
+    if ((!src) || (!dst) || (!dstBuf))
+    {
+        ULOGE("scale: invalid pointer");
+        return -1;
+    }
+    if ((src->colorFormat != PDRAW_COLOR_FORMAT_YUV420PLANAR)
+            && (src->colorFormat != PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR))
+    {
+        ULOGE("scale: unsupported format (%d)", src->colorFormat);
+        return -1;
+    }
+
+    pdraw_rect_t rect;
+    unsigned int width, height;
+    pdraw_scaleGetRoi(src, roi, &rect);
+    pdraw_scaleGetDimensions(src, roi, dstWidth, dstHeight, &width, &height);
+    if ((rect.width == 0) || (rect.height == 0) || (width == 0) || (height == 0))
+    {
+        ULOGE("scale: invalid dimensions");
+        return -1;
+    }
+
+    memcpy(dst, src, sizeof(*dst));
+    dst->width = width;
+    dst->height = height;
+    if ((src->sarWidth) && (src->sarHeight))
+    {
+        /* Keep the display aspect ratio of the region of interest */
+        uint64_t sarWidth = (uint64_t)src->sarWidth * rect.width * height;
+        uint64_t sarHeight = (uint64_t)src->sarHeight * rect.height * width;
+        uint64_t a = sarWidth, b = sarHeight;
+        while (b)
+        {
+            uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+        dst->sarWidth = sarWidth / a;
+        dst->sarHeight = sarHeight / a;
+    }
+
+    dst->plane[0] = dstBuf;
+    dst->stride[0] = width;
+    pdraw_scalePlane(dst->plane[0], dst->stride[0], width, height,
+                     src->plane[0] + rect.y * src->stride[0] + rect.x, src->stride[0],
+                     rect.width, rect.height, 1);
+
+    if (src->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR)
+    {
+        unsigned int i;
+        dst->plane[1] = dstBuf + width * height;
+        dst->plane[2] = dstBuf + width * height * 5 / 4;
+        for (i = 1; i < 3; i++)
+        {
+            dst->stride[i] = width / 2;
+            pdraw_scalePlane(dst->plane[i], dst->stride[i], width / 2, height / 2,
+                             src->plane[i] + rect.y / 2 * src->stride[i] + rect.x / 2, src->stride[i],
+                             rect.width / 2, rect.height / 2, 1);
+        }
+    }
+    else
+    {
+        dst->plane[1] = dstBuf + width * height;
+        dst->plane[2] = NULL;
+        dst->stride[1] = width;
+        dst->stride[2] = 0;
+        pdraw_scalePlane(dst->plane[1], dst->stride[1], width / 2, height / 2,
+                         src->plane[1] + rect.y / 2 * src->stride[1] + rect.x, src->stride[1],
+                         rect.width / 2, rect.height / 2, 2);
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file pdraw_scale.hpp
+ * @brief Parrot Drones Awesome Video Viewer Library - frame scaling
+ * @date 16/10/2026
+ * @author aurelien.barre@akaaba.net
+ *
+ * Copyright (c) 2016 Aurelien Barre <aurelien.barre@akaaba.net>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ * 
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ * 
+ *   * Neither the name of the copyright holder nor the names of the
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_SCALE_HPP_
+#define _PDRAW_SCALE_HPP_
+
+#include <inttypes.h>
+
+#include <pdraw/pdraw_defs.h>
+
+
+/*
+ * Crop (roi, NULL for the full frame) and scale a YUV 4:2:0 frame into
+ * dstBuf as a compact frame of the same format; 0 dimensions keep the
+ * region of interest size. Exact integer downscaling factors use a box
+ * filter, other factors a bilinear filter. The region of interest is
+ * clipped to the frame and aligned on the chroma sampling.
+ */
+int pdraw_scaleFrame(const pdraw_video_frame_t *src, const pdraw_rect_t *roi,
+    unsigned int dstWidth, unsigned int dstHeight,
+    pdraw_video_frame_t *dst, uint8_t *dstBuf);
+
+
+/* Output dimensions of pdraw_scaleFrame() */
+void pdraw_scaleGetDimensions(const pdraw_video_frame_t *src, const pdraw_rect_t *roi,
+    unsigned int dstWidth, unsigned int dstHeight,
+    unsigned int *width, unsigned int *height);
+
+#endif /* !_PDRAW_SCALE_HPP_ */
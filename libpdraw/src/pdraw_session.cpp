@@ -41,6 +41,7 @@
 #include <algorithm>
 
 #include "pdraw_session.hpp"
+#include "pdraw_settings.hpp"
 #include "pdraw_media_video.hpp"
 #include "pdraw_demuxer_stream.hpp"
 #include "pdraw_demuxer_record.hpp"
@@ -496,6 +497,18 @@ int Session::disableRenderer()
 }
 
 
+bool Session::isLiveLowLatency()
+{
+    pdraw_stream_profile_t profile = SETTINGS_STREAM_PROFILE;
+    if (mSettings)
+    {
+        mSettings->getStreamProfileSettings(&profile);
+    }
+
+    return ((mSessionType == PDRAW_SESSION_TYPE_STREAM) && (profile == PDRAW_STREAM_PROFILE_LIVE_LOW_LATENCY));
+}
+
+
 uint64_t Session::getDuration()
 {
     return (mDemuxer) ? mDemuxer->getDuration() : 0;
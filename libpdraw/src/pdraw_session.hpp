@@ -111,6 +111,8 @@ public:
 
     session_type_t getSessionType() { return mSessionType; };
 
+    bool isLiveLowLatency();
+
     SessionSelfMetadata *getSelfMetadata() { return &mSelfMetadata; };
 
     SessionPeerMetadata *getPeerMetadata() { return &mPeerMetadata; };
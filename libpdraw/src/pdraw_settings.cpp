@@ -54,6 +54,18 @@ Settings::Settings()
     mHmdScale = SETTINGS_HMD_SCALE;
     mHmdPanH = SETTINGS_HMD_PAN_H;
     mHmdPanV = SETTINGS_HMD_PAN_V;
+    mDecoderThreadCount = SETTINGS_DECODER_THREAD_COUNT;
+    mDecoderThreadType = SETTINGS_DECODER_THREAD_TYPE;
+    mRecordIndexEnabled = SETTINGS_RECORD_INDEX_ENABLED;
+    mRecordIndexPersistent = SETTINGS_RECORD_INDEX_PERSISTENT;
+    mReversePlaybackCacheMaxSize = SETTINGS_REVERSE_PLAYBACK_CACHE_MAX_SIZE;
+    mDecoderFramePoolMaxSize = SETTINGS_DECODER_FRAME_POOL_MAX_SIZE;
+    mDecoderOverloadEnabled = SETTINGS_DECODER_OVERLOAD_ENABLED;
+    mDecoderOverloadMaxQueueDepth = SETTINGS_DECODER_OVERLOAD_MAX_QUEUE_DEPTH;
+    mDecoderOverloadMaxAuAge = SETTINGS_DECODER_OVERLOAD_MAX_AU_AGE;
+    mStreamProfile = SETTINGS_STREAM_PROFILE;
+    mDecoderPoolShared = SETTINGS_DECODER_POOL_SHARED;
+    mDecoderBackend = SETTINGS_DECODER_BACKEND;
 }
 
 
@@ -106,4 +118,120 @@ void Settings::setHmdDistorsionCorrectionSettings(pdraw_hmd_model_t hmdModel, fl
     mHmdPanV = panV;
 }
 
+
+void Settings::getDecoderThreadingSettings(unsigned int *threadCount, pdraw_decoder_thread_type_t *threadType)
+{
+    if (threadCount)
+        *threadCount = mDecoderThreadCount;
+    if (threadType)
+        *threadType = mDecoderThreadType;
+}
+
+
+void Settings::setDecoderThreadingSettings(unsigned int threadCount, pdraw_decoder_thread_type_t threadType)
+{
+    mDecoderThreadCount = threadCount;
+    mDecoderThreadType = threadType;
+}
+
+
+void Settings::getRecordIndexSettings(bool *enabled, bool *persistent)
+{
+    if (enabled)
+        *enabled = mRecordIndexEnabled;
+    if (persistent)
+        *persistent = mRecordIndexPersistent;
+}
+
+
+void Settings::setRecordIndexSettings(bool enabled, bool persistent)
+{
+    mRecordIndexEnabled = enabled;
+    mRecordIndexPersistent = persistent;
+}
+
+
+void Settings::getReversePlaybackSettings(unsigned int *cacheMaxSize)
+{
+    if (cacheMaxSize)
+        *cacheMaxSize = mReversePlaybackCacheMaxSize;
+}
+
+
+void Settings::setReversePlaybackSettings(unsigned int cacheMaxSize)
+{
+    mReversePlaybackCacheMaxSize = cacheMaxSize;
+}
+
+
+void Settings::getDecoderFramePoolSettings(unsigned int *maxSize)
+{
+    if (maxSize)
+        *maxSize = mDecoderFramePoolMaxSize;
+}
+
+
+void Settings::setDecoderFramePoolSettings(unsigned int maxSize)
+{
+    mDecoderFramePoolMaxSize = maxSize;
+}
+
+
+void Settings::getDecoderOverloadSettings(bool *enabled, unsigned int *maxQueueDepth, unsigned int *maxAuAge)
+{
+    if (enabled)
+        *enabled = mDecoderOverloadEnabled;
+    if (maxQueueDepth)
+        *maxQueueDepth = mDecoderOverloadMaxQueueDepth;
+    if (maxAuAge)
+        *maxAuAge = mDecoderOverloadMaxAuAge;
+}
+
+
+void Settings::setDecoderOverloadSettings(bool enabled, unsigned int maxQueueDepth, unsigned int maxAuAge)
+{
+    mDecoderOverloadEnabled = enabled;
+    mDecoderOverloadMaxQueueDepth = maxQueueDepth;
+    mDecoderOverloadMaxAuAge = maxAuAge;
+}
+
+
+void Settings::getStreamProfileSettings(pdraw_stream_profile_t *profile)
+{
+    if (profile)
+        *profile = mStreamProfile;
+}
+
+
+void Settings::setStreamProfileSettings(pdraw_stream_profile_t profile)
+{
+    mStreamProfile = profile;
+}
+
+
+void Settings::getDecoderPoolSettings(bool *shared)
+{
+    if (shared)
+        *shared = mDecoderPoolShared;
+}
+
+
+void Settings::setDecoderPoolSettings(bool shared)
+{
+    mDecoderPoolShared = shared;
+}
+
+
+void Settings::getDecoderBackendSettings(std::string *name)
+{
+    if (name)
+        *name = mDecoderBackend;
+}
+
+
+void Settings::setDecoderBackendSettings(const std::string &name)
+{
+    mDecoderBackend = name;
+}
+
 }
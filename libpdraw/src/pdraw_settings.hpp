@@ -41,6 +41,7 @@
 
 #include <inttypes.h>
 #include <math.h>
+#include <string>
 #include <pdraw/pdraw_defs.h>
 
 
@@ -52,6 +53,18 @@
 #define SETTINGS_HMD_SCALE                      (0.75f)
 #define SETTINGS_HMD_PAN_H                      (0.0f)
 #define SETTINGS_HMD_PAN_V                      (0.0f)
+#define SETTINGS_DECODER_THREAD_COUNT           (1)
+#define SETTINGS_DECODER_THREAD_TYPE            (PDRAW_DECODER_THREAD_TYPE_NONE)
+#define SETTINGS_RECORD_INDEX_ENABLED           (false)
+#define SETTINGS_RECORD_INDEX_PERSISTENT        (false)
+#define SETTINGS_REVERSE_PLAYBACK_CACHE_MAX_SIZE (64 * 1024 * 1024)
+#define SETTINGS_DECODER_FRAME_POOL_MAX_SIZE    (192 * 1024 * 1024)
+#define SETTINGS_DECODER_OVERLOAD_ENABLED       (true)
+#define SETTINGS_DECODER_OVERLOAD_MAX_QUEUE_DEPTH (3)
+#define SETTINGS_DECODER_OVERLOAD_MAX_AU_AGE    (100000)
+#define SETTINGS_STREAM_PROFILE                 (PDRAW_STREAM_PROFILE_DEFAULT)
+#define SETTINGS_DECODER_POOL_SHARED            (false)
+#define SETTINGS_DECODER_BACKEND                ("")
 
 
 namespace Pdraw
@@ -75,6 +88,30 @@ public:
     void getHmdDistorsionCorrectionSettings(pdraw_hmd_model_t *hmdModel, float *ipd, float *scale, float *panH, float *panV);
     void setHmdDistorsionCorrectionSettings(pdraw_hmd_model_t hmdModel, float ipd, float scale, float panH, float panV);
 
+    void getDecoderThreadingSettings(unsigned int *threadCount, pdraw_decoder_thread_type_t *threadType);
+    void setDecoderThreadingSettings(unsigned int threadCount, pdraw_decoder_thread_type_t threadType);
+
+    void getRecordIndexSettings(bool *enabled, bool *persistent);
+    void setRecordIndexSettings(bool enabled, bool persistent);
+
+    void getReversePlaybackSettings(unsigned int *cacheMaxSize);
+    void setReversePlaybackSettings(unsigned int cacheMaxSize);
+
+    void getDecoderFramePoolSettings(unsigned int *maxSize);
+    void setDecoderFramePoolSettings(unsigned int maxSize);
+
+    void getDecoderOverloadSettings(bool *enabled, unsigned int *maxQueueDepth, unsigned int *maxAuAge);
+    void setDecoderOverloadSettings(bool enabled, unsigned int maxQueueDepth, unsigned int maxAuAge);
+
+    void getStreamProfileSettings(pdraw_stream_profile_t *profile);
+    void setStreamProfileSettings(pdraw_stream_profile_t profile);
+
+    void getDecoderPoolSettings(bool *shared);
+    void setDecoderPoolSettings(bool shared);
+
+    void getDecoderBackendSettings(std::string *name);
+    void setDecoderBackendSettings(const std::string &name);
+
 private:
 
     float mControllerRadarAngle;
@@ -86,6 +123,18 @@ private:
     float mHmdScale;
     float mHmdPanH;
     float mHmdPanV;
+    unsigned int mDecoderThreadCount;
+    pdraw_decoder_thread_type_t mDecoderThreadType;
+    bool mRecordIndexEnabled;
+    bool mRecordIndexPersistent;
+    unsigned int mReversePlaybackCacheMaxSize;
+    unsigned int mDecoderFramePoolMaxSize;
+    bool mDecoderOverloadEnabled;
+    unsigned int mDecoderOverloadMaxQueueDepth;
+    unsigned int mDecoderOverloadMaxAuAge;
+    pdraw_stream_profile_t mStreamProfile;
+    bool mDecoderPoolShared;
+    std::string mDecoderBackend;
 };
 
 }
@@ -70,6 +70,30 @@ static const unsigned int pdraw_h264Sar[17][2] =
 };
 
 
+/* H.264 level limits (ITU-T H.264 table A-1): level_idc (9 is level 1b),
+ * MaxDpbMbs, MaxCPB (in 1000 bits), MinCR */
+static const unsigned int pdraw_h264Levels[17][4] =
+{
+    { 9, 396, 350, 2 },
+    { 10, 396, 175, 2 },
+    { 11, 900, 500, 2 },
+    { 12, 2376, 1000, 2 },
+    { 13, 2376, 2000, 2 },
+    { 20, 2376, 2000, 2 },
+    { 21, 4752, 4000, 2 },
+    { 22, 8100, 4000, 2 },
+    { 30, 8100, 10000, 2 },
+    { 31, 18000, 14000, 4 },
+    { 32, 20480, 20000, 4 },
+    { 40, 32768, 25000, 4 },
+    { 41, 32768, 62500, 2 },
+    { 42, 34816, 62500, 2 },
+    { 50, 110400, 135000, 2 },
+    { 51, 184320, 240000, 2 },
+    { 52, 184320, 240000, 2 },
+};
+
+
 void pdraw_quat_conj(const quaternion_t *qSrc, quaternion_t *qDst)
 {
     if ((!qSrc) || (!qDst))
@@ -295,3 +319,145 @@ int pdraw_videoDimensionsFromH264Sps(uint8_t *pSps, unsigned int spsSize,
 
     return 0;
 }
+
+
+int pdraw_bufferRequirementsFromH264Sps(const uint8_t *pSps, unsigned int spsSize,
+    unsigned int *maxAuSize, unsigned int *reorderDepth)
+{
+    /* Skip the start code if any */
+    if ((spsSize > 4) && (pSps[0] == 0) && (pSps[1] == 0) && (pSps[2] == 0) && (pSps[3] == 1))
+    {
+        pSps += 4;
+        spsSize -= 4;
+    }
+
+    struct h264_sps sps;
+    int ret = h264_parse_sps(pSps, spsSize, &sps);
+    if (ret != 0)
+    {
+        ULOGE("Utils: h264_parse_sps() failed: %d(%s)", ret, strerror(-ret));
+        return -1;
+    }
+
+    struct h264_sps_derived sps_derived;
+    ret = h264_get_sps_derived(&sps, &sps_derived);
+    if (ret != 0)
+    {
+        ULOGE("Utils: h264_get_sps_derived() failed: %d(%s)", ret, strerror(-ret));
+        return -1;
+    }
+
+    /* Level limits; the highest level is used for unknown levels */
+    unsigned int levelIdc = ((sps.level_idc == 11) && (sps.constraint_set3_flag) &&
+                             ((sps.profile_idc == 66) || (sps.profile_idc == 77))) ? 9 : sps.level_idc;
+    unsigned int level = 16, i;
+    for (i = 0; i < 17; i++)
+    {
+        if (pdraw_h264Levels[i][0] == levelIdc)
+        {
+            level = i;
+            break;
+        }
+    }
+    unsigned int maxDpbMbs = pdraw_h264Levels[level][1];
+    unsigned int maxCpb = pdraw_h264Levels[level][2];
+    unsigned int minCr = pdraw_h264Levels[level][3];
+
+    /* CPB size factor of the high profiles (table A-2) */
+    unsigned int cpbFactor = 1000;
+    if (sps.profile_idc == 100)
+        cpbFactor = 1250;
+    else if (sps.profile_idc == 110)
+        cpbFactor = 3000;
+    else if ((sps.profile_idc == 122) || (sps.profile_idc == 244) || (sps.profile_idc == 44))
+        cpbFactor = 4000;
+
+    /* Access unit size: bounded by the minimum compression ratio of the
+     * level, the CPB size and the VUI max_bytes_per_pic_denom if present;
+     * 384 bytes is the raw size of an 8-bit 4:2:0 macroblock; a margin is
+     * added for the parameter sets and SEI */
+    uint64_t picSizeInMbs = (uint64_t)sps_derived.PicWidthInMbs * sps_derived.FrameHeightInMbs;
+    uint64_t _maxAuSize = picSizeInMbs * 384 / minCr;
+    uint64_t cpbSize = (uint64_t)maxCpb * cpbFactor / 8;
+    if (cpbSize < _maxAuSize)
+        _maxAuSize = cpbSize;
+    if ((sps.vui_parameters_present_flag) && (sps.vui.bitstream_restriction_flag) &&
+        (sps.vui.max_bytes_per_pic_denom > 0))
+    {
+        uint64_t picSize = picSizeInMbs * 384 / sps.vui.max_bytes_per_pic_denom;
+        if (picSize < _maxAuSize)
+            _maxAuSize = picSize;
+    }
+    _maxAuSize += 4096;
+
+    /* Reordering depth: from the VUI if present, none for the baseline
+     * profile, otherwise the DPB size of the level */
+    unsigned int _reorderDepth;
+    if ((sps.vui_parameters_present_flag) && (sps.vui.bitstream_restriction_flag))
+    {
+        _reorderDepth = sps.vui.max_num_reorder_frames;
+    }
+    else if (sps.profile_idc == 66)
+    {
+        _reorderDepth = 0;
+    }
+    else
+    {
+        _reorderDepth = (picSizeInMbs > 0) ? maxDpbMbs / picSizeInMbs : 16;
+    }
+    if (_reorderDepth > 16)
+        _reorderDepth = 16;
+
+    if (maxAuSize)
+        *maxAuSize = (unsigned int)_maxAuSize;
+    if (reorderDepth)
+        *reorderDepth = _reorderDepth;
+
+    return 0;
+}
+
+
+void pdraw_latencyStatsAdd(pdraw_latency_stats_t *stats, uint64_t latency)
+{
+    unsigned int bucket = latency / 1000;
+    if (bucket >= PDRAW_LATENCY_STATS_BUCKET_COUNT)
+        bucket = PDRAW_LATENCY_STATS_BUCKET_COUNT - 1;
+
+    if ((stats->count == 0) || (latency < stats->min))
+        stats->min = latency;
+    if (latency > stats->max)
+        stats->max = latency;
+    stats->total += latency;
+    stats->buckets[bucket]++;
+    stats->count++;
+}
+
+
+static float pdraw_latencyStatsPercentile(const pdraw_latency_stats_t *stats, unsigned int percent)
+{
+    unsigned int target = (stats->count * percent + 99) / 100, sum = 0, i;
+
+    for (i = 0; i < PDRAW_LATENCY_STATS_BUCKET_COUNT; i++)
+    {
+        sum += stats->buckets[i];
+        if (sum >= target)
+            break;
+    }
+
+    return (float)i + 0.5;
+}
+
+
+void pdraw_latencyStatsLog(pdraw_latency_stats_t *stats, const char *prefix)
+{
+    /* The statistics are reset once logged */
+    if (stats->count > 0)
+    {
+        ULOGI("%s: glass-to-glass latency over %d frames: avg %.2fms min %.2fms max %.2fms p50 %.1fms p95 %.1fms p99 %.1fms",
+              prefix, stats->count, (float)stats->total / stats->count / 1000.,
+              (float)stats->min / 1000., (float)stats->max / 1000.,
+              pdraw_latencyStatsPercentile(stats, 50), pdraw_latencyStatsPercentile(stats, 95),
+              pdraw_latencyStatsPercentile(stats, 99));
+    }
+    memset(stats, 0, sizeof(*stats));
+}
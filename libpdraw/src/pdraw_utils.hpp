@@ -49,6 +49,19 @@
 #define euler_t pdraw_euler_t
 #define speed_t pdraw_speed_t
 
+#define PDRAW_LATENCY_STATS_BUCKET_COUNT 500 /* 1ms buckets */
+
+
+typedef struct
+{
+    unsigned int count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    unsigned int buckets[PDRAW_LATENCY_STATS_BUCKET_COUNT];
+
+} pdraw_latency_stats_t;
+
 
 void pdraw_quat_conj(const quaternion_t *qSrc, quaternion_t *qDst);
 
@@ -80,4 +93,14 @@ int pdraw_videoDimensionsFromH264Sps(uint8_t *pSps, unsigned int spsSize,
     unsigned int *cropTop, unsigned int *cropBottom,
     unsigned int *sarWidth, unsigned int *sarHeight);
 
+
+int pdraw_bufferRequirementsFromH264Sps(const uint8_t *pSps, unsigned int spsSize,
+    unsigned int *maxAuSize, unsigned int *reorderDepth);
+
+
+void pdraw_latencyStatsAdd(pdraw_latency_stats_t *stats, uint64_t latency);
+
+
+void pdraw_latencyStatsLog(pdraw_latency_stats_t *stats, const char *prefix);
+
 #endif /* !_PDRAW_UTILS_HPP_ */
@@ -40,6 +40,7 @@
 #include "pdraw_impl.hpp"
 
 #include <errno.h>
+#include <string.h>
 
 using namespace Pdraw;
 
@@ -62,6 +63,22 @@ struct pdraw *pdraw_new()
 }
 
 
+int pdraw_set_decoder_pool_worker_count(unsigned int count)
+{
+    return (setDecoderPoolWorkerCount(count) == 0) ? 0 : -EINVAL;
+}
+
+
+int pdraw_set_decoder_backend_priority(const char *name, int priority)
+{
+    if (name == NULL)
+    {
+        return -EINVAL;
+    }
+    return (setAvcDecoderPriority(std::string(name), priority) == 0) ? 0 : -ENOENT;
+}
+
+
 int pdraw_destroy(struct pdraw *pdraw)
 {
     if (pdraw == NULL)
@@ -179,7 +196,17 @@ int pdraw_seek_to(struct pdraw *pdraw, uint64_t timestamp)
     {
         return -EINVAL;
     }
-    return toPdraw(pdraw)->seekTo(timestamp);
+    return toPdraw(pdraw)->seekTo(timestamp, false);
+}
+
+
+int pdraw_seek_to_exact(struct pdraw *pdraw, uint64_t timestamp)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->seekTo(timestamp, true);
 }
 
 
@@ -189,7 +216,17 @@ int pdraw_seek_forward(struct pdraw *pdraw, uint64_t delta)
     {
         return -EINVAL;
     }
-    return toPdraw(pdraw)->seekForward(delta);
+    return toPdraw(pdraw)->seekForward(delta, false);
+}
+
+
+int pdraw_seek_forward_exact(struct pdraw *pdraw, uint64_t delta)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->seekForward(delta, true);
 }
 
 
@@ -199,7 +236,17 @@ int pdraw_seek_back(struct pdraw *pdraw, uint64_t delta)
     {
         return -EINVAL;
     }
-    return toPdraw(pdraw)->seekBack(delta);
+    return toPdraw(pdraw)->seekBack(delta, false);
+}
+
+
+int pdraw_seek_back_exact(struct pdraw *pdraw, uint64_t delta)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->seekBack(delta, true);
 }
 
 
@@ -223,6 +270,56 @@ uint64_t pdraw_get_current_time(struct pdraw *pdraw)
 }
 
 
+int pdraw_set_playback_speed(struct pdraw *pdraw, float speed)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->setPlaybackSpeed(speed);
+}
+
+
+float pdraw_get_playback_speed(struct pdraw *pdraw)
+{
+    if (pdraw == NULL)
+    {
+        return 0.f;
+    }
+    return toPdraw(pdraw)->getPlaybackSpeed();
+}
+
+
+int pdraw_step_forward(struct pdraw *pdraw)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->stepForward();
+}
+
+
+int pdraw_step_back(struct pdraw *pdraw)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->stepBack();
+}
+
+
+int pdraw_get_keyframe_list(struct pdraw *pdraw, pdraw_keyframe_t *keyframes, unsigned int maxCount)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->getKeyframeList(keyframes, maxCount);
+}
+
+
 int pdraw_start_recorder(struct pdraw *pdraw, const char *fileName)
 {
     if (pdraw == NULL)
@@ -833,6 +930,16 @@ int pdraw_get_media_info(struct pdraw *pdraw, unsigned int index, pdraw_media_in
 }
 
 
+int pdraw_get_decoder_stats(struct pdraw *pdraw, unsigned int mediaId, pdraw_decoder_stats_t *stats)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->getDecoderStats(mediaId, stats);
+}
+
+
 void *pdraw_add_video_frame_filter_callback(struct pdraw *pdraw, unsigned int mediaId,
                                             pdraw_video_frame_filter_callback_t cb, void *userPtr)
 {
@@ -844,6 +951,18 @@ void *pdraw_add_video_frame_filter_callback(struct pdraw *pdraw, unsigned int me
 }
 
 
+void *pdraw_add_video_frame_filter_parallel_callback(struct pdraw *pdraw, unsigned int mediaId,
+                                                     pdraw_video_frame_filter_callback_t cb, void *userPtr,
+                                                     unsigned int threadCount, int ordered)
+{
+    if (pdraw == NULL)
+    {
+        return NULL;
+    }
+    return toPdraw(pdraw)->addVideoFrameFilterCallback(mediaId, cb, userPtr, threadCount, (ordered) ? true : false);
+}
+
+
 int pdraw_remove_video_frame_filter_callback(struct pdraw *pdraw, unsigned int mediaId, void *filterCtx)
 {
     if (pdraw == NULL)
@@ -884,6 +1003,76 @@ int pdraw_get_producer_last_frame(struct pdraw *pdraw, void *producerCtx, pdraw_
 }
 
 
+int pdraw_release_producer_frame(struct pdraw *pdraw, void *producerCtx, const pdraw_video_frame_t *frame)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->releaseProducerFrame(producerCtx, frame);
+}
+
+
+int pdraw_get_producer_detached_frame(struct pdraw *pdraw, void *producerCtx, pdraw_video_frame_t *frame)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->getProducerDetachedFrame(producerCtx, frame);
+}
+
+
+void *pdraw_add_video_frame_ring_producer(struct pdraw *pdraw, unsigned int mediaId, unsigned int ringSize, pdraw_frame_ring_overflow_policy_t ringPolicy)
+{
+    if (pdraw == NULL)
+    {
+        return NULL;
+    }
+    return toPdraw(pdraw)->addVideoFrameRingProducer(mediaId, ringSize, ringPolicy);
+}
+
+
+int pdraw_get_producer_next_frame(struct pdraw *pdraw, void *producerCtx, pdraw_video_frame_t *frame, long waitUs)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->getProducerNextFrame(producerCtx, frame, waitUs);
+}
+
+
+int pdraw_get_producer_stats(struct pdraw *pdraw, void *producerCtx, pdraw_video_frame_producer_stats_t *stats)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->getProducerStats(producerCtx, stats);
+}
+
+
+int pdraw_set_producer_output_format(struct pdraw *pdraw, void *producerCtx, pdraw_color_format_t format, pdraw_color_matrix_t matrix)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->setProducerOutputFormat(producerCtx, format, matrix);
+}
+
+
+int pdraw_set_producer_scaling(struct pdraw *pdraw, void *producerCtx, unsigned int width, unsigned int height, const pdraw_rect_t *roi)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    return toPdraw(pdraw)->setProducerScaling(producerCtx, width, height, roi);
+}
+
+
 float pdraw_get_controller_radar_angle_setting(struct pdraw *pdraw)
 {
     if (pdraw == NULL)
@@ -967,3 +1156,237 @@ int pdraw_set_hmd_distorsion_correction_settings
     toPdraw(pdraw)->setHmdDistorsionCorrectionSettings(hmdModel, ipd, scale, panH, panV);
     return 0;
 }
+
+
+int pdraw_get_decoder_threading_settings
+        (struct pdraw *pdraw,
+         unsigned int *threadCount,
+         pdraw_decoder_thread_type_t *threadType)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->getDecoderThreadingSettings(threadCount, threadType);
+    return 0;
+}
+
+
+int pdraw_set_decoder_threading_settings
+        (struct pdraw *pdraw,
+         unsigned int threadCount,
+         pdraw_decoder_thread_type_t threadType)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setDecoderThreadingSettings(threadCount, threadType);
+    return 0;
+}
+
+
+int pdraw_get_record_index_settings
+        (struct pdraw *pdraw,
+         int *enabled,
+         int *persistent)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    bool e = false, p = false;
+    toPdraw(pdraw)->getRecordIndexSettings(&e, &p);
+    if (enabled)
+        *enabled = (e) ? 1 : 0;
+    if (persistent)
+        *persistent = (p) ? 1 : 0;
+    return 0;
+}
+
+
+int pdraw_set_record_index_settings
+        (struct pdraw *pdraw,
+         int enabled,
+         int persistent)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setRecordIndexSettings((enabled) ? true : false, (persistent) ? true : false);
+    return 0;
+}
+
+
+int pdraw_get_reverse_playback_settings
+        (struct pdraw *pdraw,
+         unsigned int *cacheMaxSize)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->getReversePlaybackSettings(cacheMaxSize);
+    return 0;
+}
+
+
+int pdraw_set_reverse_playback_settings
+        (struct pdraw *pdraw,
+         unsigned int cacheMaxSize)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setReversePlaybackSettings(cacheMaxSize);
+    return 0;
+}
+
+
+int pdraw_get_decoder_frame_pool_settings
+        (struct pdraw *pdraw,
+         unsigned int *maxSize)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->getDecoderFramePoolSettings(maxSize);
+    return 0;
+}
+
+
+int pdraw_set_decoder_frame_pool_settings
+        (struct pdraw *pdraw,
+         unsigned int maxSize)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setDecoderFramePoolSettings(maxSize);
+    return 0;
+}
+
+
+int pdraw_get_decoder_overload_settings
+        (struct pdraw *pdraw,
+         int *enabled,
+         unsigned int *maxQueueDepth,
+         unsigned int *maxAuAge)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    bool e = false;
+    toPdraw(pdraw)->getDecoderOverloadSettings(&e, maxQueueDepth, maxAuAge);
+    if (enabled)
+        *enabled = (e) ? 1 : 0;
+    return 0;
+}
+
+
+int pdraw_set_decoder_overload_settings
+        (struct pdraw *pdraw,
+         int enabled,
+         unsigned int maxQueueDepth,
+         unsigned int maxAuAge)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setDecoderOverloadSettings((enabled) ? true : false, maxQueueDepth, maxAuAge);
+    return 0;
+}
+
+
+int pdraw_get_stream_profile_settings
+        (struct pdraw *pdraw,
+         pdraw_stream_profile_t *profile)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->getStreamProfileSettings(profile);
+    return 0;
+}
+
+
+int pdraw_set_stream_profile_settings
+        (struct pdraw *pdraw,
+         pdraw_stream_profile_t profile)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setStreamProfileSettings(profile);
+    return 0;
+}
+
+
+int pdraw_get_decoder_pool_settings
+        (struct pdraw *pdraw,
+         int *shared)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    bool s = false;
+    toPdraw(pdraw)->getDecoderPoolSettings(&s);
+    if (shared)
+        *shared = (s) ? 1 : 0;
+    return 0;
+}
+
+
+int pdraw_set_decoder_pool_settings
+        (struct pdraw *pdraw,
+         int shared)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setDecoderPoolSettings((shared) ? true : false);
+    return 0;
+}
+
+
+int pdraw_get_decoder_backend_settings
+        (struct pdraw *pdraw,
+         char *name,
+         unsigned int nameSize)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    std::string n;
+    toPdraw(pdraw)->getDecoderBackendSettings(&n);
+    if ((name) && (nameSize > 0))
+    {
+        strncpy(name, n.c_str(), nameSize);
+        name[nameSize - 1] = '\0';
+    }
+    return 0;
+}
+
+
+int pdraw_set_decoder_backend_settings
+        (struct pdraw *pdraw,
+         const char *name)
+{
+    if (pdraw == NULL)
+    {
+        return -EINVAL;
+    }
+    toPdraw(pdraw)->setDecoderBackendSettings((name) ? std::string(name) : std::string());
+    return 0;
+}
@@ -29,6 +29,8 @@ mypdraw.setup("python test", "python Test", "python tEst")
 mypdraw.open(ipSrc, "", portStreamSrc, portCtrlSrc, portStreamDst, portCtrlDst, 0)
 
 pdrawProd = mypdraw.addVideoFrameProducer(0)
+# get BGR frames for OpenCV, converted by libpdraw
+mypdraw.setProducerOutputFormat(pdrawProd, pdraw.PDRAW_COLOR_FORMAT_BGR24, pdraw.PDRAW_COLOR_MATRIX_AUTO)
 mypdraw.start()
 
 nb = 1000
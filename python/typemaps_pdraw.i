@@ -51,10 +51,10 @@ import_array();
 
 /* conversion to numpy array */
 
-PyObject* plane2numpyArray(uint8_t* plane, int w, int h)
+PyObject* plane2numpyArray(uint8_t* plane, int w, int h, int channels = 1)
 {
     int type = NPY_UINT8;
-    npy_intp dim[3] = { h, w, 1 };
+    npy_intp dim[3] = { h, w, channels };
     PyObject *ret = PyArray_SimpleNewFromData(3, dim, type, plane);
     return ret;
 }
@@ -127,6 +127,28 @@ PyObject* plane2numpyArray(uint8_t* plane, int w, int h)
 %extend pdraw_video_frame_t {
     /* replace plane list with plane() method */
     PyObject* plane(size_t i) {
+        int channels = 0;
+        switch (self->colorFormat) {
+        case PDRAW_COLOR_FORMAT_RGB24:
+        case PDRAW_COLOR_FORMAT_BGR24:
+            channels = 3;
+            break;
+        case PDRAW_COLOR_FORMAT_RGBA:
+            channels = 4;
+            break;
+        case PDRAW_COLOR_FORMAT_GRAY:
+            channels = 1;
+            break;
+        default:
+            break;
+        }
+        if (channels) {
+            /* packed formats have a single plane */
+            if (i > 0)
+                return Py_None;
+            return plane2numpyArray(self->plane[0], self->width, self->height, channels);
+        }
+
         int planeNb = self->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR ? 3 : 2;
         if ((int)i >= planeNb)
             return Py_None;